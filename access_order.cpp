@@ -0,0 +1,118 @@
+#include "access_order.hpp"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+static const char* access_order_names[ACCESS_ORDER_COUNT] = {"linear", "reverse", "morton", "tiled", "random"};
+
+typedef std::tuple<int, uint64_t, uint64_t> access_order_key_t;
+static std::map<access_order_key_t, std::unique_ptr<access_order_t>> access_orders;
+static std::mutex access_orders_lock;
+
+//Z-order code of (x, y): x in the even bits, y in the odd bits.
+static uint64_t morton_code(uint64_t x, uint64_t y) {
+#ifdef __BMI2__
+    return _pdep_u64(x, 0x5555555555555555ull) | _pdep_u64(y, 0xAAAAAAAAAAAAAAAAull);
+#else
+    uint64_t code = 0;
+    for (uint64_t bit = 0; bit < 32; bit++) {
+        code |= ((x >> bit) & 1) << (2*bit);
+        code |= ((y >> bit) & 1) << (2*bit + 1);
+    }
+    return code;
+#endif
+}
+
+//Codes only the frame's own windows and sorts them, so a tall strip of rows costs O(n log n) rather
+//than enumerating every code of the square around it.
+static void build_morton(access_order_t* order, uint64_t width) {
+    std::vector<std::pair<uint64_t, uint32_t>> codes(order->nWindows);
+    for (uint64_t w = 0; w < order->nWindows; w++) {
+        codes[w] = std::make_pair(morton_code(w % width, w / width), (uint32_t) w);
+    }
+    std::sort(codes.begin(), codes.end());
+    for (const std::pair<uint64_t, uint32_t>& code : codes) {
+        order->windows.push_back(code.second);
+    }
+}
+
+static void build_tiled(access_order_t* order, uint64_t width, uint64_t height) {
+    for (uint64_t ty = 0; ty < height; ty += ACCESS_ORDER_TILE) {
+        for (uint64_t tx = 0; tx < width; tx += ACCESS_ORDER_TILE) {
+            for (uint64_t y = ty; y < ty + ACCESS_ORDER_TILE && y < height; y++) {
+                for (uint64_t x = tx; x < tx + ACCESS_ORDER_TILE && x < width; x++) {
+                    if (y*width + x < order->nWindows) {
+                        order->windows.push_back(y*width + x);
+                    }
+                }
+            }
+        }
+    }
+}
+
+//Fisher-Yates with its own generator, so building a table leaves rand() (and the frames drawn from it) alone.
+static void build_random(access_order_t* order) {
+    for (uint64_t i = 0; i < order->nWindows; i++) {
+        order->windows.push_back(i);
+    }
+    uint64_t state = order->seed * 0x9E3779B97F4A7C15ull + 1;
+    for (uint64_t i = order->nWindows; i > 1; i--) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        std::swap(order->windows[i - 1], order->windows[state % i]);
+    }
+}
+
+static void build_access_order(access_order_t* order) {
+    const uint64_t width = ACCESS_ORDER_ROW_WINDOWS;
+    const uint64_t height = (order->nWindows + width - 1) / width;
+    order->windows.reserve(order->nWindows);
+    switch (order->kind) {
+        case ACCESS_ORDER_LINEAR:
+            for (uint64_t i = 0; i < order->nWindows; i++) {
+                order->windows.push_back(i);
+            }
+            break;
+        case ACCESS_ORDER_REVERSE:
+            for (uint64_t i = order->nWindows; i > 0; i--) {
+                order->windows.push_back(i - 1);
+            }
+            break;
+        case ACCESS_ORDER_MORTON:
+            build_morton(order, width);
+            break;
+        case ACCESS_ORDER_TILED:
+            build_tiled(order, width, height);
+            break;
+        default:
+            build_random(order);
+            break;
+    }
+}
+
+const access_order_t* get_access_order(access_order_kind_t kind, uint64_t nWindows, uint64_t seed) {
+    if (kind != ACCESS_ORDER_RANDOM) {
+        seed = 0;
+    }
+    std::lock_guard<std::mutex> guard(access_orders_lock);
+    std::unique_ptr<access_order_t>& slot = access_orders[access_order_key_t(kind, nWindows, seed)];
+    if (!slot) {
+        slot.reset(new access_order_t());
+        slot->kind = kind;
+        slot->nWindows = nWindows;
+        slot->seed = seed;
+        build_access_order(slot.get());
+    }
+    return slot.get();
+}
+
+const char* access_order_name(access_order_kind_t kind) {
+    return kind < ACCESS_ORDER_COUNT ? access_order_names[kind] : "unknown";
+}
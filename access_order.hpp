@@ -0,0 +1,46 @@
+//Orders a frame's windows are read in.
+//read_frame reads linearly and read_frame_backwards in reverse, but GPUs sample textures in tiles or
+//Z-order, and under LRU the order decides which lines a walk evicts. Every order is precomputed once
+//per (order, frame size, seed) into a table of window ids that the read paths loop over, so reading
+//in any order costs the same as a linear read.
+//
+//Frames are laid out as rows of ACCESS_ORDER_ROW_WINDOWS windows, i.e. 128 pixel wide textures.
+
+#ifndef ACCESS_ORDER_HPP
+#define ACCESS_ORDER_HPP
+
+#include <inttypes.h>
+#include <vector>
+
+#define ACCESS_ORDER_ROW_WINDOWS 16    //128 pixels of 8 pixel wide windows
+#define ACCESS_ORDER_TILE 4            //Tiles of 4x4 windows, 32x16 pixels
+
+typedef enum {
+    ACCESS_ORDER_LINEAR,
+    ACCESS_ORDER_REVERSE,
+    ACCESS_ORDER_MORTON,    //Z-order over (column, row), rows past the end are skipped
+    ACCESS_ORDER_TILED,     //Tile-major, row-major inside a tile
+    ACCESS_ORDER_RANDOM,    //Seeded permutation
+    ACCESS_ORDER_COUNT
+} access_order_kind_t;
+
+typedef struct {
+    access_order_kind_t kind;
+    uint64_t nWindows;
+    uint64_t seed;
+    std::vector<uint32_t> windows;    //Window ids in read order
+} access_order_t;
+
+//Orders an attack renders the attacker frame in and walks the buffer in.
+typedef struct {
+    access_order_kind_t render;
+    access_order_kind_t walk;
+    uint64_t seed;    //Of ACCESS_ORDER_RANDOM
+} attack_order_t;
+
+//The table for kind over nWindows windows, built on first use. Tables live until exit and are safe
+//to share between threads. seed only matters for ACCESS_ORDER_RANDOM.
+extern const access_order_t* get_access_order(access_order_kind_t kind, uint64_t nWindows, uint64_t seed=0);
+extern const char* access_order_name(access_order_kind_t kind);
+
+#endif
@@ -0,0 +1,391 @@
+//Microbenchmarks of the simulator itself.
+//Each benchmark is repeated and reports ns/op percentiles over the runs, plus simulated accesses/s
+//where it drives the cache. Results are written as JSON, one benchmark per line, and can be compared
+//against a stored baseline: a p50 slower than the baseline by more than the threshold is a regression.
+
+//Stdlib Things
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+//My Things
+#include "cache.hpp"
+#include "experiment.hpp"
+#include "pipeline.hpp"
+
+#define BENCH_DEFAULT_RUNS 7
+#define BENCH_HEAVY_RUNS 3          //For whole experiments that take seconds per run
+#define BENCH_DEFAULT_THRESHOLD 10.0 //Percent
+#define BENCH_LINE_SIZE 64
+
+typedef struct {
+    std::chrono::steady_clock::time_point begin;
+    double elapsedNs;
+    uint64_t accesses;  //Simulated cache accesses made in the timed region, if any
+} bench_timer_t;
+
+typedef struct {
+    std::string name;
+    uint64_t runs;
+    uint64_t ops;
+    uint64_t accesses;
+    double nsPerOpMin;
+    double nsPerOpP50;
+    double nsPerOpP90;
+    double nsPerOpP99;
+    double opsPerSec;
+    double accessesPerSec;
+} bench_result_t;
+
+//A benchmark runs its own setup, brackets the measured part with start/stop and returns the number of ops.
+typedef std::function<uint64_t(bench_timer_t*)> bench_fn_t;
+
+static uint64_t bench_runs = BENCH_DEFAULT_RUNS;
+static const char* bench_filter = nullptr;
+static std::vector<bench_result_t> bench_results;
+
+static volatile uint64_t bench_sink;
+
+static void start(bench_timer_t* timer) {
+    timer->begin = std::chrono::steady_clock::now();
+}
+
+static void stop(bench_timer_t* timer) {
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - timer->begin;
+    timer->elapsedNs += elapsed.count();
+}
+
+//Linear interpolation between the closest ranks of sorted values.
+static double percentile(const std::vector<double>& sorted, double p) {
+    double rank = p * (sorted.size() - 1);
+    size_t lo = (size_t) rank;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (rank - lo) * (sorted[hi] - sorted[lo]);
+}
+
+static void run_bench(std::string name, uint64_t runs, bench_fn_t fn) {
+    if (bench_filter != nullptr && strstr(name.c_str(), bench_filter) == nullptr) {
+        return;
+    }
+
+    std::vector<double> nsPerOp;
+    uint64_t ops = 0;
+    uint64_t accesses = 0;
+    double totalNs = 0.0;
+    for (uint64_t r = 0; r < runs; r++) {
+        bench_timer_t timer = {};
+        ops = fn(&timer);
+        accesses = timer.accesses;
+        totalNs += timer.elapsedNs;
+        nsPerOp.push_back(timer.elapsedNs / ops);
+    }
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+
+    bench_result_t result;
+    result.name = name;
+    result.runs = runs;
+    result.ops = ops;
+    result.accesses = accesses;
+    result.nsPerOpMin = nsPerOp[0];
+    result.nsPerOpP50 = percentile(nsPerOp, 0.50);
+    result.nsPerOpP90 = percentile(nsPerOp, 0.90);
+    result.nsPerOpP99 = percentile(nsPerOp, 0.99);
+    result.opsPerSec = 1e9 / result.nsPerOpP50;
+    result.accessesPerSec = accesses * runs * 1e9 / totalNs;
+
+    printf("%-32s %12.1f %12.1f %12.1f %12.3f %12.3f\n", name.c_str(), result.nsPerOpP50,
+        result.nsPerOpP90, result.nsPerOpP99, result.opsPerSec / 1e6, result.accessesPerSec / 1e6);
+    fflush(stdout);
+    bench_results.push_back(result);
+}
+
+static cache_config_t get_bench_cache_config(uint64_t s) {
+    cache_config_t config = DEFAULT_SIM_CONFIG.l1_config;
+    config.c = 16;
+    config.b = 6;
+    config.s = s;
+    config.replace_policy = REPLACE_POLICY_LRU;
+    config.write_strat = WRITE_STRAT_WBWA;
+    config.prefetcher_disabled = true;
+    return config;
+}
+
+static void bench_compress() {
+    const uint64_t nWindows = 4096;
+    const uint64_t reps = 16;
+    std::vector<pixel_window_t> windows(nWindows);
+    for (uint64_t i = 0; i < nWindows; i++) {
+        for (size_t p = 0; p < WINDOW_NUM_PIXELS; p++) {
+            for (size_t c = 0; c < NUM_CHANNELS; c++) {
+                //Half of the windows compress
+                windows[i].pixels[p][c] = i % 2 == 0 ? rand() % 4 : rand() % 256;
+            }
+        }
+    }
+
+    run_bench("compress", bench_runs, [&](bench_timer_t* timer) {
+        uint64_t compressed = 0;
+        start(timer);
+        for (uint64_t r = 0; r < reps; r++) {
+            for (uint64_t i = 0; i < nWindows; i++) {
+                compressed += compress(&windows[i]).did_compression;
+            }
+        }
+        stop(timer);
+        bench_sink = compressed;
+        return nWindows * reps;
+    });
+}
+
+//Hits: the cache holds exactly the lines being read. Misses: cycling over twice the capacity under LRU.
+static void bench_cache_access(uint64_t s) {
+    const cache_config_t config = get_bench_cache_config(s);
+    const uint64_t nLines = 1ULL << (config.c - config.b);
+    const uint64_t nAccesses = s >= 8 ? (1 << 17) : (1 << 20);
+    const std::string ways = std::to_string(1ULL << s) + "way";
+
+    run_bench("cache_access_hit_" + ways, bench_runs, [&](bench_timer_t* timer) {
+        sim_stats_t stats = {};
+        Cache cache(config, true);
+        uint64_t tag, index;
+        for (uint64_t i = 0; i < nLines; i++) {
+            cache.parse_addr(i * BENCH_LINE_SIZE, &tag, &index);
+            cache.install<STATS_LEVEL_FULL>('R', tag, index, &stats);
+        }
+
+        uint64_t hits = 0;
+        start(timer);
+        for (uint64_t i = 0; i < nAccesses; i++) {
+            cache.parse_addr((i % nLines) * BENCH_LINE_SIZE, &tag, &index);
+            hits += cache.access<STATS_LEVEL_FULL>('R', tag, index, &stats);
+        }
+        stop(timer);
+        bench_sink = hits;
+        timer->accesses = nAccesses;
+        return nAccesses;
+    });
+
+    run_bench("cache_access_miss_" + ways, bench_runs, [&](bench_timer_t* timer) {
+        sim_stats_t stats = {};
+        Cache cache(config, true);
+        uint64_t tag, index;
+        uint64_t hits = 0;
+        start(timer);
+        for (uint64_t i = 0; i < nAccesses; i++) {
+            cache.parse_addr((i % (2*nLines)) * BENCH_LINE_SIZE, &tag, &index);
+            if (cache.access<STATS_LEVEL_FULL>('R', tag, index, &stats)) {
+                hits++;
+            } else {
+                cache.install<STATS_LEVEL_FULL>('R', tag, index, &stats);
+            }
+        }
+        stop(timer);
+        bench_sink = hits;
+        timer->accesses = nAccesses;
+        return nAccesses;
+    });
+}
+
+//Random lines over twice the driver's LLC, through the whole hierarchy.
+static void bench_sim_access() {
+    const uint64_t nAccesses = 1 << 18;
+    const uint64_t nLines = 2ULL << (cache_config.l1_config.c - cache_config.l1_config.b);
+    std::vector<uint64_t> addrs(nAccesses);
+    for (uint64_t i = 0; i < nAccesses; i++) {
+        addrs[i] = (rand() % nLines) * BENCH_LINE_SIZE;
+    }
+
+    run_bench("sim_access", bench_runs, [&](bench_timer_t* timer) {
+        sim_stats_t stats;
+        init_stats(&stats);
+        double totalTime = 0.0;
+        sim_setup(&cache_config);
+        start(timer);
+        for (uint64_t i = 0; i < nAccesses; i++) {
+            totalTime += sim_access('R', addrs[i], &stats);
+        }
+        stop(timer);
+        sim_finish(&stats);
+        bench_sink = (uint64_t) totalTime;
+        timer->accesses = nAccesses;
+        return nAccesses;
+    });
+}
+
+//One op is one window read, after the LLC has been filled by a buffer frame.
+static void bench_read_frame(bool use_facade) {
+    const uint64_t reps = 4;
+    run_bench(use_facade ? "read_frame_facade" : "read_frame", bench_runs, [&](bench_timer_t* timer) {
+        sim_stats_t stats;
+        init_stats(&stats);
+        frame_t* buffer_frame = get_new_frame_random(FRAME_NUM_WINDOWS_CACHE);
+        frame_t* frame = get_new_frame_random(FRAME_NUM_WINDOWS_CACHE);
+        const uint64_t nWindows = frame->nWindows;
+        sim_setup(&cache_config);
+        read_frame(buffer_frame, &stats);
+
+        const uint64_t readsBefore = stats.reads;
+        double totalTime = 0.0;
+        start(timer);
+        for (uint64_t r = 0; r < reps; r++) {
+            totalTime += use_facade ? read_frame_facade(frame, &stats) : read_frame(frame, &stats);
+        }
+        stop(timer);
+        timer->accesses = stats.reads - readsBefore;
+        sim_finish(&stats);
+        free_frames();
+        bench_sink = (uint64_t) totalTime;
+        return nWindows * reps;
+    });
+}
+
+//One op is one attacked pixel.
+static void bench_pixel_attack() {
+    run_bench("do_pixel_attack", std::min(bench_runs, (uint64_t) BENCH_HEAVY_RUNS), [&](bench_timer_t* timer) {
+        start(timer);
+        double accuracy = do_pixel_attack(false);
+        stop(timer);
+        free_frames();
+        bench_sink = (uint64_t) (accuracy * 1000);
+        return 1024;
+    });
+}
+
+static void bench_pixel_attack_pipelined() {
+    run_bench("do_pixel_attack_pipelined", std::min(bench_runs, (uint64_t) BENCH_HEAVY_RUNS), [&](bench_timer_t* timer) {
+        start(timer);
+        double accuracy = do_pixel_attack_pipelined(false);
+        stop(timer);
+        free_frames();
+        bench_sink = (uint64_t) (accuracy * 1000);
+        return 1024;
+    });
+}
+
+//One op is one texture size of the sweep.
+static void bench_llc_times() {
+    run_bench("generate_llc_times", std::min(bench_runs, (uint64_t) BENCH_HEAVY_RUNS), [&](bench_timer_t* timer) {
+        llc_walk_stats_combined_t* stats;
+        start(timer);
+        uint64_t num_stats = collect_llc_times(&stats);
+        stop(timer);
+        delete[] stats;
+        return num_stats;
+    });
+}
+
+static bool write_json(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (out == nullptr) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+
+    fprintf(out, "{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < bench_results.size(); i++) {
+        const bench_result_t& r = bench_results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"runs\": %" PRIu64 ", \"ops\": %" PRIu64 ", \"accesses\": %" PRIu64 ", "
+            "\"ns_per_op_min\": %.3f, \"ns_per_op_p50\": %.3f, \"ns_per_op_p90\": %.3f, \"ns_per_op_p99\": %.3f, "
+            "\"ops_per_sec\": %.1f, \"accesses_per_sec\": %.1f}%s\n",
+            r.name.c_str(), r.runs, r.ops, r.accesses, r.nsPerOpMin, r.nsPerOpP50, r.nsPerOpP90, r.nsPerOpP99,
+            r.opsPerSec, r.accessesPerSec, i + 1 < bench_results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    fclose(out);
+    return true;
+}
+
+//Compares p50s against a file written by write_json. Returns the number of regressions.
+static uint64_t compare_baseline(const char* path, double thresholdPct) {
+    FILE* in = fopen(path, "r");
+    if (in == nullptr) {
+        fprintf(stderr, "Could not open baseline %s\n", path);
+        return 0;
+    }
+
+    printf("\nBaseline comparison (p50 ns/op, threshold %.1f%%)\n", thresholdPct);
+    uint64_t regressions = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        const char* nameStart = strstr(line, "\"name\": \"");
+        const char* p50Start = strstr(line, "\"ns_per_op_p50\": ");
+        if (nameStart == nullptr || p50Start == nullptr) {
+            continue;
+        }
+        nameStart += strlen("\"name\": \"");
+        std::string name(nameStart, strchr(nameStart, '"') - nameStart);
+        double baseP50 = atof(p50Start + strlen("\"ns_per_op_p50\": "));
+
+        for (const bench_result_t& r : bench_results) {
+            if (r.name != name) {
+                continue;
+            }
+            double changePct = (r.nsPerOpP50 - baseP50) / baseP50 * 100.0;
+            bool regressed = changePct > thresholdPct;
+            regressions += regressed;
+            printf("%-32s %12.1f -> %12.1f %+8.1f%%%s\n", name.c_str(), baseP50, r.nsPerOpP50, changePct,
+                regressed ? "  REGRESSION" : "");
+        }
+    }
+
+    fclose(in);
+    return regressions;
+}
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [--runs N] [--filter SUBSTRING] [--out FILE] [--baseline FILE] [--threshold PERCENT]\n", prog);
+}
+
+int main(int argc, char** argv) {
+    const char* outPath = nullptr;
+    const char* baselinePath = nullptr;
+    double thresholdPct = BENCH_DEFAULT_THRESHOLD;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            bench_runs = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            bench_filter = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            thresholdPct = atof(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    #ifndef __OPTIMIZE__
+    fprintf(stderr, "Warning: benchmarks built without optimization, rebuild with FAST=1\n");
+    #endif
+
+    init_cache_config();
+    srand(1);
+
+    printf("%-32s %12s %12s %12s %12s %12s\n", "Benchmark", "p50 ns/op", "p90 ns/op", "p99 ns/op", "Mops/s", "Macc/s");
+    bench_compress();
+    for (uint64_t s : {1, 3, 4, 10}) {
+        bench_cache_access(s);
+    }
+    bench_sim_access();
+    bench_read_frame(false);
+    bench_read_frame(true);
+    bench_pixel_attack();
+    bench_pixel_attack_pipelined();
+    bench_llc_times();
+
+    if (outPath != nullptr && !write_json(outPath)) {
+        return 2;
+    }
+    if (baselinePath != nullptr && compare_baseline(baselinePath, thresholdPct) > 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -1,34 +1,159 @@
 #include "cache.hpp"
 
-#include <iostream>
+#include "heatmap.hpp"
+#include "sim_trace.hpp"
 
-#if DEBUG
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
-#endif
+#include <iostream>
+#include <vector>
 
 #define ADDR_SIZE 64
 
 namespace {
     //helper methods
     inline uint64_t get_mask(uint64_t n) {
-        return (1 << n) - 1;       
+        return (1ULL << n) - 1;       
+    }
+
+    inline uint64_t log2_exact(uint64_t n) {
+        uint64_t bits = 0;
+        while ((1ULL << bits) < n) {
+            bits++;
+        }
+        return bits;
+    }
+
+    //Slice hash functions of Intel's complex addressing (Maurice et al., RAID 2015), as line-address masks.
+    //Each slice bit is the parity of the masked line address. Further bits use generated masks.
+    const uint64_t INTEL_SLICE_MASKS[] = {
+        0x1B5F575440ULL >> 6,
+        0x2EB5FAA880ULL >> 6,
+        0x3CCCC93100ULL >> 6,
+    };
+
+    inline uint64_t get_slice_mask(uint64_t bit) {
+        if (bit < sizeof(INTEL_SLICE_MASKS) / sizeof(INTEL_SLICE_MASKS[0])) {
+            return INTEL_SLICE_MASKS[bit];
+        }
+
+        uint64_t x = bit * 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return (x ^ (x >> 31)) & get_mask(40);
+    }
+
+    inline uint64_t get_repl_max() {
+        return get_mask(CACHE_REPL_BITS);
     }
+
+    inline bool is_compressed(const cache_config_t& config) {
+        return config.compressed && (config.replace_policy == REPLACE_POLICY_LRU || config.replace_policy == REPLACE_POLICY_LFU);
+    }
+
+    //Every trial builds its caches, so a config that can't be compressed is reported once per process
+    std::atomic_flag warnedUncompressed = ATOMIC_FLAG_INIT;
 }
 
 Cache::Cache(const cache_config_t& config, bool isL1) : 
     m_Config(config),
-    m_nSets(1 << (config.c - config.b - config.s)),
-    m_Associativity(1 << config.s),
-    m_TimestepCounter(1 << (config.c - config.b + 1)),
+    m_nSets(1ULL << (config.c - config.b - config.s)),
+    m_Associativity((1ULL << config.s) * (is_compressed(config) ? 2 : 1)),
     m_IsL1(isL1),
+    m_SetFill(nullptr),
+    m_SetClocks(nullptr),
+    m_SetSegments(nullptr),
+    m_SegmentsPerSet(0),
+    m_PlaneWords(0),
+    m_Planes(nullptr),
+    m_BrripCounter(0),
+    m_IndexSlots(0),
+    m_IndexShift(0),
+    m_TagIndex(nullptr),
     m_PreviousMissLoc(0x0)
 {
+    if (config.compressed && !is_compressed(config) && !warnedUncompressed.test_and_set()) {
+        fprintf(stderr, "Warning: a compressed cache needs LRU or LFU replacement; simulating replacement policy %d uncompressed\n",
+            (int) config.replace_policy);
+    }
+
     const uint64_t numBlocks = m_nSets*m_Associativity; //Alternatively 2^(C - B)
     m_Entries = new cache_entry_t[numBlocks];
     for (uint64_t i = 0; i < numBlocks; i++) {
         m_Entries[i].valid = false;
         m_Entries[i].dirty = false;
+        m_Entries[i].mru = false;
+        m_Entries[i].half = false;
+        m_Entries[i].repl = 0;
     }
+
+    //Slices must be a power of two no larger than the number of sets.
+    uint64_t sliceBits = log2_exact(config.slices > 1 ? config.slices : 1);
+    if (sliceBits > CACHE_MAX_SLICE_BITS) {
+        sliceBits = CACHE_MAX_SLICE_BITS;
+    }
+    while ((1ULL << sliceBits) > m_nSets) {
+        sliceBits--;
+    }
+    m_nSlices = 1ULL << sliceBits;
+    m_SetsPerSlice = m_nSets / m_nSlices;
+    m_SetBits = log2_exact(m_SetsPerSlice);
+    for (uint64_t i = 0; i < sliceBits; i++) {
+        m_SliceMasks[i] = get_slice_mask(i);
+    }
+
+    if (uses_rrpv()) {
+        m_PlaneWords = (m_Associativity + 63) / 64;
+        m_Planes = new uint64_t[m_nSets * 3 * m_PlaneWords]();
+    } else {
+        m_SetFill = new uint32_t[m_nSets]();
+        if (m_Config.replace_policy == REPLACE_POLICY_LRU) {
+            m_SetClocks = new uint16_t[m_nSets]();
+        }
+        if (is_compressed(config)) {
+            m_SetSegments = new uint32_t[m_nSets]();
+            m_SegmentsPerSet = m_Associativity;
+        }
+    }
+
+    if (m_Associativity > CACHE_INDEX_MIN_WAYS) {
+        const uint64_t indexBits = log2_exact(2*m_Associativity);
+        m_IndexSlots = 1ULL << indexBits;
+        m_IndexShift = 64 - indexBits;
+        m_TagIndex = new uint16_t[m_nSets * m_IndexSlots]();
+    }
+}
+
+//Copies other's contents and replacement state. config must describe the same cache as other's.
+Cache::Cache(const Cache& other, const cache_config_t& config) : Cache(config, other.m_IsL1) {
+    std::copy(other.m_Entries, other.m_Entries + m_nSets*m_Associativity, m_Entries);
+    if (m_SetFill != nullptr) {
+        std::copy(other.m_SetFill, other.m_SetFill + m_nSets, m_SetFill);
+    }
+    if (m_SetClocks != nullptr) {
+        std::copy(other.m_SetClocks, other.m_SetClocks + m_nSets, m_SetClocks);
+    }
+    if (m_SetSegments != nullptr) {
+        std::copy(other.m_SetSegments, other.m_SetSegments + m_nSets, m_SetSegments);
+    }
+    if (m_Planes != nullptr) {
+        std::copy(other.m_Planes, other.m_Planes + m_nSets*3*m_PlaneWords, m_Planes);
+    }
+    if (m_TagIndex != nullptr) {
+        std::copy(other.m_TagIndex, other.m_TagIndex + m_nSets*m_IndexSlots, m_TagIndex);
+    }
+    m_BrripCounter = other.m_BrripCounter.load();
+    m_PreviousMissLoc = other.m_PreviousMissLoc;
+}
+
+Cache::~Cache() {
+    delete[] m_Entries;
+    delete[] m_SetFill;
+    delete[] m_SetClocks;
+    delete[] m_SetSegments;
+    delete[] m_Planes;
+    delete[] m_TagIndex;
 }
 
 /**
@@ -40,29 +165,25 @@ Cache::Cache(const cache_config_t& config, bool isL1) :
  * 
  * Uses "needsWriteback" and "writeback" to signify a writeback in the case of WBWA.
 */
+template <stats_level_t L>
 bool Cache::access(char rw, uint64_t tag, uint64_t index, sim_stats_t* stats) {
+    const uint8_t level = m_IsL1 ? 1 : 2;
     if (m_IsL1) {
-        stats->accesses_l1++;
+        count_full<L>(stats->accesses_l1);
     } else {
-        stats->accesses_l2++;
+        count_full<L>(stats->accesses_l2);
         if (rw == 'R') {
-            stats->reads_l2++;
+            count_full<L>(stats->reads_l2);
         } else {
-            stats->writes_l2++;
+            count_full<L>(stats->writes_l2);
         }
     }
     
     if (m_Config.disabled) {
         if (rw == 'R') {
-            stats->read_misses_l2++;
-            #if DEBUG
-            printf("L2 is disabled, treating this as an L2 read miss\n");
-            #endif
-        } else {
-            #if DEBUG
-                printf("L2 is disabled, writing through to memory\n");
-            #endif
+            count_full<L>(stats->read_misses_l2);
         }
+        sim_emit<L>(SIM_EVENT_BYPASS, level, rw, 0, tag, index);
         return false;
     }
     
@@ -70,71 +191,41 @@ bool Cache::access(char rw, uint64_t tag, uint64_t index, sim_stats_t* stats) {
     cache_entry_t* hit = block_in_cache(tag, index);
     if (hit != nullptr) {
         //CACHE HIT
-        #if DEBUG
-        if (m_IsL1) {
-            printf("L1 hit\n");
-        } else {
-            if (rw == 'R') {
-                printf("L2 read hit\n");
-            } else {
-                printf("L2 found block in cache on write\n");
-            }
-        }
-        #endif
 
         //Handle Replacement Updates
         if (m_Config.replace_policy == REPLACE_POLICY_LFU) {
-            hit->useCounter++;
+            if (hit->repl < get_repl_max()) {
+                hit->repl++;
+            }
             clear_mru(index);
             hit->mru = true;
+        } else if (uses_rrpv()) {
+            update_rrpv_hit(index, hit - &m_Entries[index*m_Associativity]);
         } else {
-            hit->timestamp = m_TimestepCounter;
-            m_TimestepCounter++;
+            hit->repl = next_lru_stamp(index);
         }
-        #if DEBUG
-        if (m_IsL1) {
-            printf("In L1, moving Tag: 0x%" PRIx64 " and Index: 0x%" PRIx64 " to MRU position", tag, index);
-        } else {
-            printf("In L2, moving Tag: 0x%" PRIx64 " and Index: 0x%" PRIx64 " to MRU position", tag, index);
-        }
-        #endif
 
         //Handle Writeback
-        if (rw == 'W' && m_Config.write_strat == WRITE_STRAT_WBWA) {
-            #if DEBUG
-            printf(" and setting dirty bit\n");
-            #endif
+        const bool setDirty = rw == 'W' && m_Config.write_strat == WRITE_STRAT_WBWA;
+        if (setDirty) {
             hit->dirty = true;
         }
-        #if DEBUG
-        else {
-            printf("\n");
-        }
-        #endif
+        sim_emit<L>(SIM_EVENT_HIT, level, rw, 0, tag, index, setDirty);
+        HEATMAP_HIT(level, index, get_addr(tag, index));
 
         if (m_IsL1) {
-            stats->hits_l1++;
+            count_full<L>(stats->hits_l1);
         } else if (rw == 'R') {
-            stats->read_hits_l2++;
+            count_full<L>(stats->read_hits_l2);
         }
     } else {
         //CACHE MISS
+        sim_emit<L>(SIM_EVENT_MISS, level, rw, 0, tag, index);
         if (m_IsL1) {
-            #if DEBUG
-            printf("L1 miss\n");
-            #endif
-            stats->misses_l1++;
+            count_full<L>(stats->misses_l1);
         } else if (rw == 'R') {
-            #if DEBUG
-            printf("L2 read miss\n");
-            #endif
-            stats->read_misses_l2++;
+            count_full<L>(stats->read_misses_l2);
         }
-        #if DEBUG
-        else {
-            printf("L2 did not find block in cache on write, writing through to memory anyway\n");
-        }
-        #endif
     }
 
     return hit;
@@ -143,65 +234,133 @@ bool Cache::access(char rw, uint64_t tag, uint64_t index, sim_stats_t* stats) {
 /**
  * Does insertion of block.
 */
-void Cache::install(char rw, uint64_t tag, uint64_t index, sim_stats_t* stats, bool* outNeedsWB, uint64_t* outWBAddr) {
-    cache_entry_t& installBlock = find_eviction_block(index);
-
-    #if DEBUG
-        printf("Evict from %s: ", m_IsL1 ? "L1" : "L2");
-    #endif
-
-    bool needsWB = false;
-    uint64_t wbAddr;
-    if (installBlock.valid) {
-        //Evict block
-        stats->num_evictions++;
-        if (installBlock.dirty && m_Config.write_strat == WRITE_STRAT_WBWA) {
-            needsWB = true;
-            wbAddr = get_addr(installBlock.tag, index);
+template <stats_level_t L>
+uint32_t Cache::install(char rw, uint64_t tag, uint64_t index, sim_stats_t* stats, uint64_t* outWBAddrs, bool compressed) {
+    const uint8_t level = m_IsL1 ? 1 : 2;
+    uint32_t numWB = 0;
+
+    cache_entry_t* block;
+    if (m_SetSegments != nullptr) {
+        //Compressed cache: evict from the LRU end until the line's segments fit, then take the next tag
+        const uint32_t segments = compressed ? 1 : 2;
+        while (m_SetSegments[index] + segments > m_SegmentsPerSet) {
+            cache_entry_t* victim = find_replacement_victim(index);
+            if (victim == nullptr) {
+                //An LFU set whose only line is its MRU one
+                victim = &m_Entries[index*m_Associativity];
+            }
+            evict_block<L>(rw, tag, index, *victim, stats, outWBAddrs, &numWB);
+            m_SetSegments[index] -= victim->half ? 1 : 2;
+            remove_block(index, victim);
         }
-        #if DEBUG
-        if (m_IsL1) {
-            printf("block with valid=1, dirty=%d, tag 0x%" PRIx64 " and index=0x%" PRIx64 "\n", 
-                installBlock.dirty, installBlock.tag, index);
-        } else {
-            printf("block with valid=1, tag 0x%" PRIx64 " and index=0x%" PRIx64 "\n", 
-                installBlock.tag, index);
+        m_SetSegments[index] += segments;
+        block = &m_Entries[index*m_Associativity + m_SetFill[index]];
+        m_SetFill[index]++;
+    } else {
+        block = &find_eviction_block(index);
+        if (!block->valid && m_SetFill != nullptr) {
+            m_SetFill[index]++;
+        }
+        if (block->valid) {
+            evict_block<L>(rw, tag, index, *block, stats, outWBAddrs, &numWB);
+            index_erase(index, block - &m_Entries[index*m_Associativity]);
         }
-        #endif
-    }
-    #if DEBUG
-    else {
-        printf("block with valid=0 and index=0x%" PRIx64 "\n", index);
     }
-    #endif
 
+    cache_entry_t& installBlock = *block;
     installBlock.valid = true;
     installBlock.tag = tag;
+    installBlock.half = compressed && m_SetSegments != nullptr;
+    index_insert(index, block - &m_Entries[index*m_Associativity]);
     const bool writeAllocate = rw == 'W' && m_Config.write_strat == WRITE_STRAT_WBWA;
     installBlock.dirty = writeAllocate;
+    sim_emit<L>(SIM_EVENT_INSTALL, level, rw, get_addr(tag, index), tag, index, writeAllocate);
 
     //Handle MIP for LRU and LFU
     if (m_Config.replace_policy == REPLACE_POLICY_LFU) {
-        installBlock.useCounter = 1;
+        installBlock.repl = 1;
         clear_mru(index);
         installBlock.mru = true;
+    } else if (uses_rrpv()) {
+        set_rrpv(index, &installBlock - &m_Entries[index*m_Associativity], get_rrpv_insert());
+    } else {
+        installBlock.repl = next_lru_stamp(index);
+    }
+
+    return numWB;
+}
+
+//Compressed cache: gives a line that just hit its current size, which changes with its window's
+//compressibility. Growing evicts from the LRU end until the line fits; the line is the set's MRU, so it
+//is never the victim. Returns the number of writebacks, as install.
+template <stats_level_t L>
+uint32_t Cache::resize(char rw, uint64_t tag, uint64_t index, bool compressed, sim_stats_t* stats, uint64_t* outWBAddrs) {
+    if (m_SetSegments == nullptr) {
+        return 0;
+    }
+    cache_entry_t* block = block_in_cache(tag, index);
+    if (block == nullptr || block->half == compressed) {
+        return 0;
+    }
+
+    uint32_t numWB = 0;
+    if (compressed) {
+        m_SetSegments[index]--;
     } else {
-        installBlock.timestamp = m_TimestepCounter;
-        m_TimestepCounter++;
+        cache_entry_t* set = &m_Entries[index*m_Associativity];
+        while (m_SetSegments[index] + 1 > m_SegmentsPerSet) {
+            cache_entry_t* victim = find_replacement_victim(index);
+            evict_block<L>(rw, tag, index, *victim, stats, outWBAddrs, &numWB);
+            m_SetSegments[index] -= victim->half ? 1 : 2;
+            //remove_block moves the set's last block into the victim's way
+            const bool movesBlock = block == &set[m_SetFill[index] - 1];
+            remove_block(index, victim);
+            if (movesBlock) {
+                block = victim;
+            }
+        }
+        m_SetSegments[index]++;
     }
+    block->half = compressed;
+    return numWB;
+}
 
-    if (outNeedsWB != nullptr) {
-        *outNeedsWB = needsWB;
+//Counts and reports the eviction of block to make room for tag, queueing its writeback if dirty.
+template <stats_level_t L>
+void Cache::evict_block(char rw, uint64_t tag, uint64_t index, const cache_entry_t& block, sim_stats_t* stats, uint64_t* outWBAddrs, uint32_t* numWB) {
+    const uint8_t level = m_IsL1 ? 1 : 2;
+    count_attack<L>(stats->num_evictions);
+    if (block.dirty && m_Config.write_strat == WRITE_STRAT_WBWA) {
+        if (outWBAddrs != nullptr) {
+            outWBAddrs[*numWB] = get_addr(block.tag, index);
+        }
+        (*numWB)++;
     }
-    if (outWBAddr != nullptr && needsWB) {
-        *outWBAddr = wbAddr;
+    sim_emit<L>(SIM_EVENT_EVICT, level, rw, get_addr(block.tag, index), block.tag, index, block.dirty);
+    HEATMAP_EVICT(level, index, get_addr(block.tag, index), get_addr(tag, index));
+}
+
+//Compressed cache: drops block from its set, moving the set's last valid block into its place so the
+//valid blocks stay the first m_SetFill[index].
+void Cache::remove_block(uint64_t index, cache_entry_t* block) {
+    cache_entry_t* set = &m_Entries[index*m_Associativity];
+    cache_entry_t* last = &set[m_SetFill[index] - 1];
+    index_erase(index, block - set);
+    if (last != block) {
+        index_erase(index, last - set);
+        *block = *last;
+        index_insert(index, block - set);
     }
+    last->valid = false;
+    last->dirty = false;
+    last->mru = false;
+    m_SetFill[index]--;
 }
 
 bool Cache::find_prefetch_target(uint64_t tag, uint64_t index, uint64_t* prefetch_tag, uint64_t* prefetch_index) {
-    const uint64_t indexBits = m_Config.c - m_Config.b - m_Config.s;
-    uint64_t tagIndex = (tag << indexBits) | index;
-    if (m_Config.prefetcher_disabled) {
+    uint64_t tagIndex = get_line_addr(tag, index);
+    //A compressed cache doesn't know the size of a line it wasn't asked for, so it never prefetches
+    if (m_Config.prefetcher_disabled || m_SetSegments != nullptr) {
         return false;
     } 
     
@@ -213,31 +372,36 @@ bool Cache::find_prefetch_target(uint64_t tag, uint64_t index, uint64_t* prefetc
         prefetch_loc = tagIndex + (tagIndex - m_PreviousMissLoc);
         m_PreviousMissLoc = tagIndex;
     }
-    *prefetch_index = prefetch_loc & get_mask(indexBits);
-    prefetch_loc >>= indexBits;
-    *prefetch_tag = prefetch_loc;
+    split_line_addr(prefetch_loc, prefetch_tag, prefetch_index);
     return true;
 }
 
+template <stats_level_t L>
 void Cache::prefetch_install(uint64_t tag, uint64_t index, sim_stats_t* stats) {
     if (block_in_cache(tag, index) != nullptr) {
         //NO PREFETCH
         return;
     }
 
-    #if DEBUG
-    uint64_t indexBits = m_Config.c - m_Config.b - m_Config.s;
-    uint64_t debugAddr = (((tag << indexBits) | index)<< m_Config.b);
-    printf("Prefetch block with address 0x%" PRIx64 " from memrory to L2\n", debugAddr);
-    #endif
+    sim_emit<L>(SIM_EVENT_PREFETCH, m_IsL1 ? 1 : 2, 'R', get_addr(tag, index), tag, index);
 
     uint64_t lowestTimestamp;
     bool lowestDefined;
     cache_entry_t& installBlock = find_eviction_block(index, &lowestDefined, &lowestTimestamp);
+    const bool evictsValid = installBlock.valid;
+    const uint64_t way = &installBlock - &m_Entries[index*m_Associativity];
+    if (evictsValid) {
+        HEATMAP_EVICT(m_IsL1 ? 1 : 2, index, get_addr(installBlock.tag, index), get_addr(tag, index));
+        index_erase(index, way);
+    }
+    if (!evictsValid && m_SetFill != nullptr) {
+        m_SetFill[index]++;
+    }
 
-    stats->prefetches_l2++;
+    count_full<L>(stats->prefetches_l2);
     installBlock.valid = true;
     installBlock.tag = tag;
+    index_insert(index, way);
     //Handle Replacement Policy Updates
     if (m_Config.replace_policy == REPLACE_POLICY_LFU) {
         if (m_Config.prefetch_insert_policy == INSERT_POLICY_LIP) {
@@ -247,41 +411,30 @@ void Cache::prefetch_install(uint64_t tag, uint64_t index, sim_stats_t* stats) {
             installBlock.mru = true;
         }
 
-        installBlock.useCounter = 0;
+        installBlock.repl = 0;
+    } else if (uses_rrpv()) {
+        //LIP inserts at distant re-reference, MIP like a demand miss
+        const uint64_t rrpv = m_Config.prefetch_insert_policy == INSERT_POLICY_LIP ? RRPV_MAX : get_rrpv_insert();
+        set_rrpv(index, way, rrpv);
     } else {
         if (m_Config.prefetch_insert_policy == INSERT_POLICY_LIP && lowestDefined) {
-            //LIP
-            installBlock.timestamp = lowestTimestamp-1;
+            //LIP: below every valid block. A valid victim was the lowest, so its stamp is free.
+            if (!evictsValid && lowestTimestamp == 0) {
+                renumber_lru(index);
+                lowestTimestamp = 1;
+            }
+            installBlock.repl = evictsValid ? lowestTimestamp : lowestTimestamp-1;
         } else {
             //MIP
-            installBlock.timestamp = m_TimestepCounter;
+            installBlock.repl = next_lru_stamp(index);
         }
-
-        m_TimestepCounter++;
     }
  
 }
 
 void Cache::parse_addr(uint64_t addr, uint64_t* tag, uint64_t* index/*, uint64_t* offset*/) {
-    uint64_t tempAddr = addr;
     //*offset = addr & get_mask(m_Config.b);  //Block offset doesn't actually matter for simulation.
-    tempAddr >>= m_Config.b;
-    uint64_t indexBits = m_Config.c - m_Config.b - m_Config.s;
-    *index = tempAddr & get_mask(indexBits);
-    tempAddr >>= indexBits;
-
-    //Right shift has some weird artifacts sometimes due to 1 filling, so we mask the tag anyway
-    //uint64_t tagBits = ADDR_SIZE-(m_Config.c-m_Config.s);   //C-S = bits in index + offset.
-    //*tag = addr & get_mask(tagBits);
-    *tag = tempAddr;
-
-#if DEBUG
-if (m_IsL1) {
-    printf("L1 decomposed address 0x%" PRIx64 " -> Tag: 0x%" PRIx64 " and Index: 0x%" PRIx64 "\n", addr, *tag, *index);
-} else {
-    printf("L2 decomposed address 0x%" PRIx64 " -> Tag: 0x%" PRIx64 " and Index: 0x%" PRIx64 "\n", addr, *tag, *index);
-}
-#endif
+    split_line_addr(addr >> m_Config.b, tag, index);
 }
 
 double Cache::get_hit_time() {
@@ -309,6 +462,10 @@ bool Cache::disabled() {
     return m_Config.disabled;
 }
 
+uint64_t Cache::get_num_sets() {
+    return m_nSets;
+}
+
 void Cache::print_contents() {
     const uint64_t numBlocks = m_nSets*m_Associativity;
     for (size_t i = 0; i < numBlocks; i++) {
@@ -317,58 +474,75 @@ void Cache::print_contents() {
 }
 
 cache_entry_t& Cache::find_eviction_block(uint64_t index, bool* outLowestDefined, uint64_t* outLowestTimestamp) {
-    bool foundEmptyBlock = false;
-    bool lowestDefined = false;
-    uint64_t lowestTimestamp;
-    uint64_t lowestCounter;
-    cache_entry_t* evictBlock;
-    for (uint32_t b = index*m_Associativity; b < (index+1)*m_Associativity; b++) {
-        cache_entry_t& block = m_Entries[b];
-        if (!block.valid) {
-            //Install in empty block
-            evictBlock = &block;
-            foundEmptyBlock = true;
-        } else {
-            bool foundNewEvictBlock = false;
-            if (m_Config.replace_policy == REPLACE_POLICY_LFU) {
-                //LFU Replacement
-                if (!block.mru) {
-                    if (!lowestDefined || block.useCounter < lowestCounter) {
-                        lowestDefined = true;
-                        lowestCounter = block.useCounter;
-                        foundNewEvictBlock = true;
-                    } else if (block.useCounter == lowestCounter && block.tag < evictBlock->tag) {
-                        foundNewEvictBlock = true;
-                    }
-                }
-            } else {
-                //LRU Replacement
-                if (!lowestDefined || block.timestamp < lowestTimestamp) {
-                    //evict block with lowest timestamp
-                    lowestDefined = true;
-                    lowestTimestamp = block.timestamp;
-                    foundNewEvictBlock = true;
-                }
-            }
-
-            if (!foundEmptyBlock && foundNewEvictBlock) {
-                evictBlock = &block;
-            }
+    cache_entry_t* set = &m_Entries[index*m_Associativity];
+    if (uses_rrpv()) {
+        if (outLowestDefined != nullptr) {
+            *outLowestDefined = false;
         }
+        return set[find_rrpv_victim(index)];
+    }
+
+    //Install in the first empty block
+    const uint64_t fill = m_SetFill[index];
+    if (fill < m_Associativity && outLowestDefined == nullptr && outLowestTimestamp == nullptr) {
+        return set[fill];
     }
 
+    cache_entry_t* evictBlock = find_replacement_victim(index);
     if (outLowestDefined != nullptr) {
-        *outLowestDefined = lowestDefined;
+        *outLowestDefined = evictBlock != nullptr;
+    }
+    if (outLowestTimestamp != nullptr && evictBlock != nullptr) {
+        *outLowestTimestamp = evictBlock->repl;
+    }
+    if (fill < m_Associativity) {
+        return set[fill];
     }
-    if (outLowestTimestamp != nullptr) {
-        *outLowestTimestamp = lowestTimestamp;
+    //A direct-mapped LFU set only holds its MRU block
+    return evictBlock != nullptr ? *evictBlock : set[0];
+}
+
+//LRU/LFU: the valid block replacement would evict next, or nullptr if the set is empty.
+cache_entry_t* Cache::find_replacement_victim(uint64_t index) {
+    cache_entry_t* set = &m_Entries[index*m_Associativity];
+    const uint64_t fill = m_SetFill[index];
+    cache_entry_t* evictBlock = nullptr;
+    if (m_Config.replace_policy == REPLACE_POLICY_LFU) {
+        //LFU Replacement, ties go to the lower tag
+        for (uint64_t b = 0; b < fill; b++) {
+            cache_entry_t& block = set[b];
+            if (!block.mru && (evictBlock == nullptr || block.repl < evictBlock->repl || 
+                    (block.repl == evictBlock->repl && block.tag < evictBlock->tag))) {
+                evictBlock = &block;
+            }
+        }
+    } else {
+        //LRU Replacement: evict block with lowest timestamp
+        uint64_t lowest = UINT64_MAX;
+        for (uint64_t b = 0; b < fill; b++) {
+            if (set[b].repl < lowest) {
+                lowest = set[b].repl;
+                evictBlock = &set[b];
+            }
+        }
     }
-    return *evictBlock;
+    return evictBlock;
 }
 
 cache_entry_t* Cache::block_in_cache(uint64_t tag, uint64_t index) {
-    for (uint32_t b = index*m_Associativity; b < (index+1)*m_Associativity; b++) {
-        cache_entry_t& block = m_Entries[b];
+    cache_entry_t* set = &m_Entries[index*m_Associativity];
+    if (m_TagIndex != nullptr) {
+        const uint16_t* slots = &m_TagIndex[index*m_IndexSlots];
+        for (uint64_t i = index_home(tag); slots[i] != 0; i = (i + 1) & (m_IndexSlots - 1)) {
+            if (set[slots[i] - 1].tag == tag) {
+                return &set[slots[i] - 1];
+            }
+        }
+        return nullptr;
+    }
+
+    for (uint64_t b = 0; b < m_Associativity; b++) {
+        cache_entry_t& block = set[b];
         if (block.valid && block.tag == tag) {
             return &block;
         }
@@ -377,13 +551,211 @@ cache_entry_t* Cache::block_in_cache(uint64_t tag, uint64_t index) {
     return nullptr;
 }
 
+//Slot of the tag index where tag's probe sequence starts (Fibonacci hashing).
+uint64_t Cache::index_home(uint64_t tag) {
+    return (tag * 0x9E3779B97F4A7C15ULL) >> m_IndexShift;
+}
+
+//Indexes the valid block at way of set index under its tag.
+void Cache::index_insert(uint64_t index, uint64_t way) {
+    if (m_TagIndex == nullptr) {
+        return;
+    }
+    uint16_t* slots = &m_TagIndex[index*m_IndexSlots];
+    uint64_t i = index_home(m_Entries[index*m_Associativity + way].tag);
+    while (slots[i] != 0) {
+        i = (i + 1) & (m_IndexSlots - 1);
+    }
+    slots[i] = (uint16_t) (way + 1);
+}
+
+//Drops the block at way of set index from the tag index. Must run before the block's tag changes.
+void Cache::index_erase(uint64_t index, uint64_t way) {
+    if (m_TagIndex == nullptr) {
+        return;
+    }
+    const cache_entry_t* set = &m_Entries[index*m_Associativity];
+    uint16_t* slots = &m_TagIndex[index*m_IndexSlots];
+    const uint64_t mask = m_IndexSlots - 1;
+    uint64_t hole = index_home(set[way].tag);
+    while (slots[hole] != way + 1) {
+        hole = (hole + 1) & mask;
+    }
+
+    //Backward shift: move up every later entry of the run whose home isn't cyclically in (hole, i]
+    for (uint64_t i = (hole + 1) & mask; slots[i] != 0; i = (i + 1) & mask) {
+        const uint64_t home = index_home(set[slots[i] - 1].tag);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole] = 0;
+}
+
+//Line address -> (tag, index). The slice comes from XOR-hashing the line address, and the set within
+//the slice is taken from the low bits, optionally XOR-folded with the low tag bits.
+void Cache::split_line_addr(uint64_t lineAddr, uint64_t* tag, uint64_t* index) {
+    uint64_t set = lineAddr & get_mask(m_SetBits);
+    *tag = (lineAddr >> m_SetBits) & get_mask(CACHE_TAG_BITS);
+    if (m_Config.hashed_index) {
+        set ^= *tag & get_mask(m_SetBits);
+    }
+
+    uint64_t slice = 0;
+    for (uint64_t i = 0; (1ULL << i) < m_nSlices; i++) {
+        slice |= (uint64_t) __builtin_parityll(lineAddr & m_SliceMasks[i]) << i;
+    }
+    *index = slice * m_SetsPerSlice + set;
+}
+
+uint64_t Cache::get_line_addr(uint64_t tag, uint64_t index) {
+    uint64_t set = index & get_mask(m_SetBits);
+    if (m_Config.hashed_index) {
+        set ^= tag & get_mask(m_SetBits);
+    }
+    return (tag << m_SetBits) | set;
+}
+
 uint64_t Cache::get_addr(uint64_t tag, uint64_t index) {
-    return (tag << (m_Config.c - m_Config.s)) | (index << m_Config.b);
+    return get_line_addr(tag, index) << m_Config.b;
 }
 
 void Cache::clear_mru(uint64_t index) {
-    for (uint32_t b = index*m_Associativity; b < (index+1)*m_Associativity; b++) {
-        cache_entry_t& block = m_Entries[b];
-        block.mru = false;
+    cache_entry_t* set = &m_Entries[index*m_Associativity];
+    for (uint64_t b = 0; b < m_Associativity; b++) {
+        set[b].mru = false;
+    }
+}
+
+uint64_t Cache::next_lru_stamp(uint64_t index) {
+    if (m_SetClocks[index] == get_repl_max()) {
+        renumber_lru(index);
+    }
+    return ++m_SetClocks[index];
+}
+
+//Restamps the valid blocks of a set 1..n in LRU order, leaving stamp 0 free for an LIP insert.
+void Cache::renumber_lru(uint64_t index) {
+    //Per thread, so different sets of a shared LLC can be renumbered at once
+    static thread_local std::vector<uint32_t> scratch;
+    scratch.resize(m_Associativity);
+
+    cache_entry_t* set = &m_Entries[index*m_Associativity];
+    uint64_t n = 0;
+    for (uint64_t b = 0; b < m_Associativity; b++) {
+        if (set[b].valid) {
+            scratch[n++] = (uint32_t) ((set[b].repl << 16) | b);
+        }
+    }
+    std::sort(scratch.begin(), scratch.begin() + n);
+    for (uint64_t i = 0; i < n; i++) {
+        set[scratch[i] & 0xFFFF].repl = i+1;
+    }
+    m_SetClocks[index] = n;
+}
+
+bool Cache::uses_rrpv() {
+    return m_Config.replace_policy == REPLACE_POLICY_SRRIP || 
+        m_Config.replace_policy == REPLACE_POLICY_BRRIP ||
+        m_Config.replace_policy == REPLACE_POLICY_QLRU;
+}
+
+//Planes of a set, in order: valid, RRPV high bits, RRPV low bits.
+uint64_t* Cache::get_planes(uint64_t index) {
+    return &m_Planes[index * 3 * m_PlaneWords];
+}
+
+//Bits of a plane word that correspond to real ways.
+uint64_t Cache::get_plane_mask(uint64_t word) {
+    const uint64_t waysInWord = m_Associativity - word*64;
+    return waysInWord >= 64 ? ~0ULL : get_mask(waysInWord);
+}
+
+//Returns the first empty way, else the first way with RRPV 3, aging the whole set until one exists.
+uint64_t Cache::find_rrpv_victim(uint64_t index) {
+    uint64_t* valid = get_planes(index);
+    uint64_t* hi = valid + m_PlaneWords;
+    uint64_t* lo = hi + m_PlaneWords;
+
+    for (uint64_t w = 0; w < m_PlaneWords; w++) {
+        const uint64_t empty = ~valid[w] & get_plane_mask(w);
+        if (empty != 0) {
+            return w*64 + __builtin_ctzll(empty);
+        }
     }
-}
\ No newline at end of file
+
+    while (true) {
+        for (uint64_t w = 0; w < m_PlaneWords; w++) {
+            const uint64_t distant = hi[w] & lo[w];
+            if (distant != 0) {
+                return w*64 + __builtin_ctzll(distant);
+            }
+        }
+
+        //Saturating increment of every RRPV: 0->1, 1->2, 2->3, 3->3
+        for (uint64_t w = 0; w < m_PlaneWords; w++) {
+            const uint64_t h = hi[w];
+            const uint64_t l = lo[w];
+            hi[w] = h | l;
+            lo[w] = (~l | h) & valid[w];
+        }
+    }
+}
+
+uint64_t Cache::get_rrpv(uint64_t index, uint64_t way) {
+    const uint64_t* hi = get_planes(index) + m_PlaneWords;
+    const uint64_t* lo = hi + m_PlaneWords;
+    const uint64_t bit = way % 64;
+    return (((hi[way/64] >> bit) & 1) << 1) | ((lo[way/64] >> bit) & 1);
+}
+
+//Sets the way's RRPV and marks it valid.
+void Cache::set_rrpv(uint64_t index, uint64_t way, uint64_t rrpv) {
+    uint64_t* valid = get_planes(index);
+    uint64_t* hi = valid + m_PlaneWords;
+    uint64_t* lo = hi + m_PlaneWords;
+    const uint64_t w = way / 64;
+    const uint64_t bit = 1ULL << (way % 64);
+    valid[w] |= bit;
+    hi[w] = (rrpv & 2) ? (hi[w] | bit) : (hi[w] & ~bit);
+    lo[w] = (rrpv & 1) ? (lo[w] | bit) : (lo[w] & ~bit);
+}
+
+void Cache::update_rrpv_hit(uint64_t index, uint64_t way) {
+    if (m_Config.replace_policy == REPLACE_POLICY_QLRU) {
+        //H11: 3 -> 1, 2 -> 1, 1 -> 0, 0 -> 0
+        set_rrpv(index, way, get_rrpv(index, way) >> 1);
+    } else {
+        //Hit priority: predict near-immediate re-reference
+        set_rrpv(index, way, 0);
+    }
+}
+
+uint64_t Cache::get_rrpv_insert() {
+    switch (m_Config.replace_policy) {
+    case REPLACE_POLICY_BRRIP: {
+        //Load and store rather than an atomic increment: concurrent inserts into a shared LLC may lose a
+        //count, which only shifts the 1-in-BRRIP_EPSILON pattern
+        const uint64_t counter = m_BrripCounter.load(std::memory_order_relaxed);
+        m_BrripCounter.store(counter + 1, std::memory_order_relaxed);
+        return (counter % BRRIP_EPSILON == 0) ? RRPV_MAX - 1 : RRPV_MAX;
+    }
+    case REPLACE_POLICY_QLRU:
+        return 1;
+    default:
+        return RRPV_MAX - 1;
+    }
+}
+
+//Simulator entry points for every stats level
+#define INSTANTIATE_CACHE(L) \
+    template bool Cache::access<L>(char, uint64_t, uint64_t, sim_stats_t*); \
+    template uint32_t Cache::install<L>(char, uint64_t, uint64_t, sim_stats_t*, uint64_t*, bool); \
+    template uint32_t Cache::resize<L>(char, uint64_t, uint64_t, bool, sim_stats_t*, uint64_t*); \
+    template void Cache::prefetch_install<L>(uint64_t, uint64_t, sim_stats_t*);
+
+INSTANTIATE_CACHE(STATS_LEVEL_NONE)
+INSTANTIATE_CACHE(STATS_LEVEL_ATTACK)
+INSTANTIATE_CACHE(STATS_LEVEL_FULL)
+INSTANTIATE_CACHE(STATS_LEVEL_TRACE)
@@ -4,55 +4,133 @@
 //Simulate Last Level Cache
 //Assume 8 way set associative cache of 32KB (Actual is 32MB)
 //512 cache lines @ 64 bytes per line
+//A real-size LLC can be modeled by raising C and setting the slice count, e.g. C=25, S=4, 16 slices.
 
 #ifndef CACHE_HPP
 #define CACHE_HPP
 
+#include <atomic>
 #include <inttypes.h>
 #include <stddef.h>
 
 #include "cache_sim.hpp"
 
+#define CACHE_MAX_SLICE_BITS 6  //Up to 64 slices
+
+#define RRPV_MAX 3
+#define BRRIP_EPSILON 32
+
+#define CACHE_TAG_BITS 47
+#define CACHE_REPL_BITS 13  //LRU stamps wrap within this, so LRU supports up to 4096 ways
+#define CACHE_INDEX_MIN_WAYS 16  //Sets with more ways than this find tags through a per-set hash index
+#define CACHE_MAX_WRITEBACKS 2  //A compressed cache may evict two half-way lines for one full line
+
+//Per-line metadata packed into 8 bytes so real-size LLCs stay resident in the host's caches.
 typedef struct cache_entry {
-    uint64_t tag;
-    uint64_t timestamp;
-    bool valid;
-    bool dirty; //Only used for WB/WA Policy.
+    uint64_t tag : CACHE_TAG_BITS;
+    uint64_t valid : 1;
+    uint64_t dirty : 1; //Only used for WB/WA Policy.
 
     //LFU
-    uint64_t useCounter;
-    bool mru;
+    uint64_t mru : 1;
+
+    //Compressed cache: the line takes one of its way's two segments
+    uint64_t half : 1;
+
+    //LRU: stamp from the set's clock (lowest = LRU). LFU: saturating use counter.
+    uint64_t repl : CACHE_REPL_BITS;
 } cache_entry_t;
 
+static_assert(sizeof(cache_entry_t) == 8, "cache_entry_t must pack into 8 bytes");
+
 //l1 and l2 will use same cache struct with different configurations.
 class Cache {
 private:
     const cache_config_t& m_Config;
     uint64_t m_nSets; 
     uint64_t m_Associativity;
-    uint64_t m_TimestepCounter;
     const bool m_IsL1; //This is purely for accessing the right statistics.
     cache_entry_t* m_Entries;  //2D set-major array to represent set associativity.
 
+    //Slicing: index = slice * m_SetsPerSlice + set within the slice
+    uint64_t m_nSlices;
+    uint64_t m_SetsPerSlice;
+    uint64_t m_SetBits;
+    uint64_t m_SliceMasks[CACHE_MAX_SLICE_BITS];
+
+    //LRU/LFU: valid ways per set. Lines are never invalidated and empty ways are filled in order,
+    //so the valid ways are always the first m_SetFill[index] of the set.
+    uint32_t* m_SetFill;
+
+    //LRU: per-set clock handing out the stamps in cache_entry_t::repl. When it runs out of bits the
+    //set's stamps are renumbered by rank, which keeps hits O(1) regardless of associativity.
+    uint16_t* m_SetClocks;
+
+    //Compressed cache: segments in use per set, out of m_SegmentsPerSet (two per way). m_Associativity
+    //counts tags, which is also two per way, so a set can hold up to twice as many compressed lines.
+    uint32_t* m_SetSegments;
+    uint64_t m_SegmentsPerSet;
+
+    //RRIP/QLRU: per set, bit-planes of the valid bits and the high and low bits of each way's 2-bit RRPV,
+    //m_PlaneWords words each. Victim search and aging are word ops over the planes.
+    uint64_t m_PlaneWords;
+    uint64_t* m_Planes;
+    std::atomic<uint64_t> m_BrripCounter;   //Atomic only so a shared LLC's sets can be used concurrently
+
+    //Sets wider than CACHE_INDEX_MIN_WAYS: per set, an open-addressed table of m_IndexSlots (at least twice
+    //the ways) holding way+1 of each valid block at its tag's hash, 0 for empty. Linear probing with
+    //backward-shift deletion, so there are no tombstones. Per set, so a shared LLC's sets stay independent.
+    uint64_t m_IndexSlots;
+    uint64_t m_IndexShift;
+    uint16_t* m_TagIndex;
+
     //Strided Prefetch
     uint64_t m_PreviousMissLoc;
 
 public:
     Cache(const cache_config_t& config, bool isL1);
+    Cache(const Cache& other, const cache_config_t& config);
+    ~Cache();
+    template <stats_level_t L = SIM_STATS_LEVEL>
     bool access(char rw, uint64_t tag, uint64_t offset, sim_stats_t* stats);
-    void install(char rw, uint64_t tag, uint64_t index, sim_stats_t* stats, bool* outNeedsWB=nullptr, uint64_t* outWBAddr=nullptr);
+    template <stats_level_t L = SIM_STATS_LEVEL>
+    uint32_t install(char rw, uint64_t tag, uint64_t index, sim_stats_t* stats, uint64_t* outWBAddrs=nullptr, bool compressed=false);
     bool find_prefetch_target(uint64_t tag, uint64_t index, uint64_t* prefetch_tag, uint64_t* prefetch_index);
+    template <stats_level_t L = SIM_STATS_LEVEL>
+    uint32_t resize(char rw, uint64_t tag, uint64_t index, bool compressed, sim_stats_t* stats, uint64_t* outWBAddrs=nullptr);
+    template <stats_level_t L = SIM_STATS_LEVEL>
     void prefetch_install(uint64_t tag, uint64_t index, sim_stats_t* stats);
     void parse_addr(uint64_t addr, uint64_t* tag, uint64_t* index/*, uint64_t* offset*/);
     double get_hit_time();
     bool disabled();
+    uint64_t get_num_sets();
 
     void print_contents();
 private:
     cache_entry_t& find_eviction_block(uint64_t index, bool* outLowestDefined=nullptr, uint64_t* outLowestTimestamp=nullptr);
+    cache_entry_t* find_replacement_victim(uint64_t index);
+    template <stats_level_t L>
+    void evict_block(char rw, uint64_t tag, uint64_t index, const cache_entry_t& block, sim_stats_t* stats, uint64_t* outWBAddrs, uint32_t* numWB);
+    void remove_block(uint64_t index, cache_entry_t* block);
     cache_entry_t* block_in_cache(uint64_t tag, uint64_t index);
+    uint64_t index_home(uint64_t tag);
+    void index_insert(uint64_t index, uint64_t way);
+    void index_erase(uint64_t index, uint64_t way);
+    void split_line_addr(uint64_t lineAddr, uint64_t* tag, uint64_t* index);
+    uint64_t get_line_addr(uint64_t tag, uint64_t index);
     uint64_t get_addr(uint64_t tag, uint64_t index);
     void clear_mru(uint64_t index);
+    uint64_t next_lru_stamp(uint64_t index);
+    void renumber_lru(uint64_t index);
+
+    bool uses_rrpv();
+    uint64_t* get_planes(uint64_t index);
+    uint64_t get_plane_mask(uint64_t word);
+    uint64_t find_rrpv_victim(uint64_t index);
+    uint64_t get_rrpv(uint64_t index, uint64_t way);
+    void set_rrpv(uint64_t index, uint64_t way, uint64_t rrpv);
+    void update_rrpv_hit(uint64_t index, uint64_t way);
+    uint64_t get_rrpv_insert();
 };
 
 const double K_L1[] = {1, 0.15, 0.15};
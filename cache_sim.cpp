@@ -2,84 +2,273 @@
 //L2 can be disabled to simulate a single cache.
 
 #include "cache.hpp"
+#include "heatmap.hpp"
+#include "hostprof.hpp"
+#include "latency.hpp"
+#include "timing.hpp"
+#include "sim_trace.hpp"
 
-#define HIT_TIME 30.5
-#define MISS_TIME 40.7
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
-#if DEBUG
-#include <cstdio>
-#endif
+#define SAMPLE_SLOT_NONE UINT32_MAX
+#define CI_95_Z 1.96
 
 static Cache* l1;
 static Cache* l2;
 static uint64_t time;
+static sim_phase_t phase;
+
+//Set Sampling
+static uint64_t num_sampled;        //0 when every set is simulated
+static uint64_t num_llc_sets;
+static uint32_t* sample_slot;       //LLC set index -> slot in the arrays below
+static uint64_t* slot_evictions;
+static double* slot_walk_time;
+
+namespace {
+    //The LLC is the last enabled level of the hierarchy.
+    inline Cache* get_llc() {
+        return l2->disabled() ? l1 : l2;
+    }
+
+    //splitmix64 finalizer, used to pick a deterministic but well-spread subset of sets.
+    inline uint64_t hash_set(uint64_t index) {
+        uint64_t x = index + 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    inline uint32_t get_sample_slot(uint64_t addr) {
+        uint64_t tag, index;
+        get_llc()->parse_addr(addr, &tag, &index);
+        return sample_slot[index];
+    }
+
+    void setup_sampling(uint64_t sample_sets) {
+        num_llc_sets = get_llc()->get_num_sets();
+        num_sampled = sample_sets < num_llc_sets ? sample_sets : 0;
+        if (num_sampled == 0) {
+            return;
+        }
+
+        std::vector<uint64_t> sets(num_sampled);
+        sim_pick_llc_sets(num_sampled, sets.data());
+        sample_slot = new uint32_t[num_llc_sets];
+        std::fill(sample_slot, sample_slot + num_llc_sets, SAMPLE_SLOT_NONE);
+        for (uint64_t i = 0; i < num_sampled; i++) {
+            sample_slot[sets[i]] = (uint32_t) i;
+        }
+
+        slot_evictions = new uint64_t[num_sampled]();
+        slot_walk_time = new double[num_sampled]();
+    }
+
+    //Half-width of the 95% confidence interval of the population total, given per-set sample values.
+    template <typename T>
+    double total_ci(const T* values) {
+        double mean = 0.0;
+        for (uint64_t i = 0; i < num_sampled; i++) {
+            mean += values[i];
+        }
+        mean /= num_sampled;
+
+        double var = 0.0;
+        for (uint64_t i = 0; i < num_sampled; i++) {
+            var += (values[i] - mean) * (values[i] - mean);
+        }
+        var = num_sampled > 1 ? var / (num_sampled - 1) : 0.0;
+
+        const double fpc = 1.0 - (double) num_sampled / num_llc_sets;
+        return CI_95_Z * num_llc_sets * std::sqrt(var / num_sampled * fpc);
+    }
+}
 
 void sim_setup(sim_config_t *config) {
     l1 = new Cache(config->l1_config, true);
     l2 = new Cache(config->l2_config, false);
     time = 0;
-}
+    phase = SIM_PHASE_WARMUP;
+    HOSTPROF_BEGIN(HOSTPROF_WARMUP);
+    #ifdef SIM_HEATMAP
+    heatmap_set_phase(phase);
+    #endif
+    setup_sampling(config->sample_sets);
 
-//Returns the time required to access
-double sim_access(char rw, uint64_t addr, sim_stats_t* stats) {
     #if DEBUG
-    printf("Time: %" PRIu64 ". Address: 0x%" PRIx64 ". Read/Write: %c\n", time, addr, rw);
+    if (sim_event_hook == nullptr) {
+        sim_set_event_hook(sim_trace_print, nullptr);
+    }
+    #endif
+}
+
+void sim_set_phase(sim_phase_t newPhase) {
+    HOSTPROF_END((hostprof_region_t) phase);
+    HOSTPROF_BEGIN((hostprof_region_t) newPhase);
+    phase = newPhase;
+    #ifdef SIM_HEATMAP
+    heatmap_set_phase(newPhase);
     #endif
+}
+
+sim_phase_t sim_get_phase() {
+    return phase;
+}
+
+uint64_t sim_llc_num_sets() {
+    return get_llc()->get_num_sets();
+}
+
+//A deterministic but well-spread subset of count LLC sets: those with the smallest hashes. Spacing
+//them evenly instead would alias with the two-line windows. Returns the number of sets written.
+uint64_t sim_pick_llc_sets(uint64_t count, uint64_t* outSets) {
+    const uint64_t sets = get_llc()->get_num_sets();
+    count = std::min(count, sets);
+    std::vector<std::pair<uint64_t, uint64_t>> order(sets);
+    for (uint64_t i = 0; i < sets; i++) {
+        order[i] = std::make_pair(hash_set(i), i);
+    }
+    std::nth_element(order.begin(), order.begin() + count, order.end());
+
+    for (uint64_t i = 0; i < count; i++) {
+        outSets[i] = order[i].second;
+    }
+    return count;
+}
+
+//LLC set index of an address, under the current sim_setup.
+uint64_t sim_llc_set(uint64_t addr) {
+    uint64_t tag, index;
+    get_llc()->parse_addr(addr, &tag, &index);
+    return index;
+}
+
+//Returns false if the address maps to an LLC set that is not being simulated.
+bool sim_is_sampled(uint64_t addr) {
+    return num_sampled == 0 || get_sample_slot(addr) != SAMPLE_SLOT_NONE;
+}
+
+//Returns the time required to access
+template <stats_level_t L>
+double sim_access_at(char rw, uint64_t addr, sim_stats_t* stats, bool compressed) {
+    if (L == STATS_LEVEL_TRACE) {
+        sim_event_time = time;
+    }
+    sim_emit<L>(SIM_EVENT_ACCESS, 0, rw, addr);
+
+    //Drop accesses to unsampled sets before touching any cache state
+    uint32_t slot = 0;
+    if (num_sampled != 0) {
+        slot = get_sample_slot(addr);
+        if (slot == SAMPLE_SLOT_NONE) {
+            return 0.0;
+        }
+    }
+    const uint64_t evictionsBefore = stats->num_evictions;
+
     if (rw == 'R') {
-        stats->reads++;
+        count_full<L>(stats->reads);
     } else {
-        stats->writes++;
+        count_full<L>(stats->writes);
     }
 
     uint64_t l1_tag, l1_index;
     l1->parse_addr(addr, &l1_tag, &l1_index);
+    sim_emit<L>(SIM_EVENT_DECOMPOSE, 1, rw, addr, l1_tag, l1_index);
     bool hit = true;
-    if (!l1->access(rw, l1_tag, l1_index, stats)) {
+    uint64_t wbAddrs[CACHE_MAX_WRITEBACKS]; //Note: these addresses will always have a block offset of 0.
+    uint32_t numWritebacks;
+    if (l1->access<L>(rw, l1_tag, l1_index, stats)) {
+        //A compressed cache may have to resize the line, if its window's compressibility changed
+        numWritebacks = l1->resize<L>(rw, l1_tag, l1_index, compressed, stats, wbAddrs);
+    } else {
 
         //Access L2 cache on L1 miss
         //NOTE: Write miss is still a read for L2 due to WB policy. 
         uint64_t l2_tag, l2_index;
         l2->parse_addr(addr, &l2_tag, &l2_index);
-        if (!l2->access('R', l2_tag, l2_index, stats) && !l2->disabled()) {
-            l2->install('R', l2_tag, l2_index, stats);
+        sim_emit<L>(SIM_EVENT_DECOMPOSE, 2, 'R', addr, l2_tag, l2_index);
+        if (l2->access<L>('R', l2_tag, l2_index, stats)) {
+            l2->resize<L>('R', l2_tag, l2_index, compressed, stats);
+        } else if (!l2->disabled()) {
+            l2->install<L>('R', l2_tag, l2_index, stats, nullptr, compressed);
 
             uint64_t prefetch_tag, prefetch_index;
             if (l2->find_prefetch_target(l2_tag, l2_index, &prefetch_tag, &prefetch_index)) {
-                l2->prefetch_install(prefetch_tag, prefetch_index, stats);
+                l2->prefetch_install<L>(prefetch_tag, prefetch_index, stats);
             }
         }
 
-        bool needsWriteback;
-        uint64_t wbAddr; //Note: this address will always have a block offset of 0.
-        l1->install(rw, l1_tag, l1_index, stats, &needsWriteback, &wbAddr);
-        if (needsWriteback) {
-            #if DEBUG
-            printf("Writing back dirty block with address 0x%" PRIx64 " to L2\n", wbAddr);
-            #endif
-            uint64_t l2_wb_tag, l2_wb_index;
-            l2->parse_addr(wbAddr, &l2_wb_tag, &l2_wb_index);
-            l2->access('W', l2_wb_tag, l2_wb_index, stats);
-        }
-
+        numWritebacks = l1->install<L>(rw, l1_tag, l1_index, stats, wbAddrs, compressed);
         hit = false;
     }
 
+    for (uint32_t w = 0; w < numWritebacks; w++) {
+        const uint64_t wbAddr = wbAddrs[w];
+        sim_emit<L>(SIM_EVENT_WRITEBACK, 1, 'W', wbAddr);
+        uint64_t l2_wb_tag, l2_wb_index;
+        l2->parse_addr(wbAddr, &l2_wb_tag, &l2_wb_index);
+        sim_emit<L>(SIM_EVENT_DECOMPOSE, 2, 'W', wbAddr, l2_wb_tag, l2_wb_index);
+        l2->access<L>('W', l2_wb_tag, l2_wb_index, stats);
+    }
+
     time++;
-    #if DEBUG
-    printf("\n");
-    #endif
 
-    if (hit) {
-        return HIT_TIME;
-    } else {
-        return HIT_TIME + MISS_TIME;
+    double accessTime = hit ? HIT_TIME : HIT_TIME + MISS_TIME;
+    if (timing_model_active) {
+        accessTime = timing_sample(hit);
+    }
+    phase_latency_t* latency = latency_current;
+    if (latency != nullptr) {
+        hdr_hist_record(hit ? &latency->hit[phase] : &latency->miss[phase], accessTime);
+    }
+    if (num_sampled != 0) {
+        slot_evictions[slot] += stats->num_evictions - evictionsBefore;
+        if (phase == SIM_PHASE_WALK) {
+            slot_walk_time[slot] += accessTime;
+        }
     }
+
+    return accessTime;
+}
+
+template double sim_access_at<STATS_LEVEL_NONE>(char, uint64_t, sim_stats_t*, bool);
+template double sim_access_at<STATS_LEVEL_ATTACK>(char, uint64_t, sim_stats_t*, bool);
+template double sim_access_at<STATS_LEVEL_FULL>(char, uint64_t, sim_stats_t*, bool);
+template double sim_access_at<STATS_LEVEL_TRACE>(char, uint64_t, sim_stats_t*, bool);
+
+double sim_access(char rw, uint64_t addr, sim_stats_t* stats) {
+    return sim_access_at<SIM_STATS_LEVEL>(rw, addr, stats);
+}
+
+//Accesses a line holding a compressed window, which a compressed LLC stores in half a way.
+double sim_access_compressed(char rw, uint64_t addr, sim_stats_t* stats) {
+    return sim_access_at<SIM_STATS_LEVEL>(rw, addr, stats, true);
+}
+
+//Accesses a line of a precomputed line list, compressed if it is marked SIM_LINE_COMPRESSED.
+template <stats_level_t L>
+double sim_access_line_at(char rw, uint64_t line, sim_stats_t* stats) {
+    return sim_access_at<L>(rw, line & ~SIM_LINE_COMPRESSED, stats, (line & SIM_LINE_COMPRESSED) != 0);
+}
+
+template double sim_access_line_at<STATS_LEVEL_NONE>(char, uint64_t, sim_stats_t*);
+template double sim_access_line_at<STATS_LEVEL_ATTACK>(char, uint64_t, sim_stats_t*);
+template double sim_access_line_at<STATS_LEVEL_FULL>(char, uint64_t, sim_stats_t*);
+template double sim_access_line_at<STATS_LEVEL_TRACE>(char, uint64_t, sim_stats_t*);
+
+double sim_access_line(char rw, uint64_t line, sim_stats_t* stats) {
+    return sim_access_line_at<SIM_STATS_LEVEL>(rw, line, stats);
 }
 
 void sim_finish(sim_stats_t *stats) {
-    //Calculate stats
-    stats->hit_ratio_l1 = (double) stats->hits_l1 / stats->accesses_l1;
-    stats->miss_ratio_l1 = (double) stats->misses_l1 / stats->accesses_l1;
+    HOSTPROF_END((hostprof_region_t) phase);
+
+    //Calculate stats (below STATS_LEVEL_FULL no accesses are counted, so the ratios stay 0)
+    stats->hit_ratio_l1 = stats->accesses_l1 == 0 ? 0.0 : (double) stats->hits_l1 / stats->accesses_l1;
+    stats->miss_ratio_l1 = stats->accesses_l1 == 0 ? 0.0 : (double) stats->misses_l1 / stats->accesses_l1;
     // stats->read_hit_ratio_l2 = (double) stats->read_hits_l2 / stats->reads_l2;
     // stats->read_miss_ratio_l2 = (double) stats->read_misses_l2 / stats->reads_l2;
 
@@ -87,9 +276,87 @@ void sim_finish(sim_stats_t *stats) {
 
     stats->avg_access_time_l1 = HIT_TIME + stats->miss_ratio_l1 * MISS_TIME;
 
+    //Scale sampled results up to the whole LLC
+    stats->total_sets = num_llc_sets;
+    if (num_sampled != 0) {
+        const double scale = (double) num_llc_sets / num_sampled;
+        stats->sampled_sets = num_sampled;
+        stats->num_evictions = (uint64_t) std::llround(stats->num_evictions * scale);
+        stats->llc_walk_time *= scale;
+        stats->num_evictions_ci = total_ci(slot_evictions);
+        stats->llc_walk_time_ci = total_ci(slot_walk_time);
+
+        delete[] sample_slot;
+        delete[] slot_evictions;
+        delete[] slot_walk_time;
+        num_sampled = 0;
+    } else {
+        stats->sampled_sets = num_llc_sets;
+        stats->num_evictions_ci = 0.0;
+        stats->llc_walk_time_ci = 0.0;
+    }
+
     //Clear Memory
     delete l1;
     delete l2;
+    l1 = nullptr;
+    l2 = nullptr;
+}
+
+struct sim_snapshot {
+    sim_config_t config;
+    Cache* l1;
+    Cache* l2;
+    uint64_t time;
+    sim_phase_t phase;
+    sim_stats_t stats;
+    uint64_t num_sampled;
+    uint64_t num_llc_sets;
+    std::vector<uint32_t> sample_slot;
+    std::vector<uint64_t> slot_evictions;
+    std::vector<double> slot_walk_time;
+};
+
+sim_snapshot_t* sim_snapshot_take(const sim_config_t* config, const sim_stats_t* stats) {
+    sim_snapshot_t* snapshot = new sim_snapshot_t();
+    snapshot->config = *config;
+    snapshot->l1 = new Cache(*l1, snapshot->config.l1_config);
+    snapshot->l2 = new Cache(*l2, snapshot->config.l2_config);
+    snapshot->time = time;
+    snapshot->phase = phase;
+    snapshot->stats = *stats;
+    snapshot->num_sampled = num_sampled;
+    snapshot->num_llc_sets = num_llc_sets;
+    if (num_sampled != 0) {
+        snapshot->sample_slot.assign(sample_slot, sample_slot + num_llc_sets);
+        snapshot->slot_evictions.assign(slot_evictions, slot_evictions + num_sampled);
+        snapshot->slot_walk_time.assign(slot_walk_time, slot_walk_time + num_sampled);
+    }
+    return snapshot;
+}
+
+void sim_snapshot_restore(const sim_snapshot_t* snapshot, sim_stats_t* stats) {
+    l1 = new Cache(*snapshot->l1, snapshot->config.l1_config);
+    l2 = new Cache(*snapshot->l2, snapshot->config.l2_config);
+    time = snapshot->time;
+    phase = snapshot->phase;
+    *stats = snapshot->stats;
+    num_sampled = snapshot->num_sampled;
+    num_llc_sets = snapshot->num_llc_sets;
+    if (num_sampled != 0) {
+        sample_slot = new uint32_t[num_llc_sets];
+        slot_evictions = new uint64_t[num_sampled];
+        slot_walk_time = new double[num_sampled];
+        std::copy(snapshot->sample_slot.begin(), snapshot->sample_slot.end(), sample_slot);
+        std::copy(snapshot->slot_evictions.begin(), snapshot->slot_evictions.end(), slot_evictions);
+        std::copy(snapshot->slot_walk_time.begin(), snapshot->slot_walk_time.end(), slot_walk_time);
+    }
+}
+
+void sim_snapshot_free(sim_snapshot_t* snapshot) {
+    delete snapshot->l1;
+    delete snapshot->l2;
+    delete snapshot;
 }
 
 void print_cache_contents() {
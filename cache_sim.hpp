@@ -12,7 +12,14 @@ typedef enum replace_policy {
     // LRU replacement
     REPLACE_POLICY_LRU,
     // LFU replacement
-    REPLACE_POLICY_LFU
+    REPLACE_POLICY_LFU,
+    // Static RRIP: insert at RRPV 2, promote to 0 on hit
+    REPLACE_POLICY_SRRIP,
+    // Bimodal RRIP: insert at RRPV 3, and at 2 once every BRRIP_EPSILON installs
+    REPLACE_POLICY_BRRIP,
+    // Quad-age LRU as measured on Intel LLCs (QLRU_H11_M1_R0_U0): insert at age 1,
+    // hits move ages 3,2 -> 1 and 1 -> 0
+    REPLACE_POLICY_QLRU
 } replace_policy_t;
 
 typedef enum insert_policy {
@@ -39,13 +46,55 @@ typedef struct cache_config {
     replace_policy_t replace_policy;
     insert_policy_t prefetch_insert_policy;
     write_strat_t write_strat;
+
+    //Sliced LLC: power-of-two number of slices (0 or 1 for a monolithic cache).
+    //Lines are spread across slices by XOR-hashing the address, as in Intel's complex addressing.
+    uint64_t slices;
+    //XOR the low tag bits into the set index within a slice.
+    bool hashed_index;
+    //Compressed cache (LRU and LFU only): every way holds two half-line segments with a tag each, and a
+    //line read through sim_access_compressed takes one segment instead of two. Other policies warn and
+    //simulate an uncompressed cache.
+    bool compressed;
 } cache_config_t;
 
 typedef struct sim_config {
     cache_config_t l1_config;
     cache_config_t l2_config;
+
+    //Set Sampling: number of LLC sets to simulate, 0 simulates every set.
+    //Accesses to the other sets are dropped and the results are scaled up in sim_finish.
+    uint64_t sample_sets;
 } sim_config_t;
 
+//Which sim_stats_t counters are maintained, fixed at compile time through the template parameter of
+//sim_access_at (sim_access uses SIM_STATS_LEVEL). Counters below the level are compiled out.
+typedef enum stats_level {
+    // No counters, only the access times returned by sim_access
+    STATS_LEVEL_NONE,
+    // Only what the attack measures: num_evictions (plus the walk time)
+    STATS_LEVEL_ATTACK,
+    // Every counter
+    STATS_LEVEL_FULL,
+    // Every counter, plus a sim_event_t for each cache event (see sim_trace.hpp)
+    STATS_LEVEL_TRACE
+} stats_level_t;
+
+#ifndef SIM_STATS_LEVEL
+#if DEBUG
+#define SIM_STATS_LEVEL STATS_LEVEL_TRACE
+#else
+#define SIM_STATS_LEVEL STATS_LEVEL_FULL
+#endif
+#endif
+
+//Phases of an experiment. Only accesses made during the walk count towards the sampled walk time.
+typedef enum sim_phase {
+    SIM_PHASE_WARMUP,
+    SIM_PHASE_ATTACK,
+    SIM_PHASE_WALK,
+} sim_phase_t;
+
 typedef struct sim_stats {
     uint64_t reads;
     uint64_t writes;
@@ -68,11 +117,44 @@ typedef struct sim_stats {
     //Added Statistics
     uint64_t num_evictions;
     double llc_walk_time;
+
+    //Set Sampling (num_evictions and llc_walk_time are scaled estimates when sampled_sets < total_sets)
+    uint64_t sampled_sets;
+    uint64_t total_sets;
+    double num_evictions_ci;    //95% confidence interval half-width
+    double llc_walk_time_ci;
 } sim_stats_t;
 
+//Precomputed line lists (get_window_lines and the builders on it) mark a line holding a compressed window
+//by setting this bit of its block offset, which the caches ignore. sim_access_line passes it on as compressed.
+#define SIM_LINE_COMPRESSED 1ULL
+
+//Times returned by sim_access: an LLC hit, and the extra time of a miss
+#define HIT_TIME 30.5
+#define MISS_TIME 40.7
+
 extern void sim_setup(sim_config_t *config);
 extern double sim_access(char rw, uint64_t addr, sim_stats_t* p_stats);
+extern double sim_access_compressed(char rw, uint64_t addr, sim_stats_t* p_stats);
+template <stats_level_t L> double sim_access_at(char rw, uint64_t addr, sim_stats_t* p_stats, bool compressed=false);
+extern double sim_access_line(char rw, uint64_t line, sim_stats_t* p_stats);
+template <stats_level_t L> double sim_access_line_at(char rw, uint64_t line, sim_stats_t* p_stats);
 extern void sim_finish(sim_stats_t *p_stats);
+extern void sim_set_phase(sim_phase_t phase);
+extern sim_phase_t sim_get_phase();
+extern uint64_t sim_llc_num_sets();
+extern uint64_t sim_llc_set(uint64_t addr);
+extern uint64_t sim_pick_llc_sets(uint64_t count, uint64_t* outSets);
+extern bool sim_is_sampled(uint64_t addr);
+
+//Copy of the whole simulator (both caches, the access clock, phase and set sampling) plus the caller's
+//stats, taken between sim_setup and sim_finish. Restoring one replaces sim_setup; the snapshot must
+//outlive the restored run, whose caches refer to its config.
+typedef struct sim_snapshot sim_snapshot_t;
+
+extern sim_snapshot_t* sim_snapshot_take(const sim_config_t* config, const sim_stats_t* stats);
+extern void sim_snapshot_restore(const sim_snapshot_t* snapshot, sim_stats_t* stats);
+extern void sim_snapshot_free(sim_snapshot_t* snapshot);
 
 extern void print_cache_contents();
 
@@ -87,7 +169,10 @@ static const sim_config_t DEFAULT_SIM_CONFIG = {
                       /*.s =*/ 1,  // 2-way
                       /*.replace_policy =*/ REPLACE_POLICY_LRU,
                       /*.prefetch_insert_policy =*/ INSERT_POLICY_MIP,
-                      /*.write_strat =*/ WRITE_STRAT_WBWA},
+                      /*.write_strat =*/ WRITE_STRAT_WBWA,
+                      /*.slices =*/ 1,
+                      /*.hashed_index =*/ false,
+                      /*.compressed =*/ false},
 
     /*.l2_config =*/ {/*.disabled =*/ false,
                       /*.prefetcher_disabled =*/ false,
@@ -97,7 +182,12 @@ static const sim_config_t DEFAULT_SIM_CONFIG = {
                       /*.s =*/ 3,  // 8-way
                       /*.replace_policy =*/ REPLACE_POLICY_LRU,
                       /*.prefetch_insert_policy =*/ INSERT_POLICY_LIP,
-                      /*.write_strat =*/ WRITE_STRAT_WTWNA}
+                      /*.write_strat =*/ WRITE_STRAT_WTWNA,
+                      /*.slices =*/ 1,
+                      /*.hashed_index =*/ false,
+                      /*.compressed =*/ false},
+
+    /*.sample_sets =*/ 0
 };
 
 // Argument to cache_access rw. Indicates a load
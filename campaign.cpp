@@ -0,0 +1,185 @@
+#include "campaign.hpp"
+#include "scan.hpp"
+#include "timing.hpp"
+
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    std::vector<uint64_t> fill;
+    std::vector<uint64_t> attack[2];    //Indexed by the victim pixel being white
+    std::vector<uint64_t> walk;
+    bool memoized[2];
+    double walk_time[2];
+    uint64_t walk_hits[2];      //Outcome of the walk, for drawing fresh latencies under a timing model
+    uint64_t walk_misses[2];
+    double walk_scale[2];       //Set sampling scale
+} campaign_trials_t;
+
+//The walk counts hits and misses even when sim_access is built without them
+#define CAMPAIGN_WALK_STATS_LEVEL (SIM_STATS_LEVEL > STATS_LEVEL_FULL ? SIM_STATS_LEVEL : STATS_LEVEL_FULL)
+
+void campaign_config_init(campaign_config_t* config) {
+    config->victim_path = nullptr;
+    config->raw_width = 0;
+    config->width = 1920;
+    config->height = 1080;
+    config->out_path = nullptr;
+    config->use_facade = false;
+    config->memoize = true;
+    config->batch_pixels = 1 << 14;
+    config->progress_seconds = 5.0;
+}
+
+//Same brightness cut as do_pixel_attack: the first channel above 127.
+static bool victim_pixel_white(const scan_image_t* image, uint64_t x, uint64_t y) {
+    if (image == nullptr) {
+        return ((x / WINDOW_ROW_SIZE) + (y / WINDOW_NUM_ROWS)) % 2 == 1;
+    }
+    const uint8_t* p = image->data + y*image->stride + x*image->channels;
+    return p[0] > 127;
+}
+
+//A memoized trial: the walk's hits and misses are those of the first trial, only their latencies are
+//drawn again, from the same distributions simulating it would draw them from.
+static double replay_walk(const campaign_trials_t* trials, bool actual_white) {
+    if (!timing_model_active) {
+        return trials->walk_time[actual_white];
+    }
+    double walk_time = 0.0;
+    for (uint64_t i = 0; i < trials->walk_hits[actual_white]; i++) {
+        walk_time += timing_sample(true);
+    }
+    for (uint64_t i = 0; i < trials->walk_misses[actual_white]; i++) {
+        walk_time += timing_sample(false);
+    }
+    return walk_time * trials->walk_scale[actual_white];
+}
+
+static double campaign_trial(campaign_trials_t* trials, bool actual_white, uint64_t* simulated) {
+    if (trials->memoized[actual_white]) {
+        return replay_walk(trials, actual_white);
+    }
+    sim_stats_t cache_stats;
+    init_stats(&cache_stats);
+
+    sim_setup(&cache_config);
+    for (uint64_t line : trials->fill) {
+        sim_access_line('R', line, &cache_stats);
+    }
+    sim_set_phase(SIM_PHASE_ATTACK);
+    for (uint64_t line : trials->attack[actual_white]) {
+        sim_access_line('R', line, &cache_stats);
+    }
+    sim_set_phase(SIM_PHASE_WALK);
+    const uint64_t hitsBefore = cache_stats.hits_l1;
+    const uint64_t missesBefore = cache_stats.misses_l1;
+    for (uint64_t line : trials->walk) {
+        cache_stats.llc_walk_time += sim_access_line_at<CAMPAIGN_WALK_STATS_LEVEL>('R', line, &cache_stats);
+    }
+    trials->walk_hits[actual_white] = cache_stats.hits_l1 - hitsBefore;
+    trials->walk_misses[actual_white] = cache_stats.misses_l1 - missesBefore;
+    sim_finish(&cache_stats);
+    (*simulated)++;
+
+    trials->walk_time[actual_white] = cache_stats.llc_walk_time;
+    trials->walk_scale[actual_white] = (double) cache_stats.total_sets / cache_stats.sampled_sets;
+    return cache_stats.llc_walk_time;
+}
+
+//Steals every pixel of the victim. Returns false if the victim or the output can't be opened.
+bool run_campaign(const campaign_config_t* config, campaign_result_t* result) {
+    scan_image_t image;
+    const scan_image_t* victim = nullptr;
+    memset(result, 0, sizeof(*result));
+    result->width = config->width;
+    result->height = config->height;
+    if (config->victim_path != nullptr) {
+        if (!scan_open_image(config->victim_path, config->raw_width, &image)) {
+            fprintf(stderr, "Could not open %s\n", config->victim_path);
+            return false;
+        }
+        victim = &image;
+        result->width = image.width;
+        result->height = image.height;
+    }
+
+    FILE* out = nullptr;
+    if (config->out_path != nullptr) {
+        out = fopen(config->out_path, "wb");
+        if (out == nullptr) {
+            fprintf(stderr, "Could not write %s\n", config->out_path);
+            if (victim != nullptr) {
+                scan_close_image(&image);
+            }
+            return false;
+        }
+        fprintf(out, "P5\n%" PRIu64 " %" PRIu64 "\n255\n", result->width, result->height);
+    }
+
+    attack_frames_t frames;
+    init_attack_frames(&frames);
+    campaign_trials_t trials;
+    const access_order_t* render_order = get_access_order(attack_order.render, FRAME_NUM_WINDOWS_CACHE, attack_order.seed);
+    get_frame_lines(frames.buffer, false, &trials.fill);
+    get_frame_read_lines(frames.black, config->use_facade, render_order, &trials.attack[0]);
+    get_frame_read_lines(frames.noise, config->use_facade, render_order, &trials.attack[1]);
+    get_frame_lines_ordered(frames.buffer, get_access_order(attack_order.walk, FRAME_NUM_WINDOWS_CACHE, attack_order.seed), &trials.walk);
+    trials.memoized[0] = false;
+    trials.memoized[1] = false;
+
+    const uint64_t total = result->width * result->height;
+    const uint64_t batch_pixels = config->batch_pixels > 0 ? config->batch_pixels : 1;
+    std::vector<uint8_t> guesses(batch_pixels);
+    auto start = std::chrono::steady_clock::now();
+    double last_progress = 0.0;
+    for (uint64_t first = 0; first < total; first += batch_pixels) {
+        const uint64_t count = std::min(batch_pixels, total - first);
+        for (uint64_t n = 0; n < count; n++) {
+            const uint64_t x = (first + n) % result->width;
+            const uint64_t y = (first + n) / result->width;
+            const bool actual_white = victim_pixel_white(victim, x, y);
+            const double walk_time = campaign_trial(&trials, actual_white, &result->simulated);
+            trials.memoized[actual_white] = config->memoize;
+            const bool guess_white = guess_pixel_white(walk_time, config->use_facade);
+
+            guesses[n] = guess_white ? 255 : 0;
+            if (guess_white == actual_white) {
+                result->correct++;
+            } else if (guess_white) {
+                result->false_white++;
+            } else {
+                result->false_black++;
+            }
+        }
+        result->pixels += count;
+
+        if (out != nullptr) {
+            fwrite(guesses.data(), 1, count, out);
+            fflush(out);
+        }
+        result->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (config->progress_seconds > 0 && result->seconds - last_progress >= config->progress_seconds) {
+            last_progress = result->seconds;
+            fprintf(stderr, "%" PRIu64 "/%" PRIu64 " pixels (%.1f%%), %.0f pixels/s, accuracy %.4f\n", result->pixels, total,
+                100.0 * result->pixels / total, result->pixels / result->seconds, (double) result->correct / result->pixels);
+        }
+    }
+
+    free_frames();
+    if (victim != nullptr) {
+        scan_close_image(&image);
+    }
+    return out == nullptr || fclose(out) == 0;
+}
+
+void print_campaign_result(const campaign_result_t* result, FILE* out) {
+    const double accuracy = result->pixels == 0 ? 0.0 : (double) result->correct / result->pixels;
+    fprintf(out, "pixels\t%" PRIu64 "\t(%" PRIu64 "x%" PRIu64 ")\n", result->pixels, result->width, result->height);
+    fprintf(out, "accuracy\t%.4f\n", accuracy);
+    fprintf(out, "false_white\t%" PRIu64 "\n", result->false_white);
+    fprintf(out, "false_black\t%" PRIu64 "\n", result->false_black);
+    fprintf(out, "simulated\t%" PRIu64 "\n", result->simulated);
+    fprintf(out, "seconds\t%.2f\t(%.0f pixels/s)\n", result->seconds, result->seconds > 0 ? result->pixels / result->seconds : 0.0);
+}
@@ -0,0 +1,44 @@
+//Full-frame pixel stealing campaigns.
+//do_pixel_attack steals a fixed 1024 pixel checkerboard; a campaign steals every pixel of an arbitrary
+//victim image, e.g. a 1920x1080 PPM, in raster order. Pixels are attacked in batches and each finished
+//batch of guesses is appended to a PGM, so a partial reconstruction can be viewed while it runs.
+//
+//The attacker frames never change, so their windows are compressed once up front and every trial
+//just replays the cached line lists. A trial's hits and misses are then a pure function of the
+//attacker frame, so with memoize only the first trial of each is simulated. Without a timing model the
+//rest reuse its walk time, which is exactly what simulating them would give; under one they draw fresh
+//latencies for its walk hits and misses.
+
+#ifndef CAMPAIGN_HPP
+#define CAMPAIGN_HPP
+
+#include "experiment.hpp"
+
+typedef struct {
+    const char* victim_path;    //P6 PPM, or raw RGBA raw_width pixels wide; nullptr for a checkerboard
+    uint64_t raw_width;
+    uint64_t width;             //Of the checkerboard
+    uint64_t height;
+    const char* out_path;       //PGM of the guesses, nullptr to skip
+    bool use_facade;
+    bool memoize;
+    uint64_t batch_pixels;
+    double progress_seconds;    //Print progress to stderr this often, 0 to stay quiet
+} campaign_config_t;
+
+typedef struct {
+    uint64_t width;
+    uint64_t height;
+    uint64_t pixels;
+    uint64_t correct;
+    uint64_t false_white;       //Black pixels guessed white
+    uint64_t false_black;
+    uint64_t simulated;         //Trials actually run through the simulator
+    double seconds;
+} campaign_result_t;
+
+extern void campaign_config_init(campaign_config_t* config);
+extern bool run_campaign(const campaign_config_t* config, campaign_result_t* result);
+extern void print_campaign_result(const campaign_result_t* result, FILE* out);
+
+#endif
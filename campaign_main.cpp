@@ -0,0 +1,81 @@
+//Steals every pixel of a victim image and streams the reconstruction to a PGM.
+//
+//Usage: compress_campaign [--victim <image>] [--raw-width W] [--size WxH] [--out <file.pgm>]
+//                         [--facade] [--simulate-all] [--sigma S] [--batch N] [--progress S]
+
+//Stdlib Things
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+//My Things
+#include "campaign.hpp"
+#include "timing.hpp"
+
+static void usage() {
+    fprintf(stderr, "Usage: compress_campaign [--victim <image>] [--raw-width W] [--size WxH] [--out <file.pgm>] [--facade] [--simulate-all] [--sigma S] [--batch N] [--progress S]\n");
+    fprintf(stderr, "  --victim        P6 PPM or raw RGBA image to steal (default: a checkerboard)\n");
+    fprintf(stderr, "  --raw-width     Width in pixels of a raw RGBA victim\n");
+    fprintf(stderr, "  --size          Size of the checkerboard (default: 1920x1080)\n");
+    fprintf(stderr, "  --out           Stream the stolen pixels to this PGM\n");
+    fprintf(stderr, "  --facade        Render the attacker frames with the facade defense\n");
+    fprintf(stderr, "  --simulate-all  Simulate every trial instead of reusing the first of each attacker frame\n");
+    fprintf(stderr, "  --sigma         Standard deviation of Gaussian jitter on every access latency\n");
+    fprintf(stderr, "  --batch         Pixels per batch written to the PGM (default: 16384)\n");
+    fprintf(stderr, "  --progress      Seconds between progress lines, 0 for none (default: 5)\n");
+}
+
+int main(int argc, char** argv) {
+    campaign_config_t config;
+    campaign_config_init(&config);
+    double sigma = 0.0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--victim") == 0 && i + 1 < argc) {
+            config.victim_path = argv[++i];
+        } else if (strcmp(argv[i], "--raw-width") == 0 && i + 1 < argc) {
+            config.raw_width = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            unsigned long long width, height;
+            if (sscanf(argv[++i], "%llux%llu", &width, &height) != 2) {
+                usage();
+                return 1;
+            }
+            config.width = width;
+            config.height = height;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            config.out_path = argv[++i];
+        } else if (strcmp(argv[i], "--facade") == 0) {
+            config.use_facade = true;
+        } else if (strcmp(argv[i], "--simulate-all") == 0) {
+            config.memoize = false;
+        } else if (strcmp(argv[i], "--sigma") == 0 && i + 1 < argc) {
+            sigma = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            config.batch_pixels = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--progress") == 0 && i + 1 < argc) {
+            config.progress_seconds = atof(argv[++i]);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    init_cache_config();
+    srand(time(NULL));
+    if (sigma > 0) {
+        timing_model_t timing;
+        timing_model_init(&timing, TIMING_MODEL_GAUSSIAN);
+        timing.seed = time(NULL);
+        timing.hit_sigma = sigma;
+        timing.miss_sigma = sigma;
+        timing_set_model(&timing);
+    }
+
+    campaign_result_t result;
+    if (!run_campaign(&config, &result)) {
+        return 1;
+    }
+    print_campaign_result(&result, stdout);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "checkpoint.hpp"
+#include "frame.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    inline uint64_t align_up(uint64_t offset) {
+        return (offset + CHECKPOINT_ALIGN - 1) & ~(uint64_t) (CHECKPOINT_ALIGN - 1);
+    }
+}
+
+//Saves the frame registry and progress.
+bool checkpoint_save(const char* path, checkpoint_campaign_t campaign, const std::vector<uint8_t>& progress) {
+    checkpoint_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.campaign = campaign;
+    header.sections[CHECKPOINT_SECTION_FRAMES].size = get_frames_state_size();
+    header.sections[CHECKPOINT_SECTION_CAMPAIGN].size = progress.size();
+    uint64_t offset = sizeof(header);
+    for (uint32_t i = 0; i < CHECKPOINT_NUM_SECTIONS; i++) {
+        offset = align_up(offset);
+        header.sections[i].offset = offset;
+        offset += header.sections[i].size;
+    }
+    header.file_size = offset;
+
+    const std::string tmpPath = std::string(path) + ".tmp";
+    int fd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    void* map = MAP_FAILED;
+    if (fd >= 0 && ftruncate(fd, header.file_size) == 0) {
+        map = mmap(nullptr, header.file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    uint8_t* base = (uint8_t*) map;
+    memcpy(base, &header, sizeof(header));
+    save_frames_state(base + header.sections[CHECKPOINT_SECTION_FRAMES].offset);
+    memcpy(base + header.sections[CHECKPOINT_SECTION_CAMPAIGN].offset, progress.data(), progress.size());
+
+    bool ok = msync(map, header.file_size, MS_SYNC) == 0;
+    munmap(map, header.file_size);
+    ok = close(fd) == 0 && ok;
+    return ok && rename(tmpPath.c_str(), path) == 0;
+}
+
+//Restores a checkpoint of the given campaign: hands its progress to accept and, if accept agrees to
+//resume from it, replaces the frame registry. Returns false, leaving the registry alone, if there is no
+//valid checkpoint at path or accept refuses it.
+bool checkpoint_load(const char* path, checkpoint_campaign_t campaign, checkpoint_accept_t accept, void* arg) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (uint64_t) st.st_size >= sizeof(checkpoint_header_t)) {
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    const uint8_t* base = (const uint8_t*) map;
+    checkpoint_header_t header;
+    memcpy(&header, base, sizeof(header));
+    bool ok = memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0 && header.version == CHECKPOINT_VERSION &&
+        header.campaign == (uint32_t) campaign && header.file_size == (uint64_t) st.st_size;
+    for (uint32_t i = 0; ok && i < CHECKPOINT_NUM_SECTIONS; i++) {
+        ok = header.sections[i].offset <= header.file_size && header.sections[i].size <= header.file_size - header.sections[i].offset;
+    }
+
+    const checkpoint_section_t* framesSection = &header.sections[CHECKPOINT_SECTION_FRAMES];
+    uint64_t numFrames = 0;
+    ok = ok && check_frames_state(base + framesSection->offset, framesSection->size, &numFrames);
+    if (ok) {
+        const checkpoint_section_t* campaignSection = &header.sections[CHECKPOINT_SECTION_CAMPAIGN];
+        const std::vector<uint8_t> progress(base + campaignSection->offset, base + campaignSection->offset + campaignSection->size);
+        ok = accept(progress, numFrames, arg);
+    }
+    if (ok) {
+        load_frames_state(base + framesSection->offset, framesSection->size);
+    }
+    munmap(map, st.st_size);
+    return ok;
+}
+
+void checkpoint_remove(const char* path) {
+    unlink(path);
+}
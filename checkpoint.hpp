@@ -0,0 +1,51 @@
+//Versioned on-disk checkpoints for resuming long campaigns.
+//A checkpoint holds the frame registry and the campaign's own progress. Campaigns save one between
+//trials, where no simulator is running, so the simulator itself is never part of it. It is written
+//through a shared mapping and msync'd, so saving and restoring cost about a memcpy of the state; the
+//file is renamed into place so a crash never leaves a torn checkpoint.
+//
+//Layout: checkpoint_header_t, then each section at a CHECKPOINT_ALIGN boundary.
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <inttypes.h>
+#include <vector>
+
+#define CHECKPOINT_MAGIC "SIMCKPT1"
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_ALIGN 64
+
+typedef enum checkpoint_section_id {
+    CHECKPOINT_SECTION_FRAMES,      //save_frames_state
+    CHECKPOINT_SECTION_CAMPAIGN,    //Defined by the campaign
+    CHECKPOINT_NUM_SECTIONS
+} checkpoint_section_id_t;
+
+typedef enum checkpoint_campaign {
+    CHECKPOINT_CAMPAIGN_ATTACK,
+    CHECKPOINT_CAMPAIGN_SWEEP,
+} checkpoint_campaign_t;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+} checkpoint_section_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t campaign;  //checkpoint_campaign_t
+    uint64_t file_size;
+    checkpoint_section_t sections[CHECKPOINT_NUM_SECTIONS];
+} checkpoint_header_t;
+
+//Checks a checkpoint's progress against the campaign being resumed, given the number of frames its
+//registry holds, and takes any state of its own from it. Called before the registry is touched.
+typedef bool (*checkpoint_accept_t)(const std::vector<uint8_t>& progress, uint64_t num_frames, void* arg);
+
+extern bool checkpoint_save(const char* path, checkpoint_campaign_t campaign, const std::vector<uint8_t>& progress);
+extern bool checkpoint_load(const char* path, checkpoint_campaign_t campaign, checkpoint_accept_t accept, void* arg);
+extern void checkpoint_remove(const char* path);
+
+#endif
@@ -3,8 +3,6 @@
 #include <iostream>
 #include <random>
 
-#define COMPRESS_THRESHOLD 14
-
 #define LLC_TIME_MEAN_COMPRESSED 16
 #define LLC_TIME_MEAN_UNCOMPRESSED 18
 
@@ -11,6 +11,9 @@
 
 #define NUM_CHANNELS 4
 
+//Max bits per pixel (summed over the channels) for a window to compress
+#define COMPRESS_THRESHOLD 14
+
 typedef struct {
     uint8_t pixels[WINDOW_NUM_PIXELS][NUM_CHANNELS];
 } pixel_window_t;   //A window of pixels taking up 2 CLs that can be compressed into 1 CL.
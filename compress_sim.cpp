@@ -0,0 +1,163 @@
+//libcompress_sim's C API, a thin layer over cache_sim and frame. See compress_sim.h.
+
+#include "compress_sim.h"
+#include "experiment.hpp"
+
+#include <math.h>
+#include <string.h>
+
+struct csim {
+    sim_config_t config;
+    uint64_t order_seed;
+    sim_stats_t stats;
+    bool in_trial;
+};
+
+static_assert(sizeof(pixel_window_t) == CSIM_WINDOW_BYTES, "csim windows must match pixel_window_t");
+static_assert(WINDOW_ROW_SIZE == CSIM_WINDOW_WIDTH && WINDOW_NUM_ROWS == CSIM_WINDOW_HEIGHT, "csim window shape");
+
+static csim_t* csim_instance = nullptr;
+
+static const replace_policy_t csim_replace_policies[] = {
+    REPLACE_POLICY_LRU, REPLACE_POLICY_LFU, REPLACE_POLICY_SRRIP, REPLACE_POLICY_BRRIP, REPLACE_POLICY_QLRU,
+};
+static const access_order_kind_t csim_orders[] = {
+    ACCESS_ORDER_LINEAR, ACCESS_ORDER_REVERSE, ACCESS_ORDER_MORTON, ACCESS_ORDER_TILED, ACCESS_ORDER_RANDOM,
+};
+
+static frame_t* to_frame(csim_frame_t* frame) {
+    return reinterpret_cast<frame_t*>(frame);
+}
+
+static csim_frame_t* from_frame(frame_t* frame) {
+    return reinterpret_cast<csim_frame_t*>(frame);
+}
+
+void csim_config_default(csim_config_t* config) {
+    init_cache_config();
+    memset(config, 0, sizeof(*config));
+    config->c = cache_config.l1_config.c;
+    config->b = cache_config.l1_config.b;
+    config->s = cache_config.l1_config.s;
+    config->replace_policy = CSIM_REPLACE_LRU;
+    config->sample_sets = cache_config.sample_sets;
+}
+
+csim_t* csim_create(const csim_config_t* config) {
+    if (csim_instance != nullptr || config->replace_policy > CSIM_REPLACE_QLRU) {
+        return nullptr;
+    }
+    init_cache_config();
+    csim_t* sim = new csim_t();
+    sim->config = cache_config;
+    sim->config.l1_config.c = config->c;
+    sim->config.l1_config.b = config->b;
+    sim->config.l1_config.s = config->s;
+    sim->config.l1_config.replace_policy = csim_replace_policies[config->replace_policy];
+    sim->config.l1_config.slices = config->slices;
+    sim->config.sample_sets = config->sample_sets;
+    sim->order_seed = config->order_seed;
+    sim->in_trial = false;
+    csim_instance = sim;
+    return sim;
+}
+
+void csim_destroy(csim_t* sim) {
+    if (sim->in_trial) {
+        sim_finish(&sim->stats);
+    }
+    free_frames();
+    csim_instance = nullptr;
+    delete sim;
+}
+
+csim_frame_t* csim_register_frame(csim_t* sim, void* windows, uint64_t num_windows) {
+    (void) sim;
+    //Registering the same windows again means their pixels changed, so the facade built from them is stale.
+    //The old facade stays registered until free_frames, like every frame.
+    for (frame_t* frame : m_Frames) {
+        if (frame->borrowed && frame->windows == windows && frame->nWindows == num_windows) {
+            frame->facade = nullptr;
+            return from_frame(frame);
+        }
+    }
+    return from_frame(get_new_frame_borrowed((pixel_window_t*) windows, num_windows));
+}
+
+csim_frame_t* csim_new_frame(csim_t* sim, uint64_t num_windows, csim_fill_t fill) {
+    (void) sim;
+    return from_frame(fill == CSIM_FILL_BLACK ? get_new_frame_black(num_windows) : get_new_frame_random(num_windows));
+}
+
+void csim_tile_rgba(const uint8_t* rgba, uint64_t width, uint64_t height, uint64_t stride, uint8_t* out) {
+    const uint64_t rowBytes = CSIM_WINDOW_WIDTH * 4;
+    for (uint64_t wy = 0; wy < height; wy += CSIM_WINDOW_HEIGHT) {
+        for (uint64_t wx = 0; wx < width; wx += CSIM_WINDOW_WIDTH) {
+            for (uint64_t y = 0; y < CSIM_WINDOW_HEIGHT; y++) {
+                memcpy(out, rgba + (wy + y)*stride + wx*4, rowBytes);
+                out += rowBytes;
+            }
+        }
+    }
+}
+
+void csim_begin_trial(csim_t* sim) {
+    if (sim->in_trial) {
+        sim_finish(&sim->stats);
+    }
+    init_stats(&sim->stats);
+    sim_setup(&sim->config);
+    sim->in_trial = true;
+}
+
+void csim_set_phase(csim_t* sim, csim_phase_t phase) {
+    (void) sim;
+    sim_set_phase((sim_phase_t) phase);
+}
+
+double csim_read_frame(csim_t* sim, csim_frame_t* frame, csim_order_t order, int use_facade) {
+    if (!sim->in_trial || (uint32_t) order > CSIM_ORDER_RANDOM) {
+        return NAN;
+    }
+    frame_t* f = to_frame(frame);
+    const access_order_t* table = get_access_order(csim_orders[order], f->nWindows, sim->order_seed);
+    const double time = use_facade ? read_frame_facade_ordered(f, table, &sim->stats) : read_frame_ordered(f, table, &sim->stats);
+    if (sim_get_phase() == SIM_PHASE_WALK) {
+        sim->stats.llc_walk_time += time;
+    }
+    return time;
+}
+
+void csim_end_trial(csim_t* sim, csim_stats_t* out) {
+    if (!sim->in_trial) {
+        return;
+    }
+    sim_finish(&sim->stats);
+    sim->in_trial = false;
+    if (out != nullptr) {
+        out->accesses = sim->stats.accesses_l1;
+        out->hits = sim->stats.hits_l1;
+        out->misses = sim->stats.misses_l1;
+        out->evictions = sim->stats.num_evictions;
+        out->walk_time = sim->stats.llc_walk_time;
+        out->walk_time_ci = sim->stats.llc_walk_time_ci;
+        out->sampled_sets = sim->stats.sampled_sets;
+        out->total_sets = sim->stats.total_sets;
+    }
+}
+
+int csim_attack_pixel(csim_t* sim, csim_frame_t* buffer, csim_frame_t* black, csim_frame_t* noise, int white,
+        int use_facade, csim_stats_t* out) {
+    csim_stats_t stats;
+    csim_begin_trial(sim);
+    csim_read_frame(sim, buffer, CSIM_ORDER_LINEAR, 0);
+    csim_set_phase(sim, CSIM_PHASE_ATTACK);
+    csim_read_frame(sim, white ? noise : black, CSIM_ORDER_LINEAR, use_facade);
+    csim_set_phase(sim, CSIM_PHASE_WALK);
+    csim_read_frame(sim, buffer, CSIM_ORDER_REVERSE, 0);
+    csim_end_trial(sim, &stats);
+    if (out != nullptr) {
+        *out = stats;
+    }
+    return guess_pixel_white(stats.walk_time, use_facade);
+}
@@ -0,0 +1,116 @@
+/* C API of libcompress_sim, for harnesses that drive trials in-process.
+ *
+ * A harness creates the simulator, registers its frames, and runs trials from the same primitives
+ * do_pixel_attack uses: begin a trial, read frames in some order, end it and read back the stats.
+ * Frames can be registered straight from caller-owned memory laid out as windows of
+ * CSIM_WINDOW_PIXELS RGBA pixels (8 wide, 4 high, row-major within the window, windows in order);
+ * the simulator reads them in place and never copies or frees them. csim_tile_rgba lays out a
+ * row-major image that way.
+ *
+ * The simulator is process-wide: only one csim_t can exist at a time, and it must be driven from one
+ * thread. Link with a C++ toolchain (or add -lstdc++ -pthread) when using libcompress_sim.a.
+ */
+
+#ifndef COMPRESS_SIM_H
+#define COMPRESS_SIM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CSIM_API_VERSION 2
+#define CSIM_WINDOW_PIXELS 32
+#define CSIM_WINDOW_WIDTH 8
+#define CSIM_WINDOW_HEIGHT 4
+#define CSIM_WINDOW_BYTES (CSIM_WINDOW_PIXELS * 4)
+
+typedef struct csim csim_t;
+typedef struct csim_frame csim_frame_t;
+
+typedef enum {
+    CSIM_REPLACE_LRU,
+    CSIM_REPLACE_LFU,
+    CSIM_REPLACE_SRRIP,
+    CSIM_REPLACE_BRRIP,
+    CSIM_REPLACE_QLRU
+} csim_replace_t;
+
+typedef enum {
+    CSIM_ORDER_LINEAR,
+    CSIM_ORDER_REVERSE,
+    CSIM_ORDER_MORTON,
+    CSIM_ORDER_TILED,
+    CSIM_ORDER_RANDOM
+} csim_order_t;
+
+typedef enum {
+    CSIM_PHASE_WARMUP,
+    CSIM_PHASE_ATTACK,
+    CSIM_PHASE_WALK     /* Reads in this phase add up to walk_time */
+} csim_phase_t;
+
+typedef enum {
+    CSIM_FILL_BLACK,    /* Every window compresses */
+    CSIM_FILL_RANDOM    /* No window compresses */
+} csim_fill_t;
+
+/* The LLC, in the (C,B,S) taxonomy of cache_sim.hpp. */
+typedef struct {
+    uint32_t c;
+    uint32_t b;
+    uint32_t s;
+    uint32_t replace_policy;    /* csim_replace_t */
+    uint32_t slices;            /* 0 or 1 for a monolithic LLC */
+    uint64_t sample_sets;       /* 0 simulates every set */
+    uint64_t order_seed;        /* Of CSIM_ORDER_RANDOM */
+} csim_config_t;
+
+typedef struct {
+    uint64_t accesses;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    double walk_time;
+    double walk_time_ci;        /* 95% half-width when sets are sampled, else 0 */
+    uint64_t sampled_sets;
+    uint64_t total_sets;
+} csim_stats_t;
+
+/* The configuration compress_sim runs: a 64KB fully associative LRU LLC. */
+extern void csim_config_default(csim_config_t* config);
+
+/* NULL if a simulator already exists. */
+extern csim_t* csim_create(const csim_config_t* config);
+/* Also unregisters every frame. */
+extern void csim_destroy(csim_t* sim);
+
+/* Registers num_windows windows at windows, which must stay valid until csim_destroy. The simulator
+ * reads them in place. After changing the pixels, register the same windows again: that returns the
+ * same frame with its facade dropped, so the next facade read rebuilds it. */
+extern csim_frame_t* csim_register_frame(csim_t* sim, void* windows, uint64_t num_windows);
+/* A frame owned by the simulator, e.g. the buffer that fills the LLC. */
+extern csim_frame_t* csim_new_frame(csim_t* sim, uint64_t num_windows, csim_fill_t fill);
+/* Lays out a row-major RGBA image (stride bytes per row) as windows. width must be a multiple of
+ * CSIM_WINDOW_WIDTH and height of CSIM_WINDOW_HEIGHT; out holds width*height*4 bytes. */
+extern void csim_tile_rgba(const uint8_t* rgba, uint64_t width, uint64_t height, uint64_t stride, uint8_t* out);
+
+extern void csim_begin_trial(csim_t* sim);
+extern void csim_set_phase(csim_t* sim, csim_phase_t phase);
+/* Returns the time the reads took, or NaN outside a trial or for an unknown order. With use_facade
+ * the frame is read behind the full facade, which is built from the frame's pixels on first use and
+ * kept until the frame is registered again. */
+extern double csim_read_frame(csim_t* sim, csim_frame_t* frame, csim_order_t order, int use_facade);
+extern void csim_end_trial(csim_t* sim, csim_stats_t* out);
+
+/* One trial of the pixel attack: fill the LLC with buffer, render noise if white else black, walk
+ * buffer backwards. Returns 1 if the walk time says white. out may be NULL. */
+extern int csim_attack_pixel(csim_t* sim, csim_frame_t* buffer, csim_frame_t* black, csim_frame_t* noise, int white,
+    int use_facade, csim_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,549 @@
+#include "daemon.hpp"
+
+//Stdlib Things
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+//My Things
+#include "experiment.hpp"
+
+#define DAEMON_MAX_TEXTURE_KB 128
+
+static const char* policy_names[] = {
+    "LRU", "LFU", "SRRIP", "BRRIP", "QLRU"
+};
+
+typedef struct {
+    frame_t* black;
+    frame_t* noise;
+} resident_texture_t;
+
+typedef std::tuple<uint64_t, int, uint64_t, bool> snapshot_key_t;      //s, replace_policy, sample_sets, compressed
+typedef std::tuple<frame_t*, int, const access_order_t*> lines_key_t;   //frame, facade mode, order
+
+static attack_frames_t attack_frames;
+static resident_texture_t resident_attack;      //Full-LLC attacker frames, as in do_pixel_attack
+static std::map<uint32_t, resident_texture_t*> resident_textures;
+static std::map<snapshot_key_t, sim_snapshot_t*> warm_snapshots;
+static std::map<lines_key_t, std::vector<uint64_t>*> resident_lines;
+
+namespace {
+    typedef std::chrono::steady_clock daemon_clock_t;
+
+    //The lines a read of frame in order behind the facade of mode accesses, from get_frame_read_lines_mode,
+    //so reading a frame again never calls compress().
+    const std::vector<uint64_t>& get_resident_lines(frame_t* frame, facade_mode_t mode, const access_order_t* order) {
+        std::vector<uint64_t>*& lines = resident_lines[lines_key_t(frame, mode, order)];
+        if (lines == nullptr) {
+            lines = new std::vector<uint64_t>();
+            get_frame_read_lines_mode(frame, mode, order, lines);
+        }
+        return *lines;
+    }
+
+    const access_order_t* get_order(access_order_kind_t kind, const frame_t* frame, const daemon_request_t* request) {
+        return get_access_order(kind, frame->nWindows, request->order.seed);
+    }
+
+    facade_mode_t request_facade_mode(const daemon_request_t* request) {
+        return request->use_facade ? request->facade_mode : FACADE_NONE;
+    }
+
+    resident_texture_t* get_texture(uint32_t texture_size_kb) {
+        resident_texture_t*& texture = resident_textures[texture_size_kb];
+        if (texture == nullptr) {
+            texture = new resident_texture_t();
+            texture->black = get_new_frame_black(8*texture_size_kb);
+            texture->noise = get_new_frame_random(8*texture_size_kb);
+        }
+        return texture;
+    }
+
+    sim_config_t request_config(const daemon_request_t* request) {
+        sim_config_t config = cache_config;
+        config.l1_config.s = request->s;
+        config.l1_config.replace_policy = request->replace_policy;
+        config.l1_config.compressed = request->compressed;
+        config.sample_sets = request->sample_sets;
+        return config;
+    }
+
+    //The simulator right after the LLC was filled with the buffer frame, for this request's cache.
+    const sim_snapshot_t* get_warm_snapshot(const daemon_request_t* request, bool* outCached) {
+        snapshot_key_t key(request->s, request->replace_policy, request->sample_sets, request->compressed);
+        sim_snapshot_t*& snapshot = warm_snapshots[key];
+        *outCached = snapshot != nullptr;
+        if (snapshot == nullptr) {
+            sim_config_t config = request_config(request);
+            sim_stats_t stats;
+            init_stats(&stats);
+            sim_setup(&config);
+            frame_t* buffer = attack_frames.buffer;
+            read_frame_lines(get_resident_lines(buffer, FACADE_NONE, get_access_order(ACCESS_ORDER_LINEAR, buffer->nWindows)), &stats);
+            snapshot = sim_snapshot_take(&config, &stats);
+            sim_finish(&stats);
+        }
+        return snapshot;
+    }
+
+    //One trial from a warm snapshot: render the attacker frame in the request's render order behind its
+    //facade mode, then time the walk of the buffer in its walk order.
+    void run_trial(const daemon_request_t* request, const sim_snapshot_t* warm, frame_t* attacker, sim_stats_t* stats) {
+        frame_t* buffer = attack_frames.buffer;
+        const std::vector<uint64_t>& render = get_resident_lines(attacker, request_facade_mode(request), 
+            get_order(request->order.render, attacker, request));
+        const std::vector<uint64_t>& walk = get_resident_lines(buffer, FACADE_NONE, get_order(request->order.walk, buffer, request));
+
+        sim_snapshot_restore(warm, stats);
+        sim_set_phase(SIM_PHASE_ATTACK);
+        read_frame_lines(render, stats);
+        sim_set_phase(SIM_PHASE_WALK);
+        stats->llc_walk_time = read_frame_lines(walk, stats);
+        sim_finish(stats);
+    }
+
+    void handle_attack(const daemon_request_t* request, const sim_snapshot_t* warm, FILE* out) {
+        uint64_t correct = 0;
+        const uint32_t pixels = std::min<uint32_t>(request->pixels, ATTACK_NUM_PIXELS);
+        for (uint32_t pixel = 0; pixel < pixels; pixel++) {
+            const size_t w = pixel / WINDOW_NUM_PIXELS;
+            const size_t p = pixel % WINDOW_NUM_PIXELS;
+            const bool actual_white = attack_frames.victim->windows[w].pixels[p][0] > 127;
+
+            sim_stats_t stats;
+            run_trial(request, warm, actual_white ? resident_attack.noise : resident_attack.black, &stats);
+            const bool guess_white = guess_pixel_white(stats.llc_walk_time, request->use_facade);
+            correct += guess_white == actual_white;
+
+            if (request->stream_trials) {
+                fprintf(out, "{\"pixel\": %u, \"actual_white\": %s, \"guess_white\": %s, \"walk_time\": %.3f, \"evictions\": %" PRIu64 "}\n",
+                    pixel, actual_white ? "true" : "false", guess_white ? "true" : "false", stats.llc_walk_time, stats.num_evictions);
+                fflush(out);
+            }
+        }
+        fprintf(out, "{\"done\": true, \"kind\": \"attack\", \"trials\": %u, \"accuracy\": %.4f", 
+            pixels, pixels == 0 ? 0.0 : (double) correct / pixels);
+    }
+
+    void print_walk(const daemon_request_t* request, uint32_t texture_size_kb, const sim_snapshot_t* warm, FILE* out) {
+        resident_texture_t* texture = get_texture(texture_size_kb);
+        sim_stats_t black, noise;
+        run_trial(request, warm, texture->black, &black);
+        run_trial(request, warm, texture->noise, &noise);
+        fprintf(out, "{\"texture_kb\": %u, \"uncompressed_evictions\": %" PRIu64 ", \"uncompressed_walk_time\": %.3f, "
+            "\"compressed_evictions\": %" PRIu64 ", \"compressed_walk_time\": %.3f}\n", 
+            texture_size_kb, noise.num_evictions, noise.llc_walk_time, black.num_evictions, black.llc_walk_time);
+        fflush(out);
+    }
+
+    //Minimal parser for one flat JSON object of string, number and boolean values.
+    bool parse_flat_json(const char* s, std::map<std::string, std::string>* out, std::string* error) {
+        auto skip = [&]() { while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++; };
+        auto parse_string = [&](std::string* str) {
+            if (*s != '"') {
+                return false;
+            }
+            for (s++; *s != '"'; s++) {
+                if (*s == '\0') {
+                    return false;
+                }
+                if (*s == '\\' && s[1] != '\0') {
+                    s++;
+                }
+                str->push_back(*s);
+            }
+            s++;
+            return true;
+        };
+
+        skip();
+        if (*s++ != '{') {
+            *error = "expected an object";
+            return false;
+        }
+        skip();
+        if (*s == '}') {
+            return true;
+        }
+        while (true) {
+            std::string key, value;
+            skip();
+            if (!parse_string(&key)) {
+                *error = "expected a key";
+                return false;
+            }
+            skip();
+            if (*s++ != ':') {
+                *error = "expected ':' after " + key;
+                return false;
+            }
+            skip();
+            if (*s == '"') {
+                if (!parse_string(&value)) {
+                    *error = "unterminated string for " + key;
+                    return false;
+                }
+            } else {
+                while (*s != ',' && *s != '}' && *s != '\0' && *s != ' ') {
+                    value.push_back(*s++);
+                }
+            }
+            (*out)[key] = value;
+            skip();
+            if (*s == '}') {
+                return true;
+            }
+            if (*s++ != ',') {
+                *error = "expected ',' or '}'";
+                return false;
+            }
+        }
+    }
+
+    //value as the contents of a JSON string.
+    std::string json_escape(const std::string& value) {
+        std::string escaped;
+        for (unsigned char c : value) {
+            if (c == '"' || c == '\\') {
+                escaped.push_back('\\');
+                escaped.push_back(c);
+            } else if (c < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped.push_back(c);
+            }
+        }
+        return escaped;
+    }
+
+    //A facade mode by name; "none" is "facade": false.
+    bool parse_facade_mode(const std::string& value, facade_mode_t* out) {
+        for (int mode = FACADE_FULL; mode < FACADE_NUM_MODES; mode++) {
+            if (value == facade_mode_name((facade_mode_t) mode)) {
+                *out = (facade_mode_t) mode;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parse_access_order(const std::string& value, access_order_kind_t* out) {
+        for (int kind = 0; kind < ACCESS_ORDER_COUNT; kind++) {
+            if (value == access_order_name((access_order_kind_t) kind)) {
+                *out = (access_order_kind_t) kind;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parse_bool(const std::string& value, bool* out) {
+        if (value == "true" || value == "1") {
+            *out = true;
+        } else if (value == "false" || value == "0") {
+            *out = false;
+        } else {
+            return false;
+        }
+        return true;
+    }
+}
+
+//Generates the attack frames and precomputes their lines for the global facade_mode and attack_order.
+//Other modes and orders are precomputed by the first request that uses them. Call after init_cache_config.
+void daemon_init() {
+    init_attack_frames(&attack_frames);
+    resident_attack.black = attack_frames.black;
+    resident_attack.noise = attack_frames.noise;
+
+    frame_t* buffer = attack_frames.buffer;
+    get_resident_lines(buffer, FACADE_NONE, get_access_order(ACCESS_ORDER_LINEAR, buffer->nWindows));
+    get_resident_lines(buffer, FACADE_NONE, get_access_order(attack_order.walk, buffer->nWindows, attack_order.seed));
+    for (frame_t* attacker : {resident_attack.black, resident_attack.noise}) {
+        const access_order_t* render_order = get_access_order(attack_order.render, attacker->nWindows, attack_order.seed);
+        get_resident_lines(attacker, FACADE_NONE, render_order);
+        get_resident_lines(attacker, facade_mode, render_order);
+    }
+}
+
+bool daemon_parse_request(const char* line, daemon_request_t* request, std::string* error) {
+    std::map<std::string, std::string> fields;
+    if (!parse_flat_json(line, &fields, error)) {
+        return false;
+    }
+
+    request->s = cache_config.l1_config.s;
+    request->replace_policy = cache_config.l1_config.replace_policy;
+    request->sample_sets = cache_config.sample_sets;
+    request->use_facade = false;
+    request->facade_mode = facade_mode;
+    request->order = attack_order;
+    request->compressed = cache_config.l1_config.compressed;
+    request->texture_size_kb = 1;
+    request->pixels = ATTACK_NUM_PIXELS;
+    request->stream_trials = true;
+
+    const std::string kind = fields["kind"];
+    fields.erase("kind");
+    if (kind == "attack") {
+        request->kind = DAEMON_REQ_ATTACK;
+    } else if (kind == "walk") {
+        request->kind = DAEMON_REQ_WALK;
+    } else if (kind == "sweep") {
+        request->kind = DAEMON_REQ_SWEEP;
+    } else if (kind == "status") {
+        request->kind = DAEMON_REQ_STATUS;
+    } else if (kind == "shutdown") {
+        request->kind = DAEMON_REQ_SHUTDOWN;
+    } else {
+        *error = "unknown kind '" + kind + "'";
+        return false;
+    }
+
+    for (const auto& field : fields) {
+        const std::string& key = field.first;
+        const std::string& value = field.second;
+        bool ok = true;
+        if (key == "s") {
+            request->s = strtoull(value.c_str(), nullptr, 10);
+            ok = request->s <= cache_config.l1_config.c - cache_config.l1_config.b;
+        } else if (key == "policy") {
+            ok = false;
+            for (size_t p = 0; p < sizeof(policy_names) / sizeof(policy_names[0]); p++) {
+                if (value == policy_names[p]) {
+                    request->replace_policy = (replace_policy_t) p;
+                    ok = true;
+                }
+            }
+        } else if (key == "sample_sets") {
+            request->sample_sets = strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "facade") {
+            ok = parse_bool(value, &request->use_facade);
+        } else if (key == "facade_mode") {
+            ok = parse_facade_mode(value, &request->facade_mode);
+        } else if (key == "render_order") {
+            ok = parse_access_order(value, &request->order.render);
+        } else if (key == "walk_order") {
+            ok = parse_access_order(value, &request->order.walk);
+        } else if (key == "order_seed") {
+            request->order.seed = strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "compressed") {
+            ok = parse_bool(value, &request->compressed);
+        } else if (key == "texture_kb") {
+            request->texture_size_kb = strtoul(value.c_str(), nullptr, 10);
+            ok = request->texture_size_kb > 0 && request->texture_size_kb <= DAEMON_MAX_TEXTURE_KB;
+        } else if (key == "pixels") {
+            request->pixels = strtoul(value.c_str(), nullptr, 10);
+        } else if (key == "trials") {
+            ok = parse_bool(value, &request->stream_trials);
+        } else {
+            *error = "unknown key '" + key + "'";
+            return false;
+        }
+        if (!ok) {
+            *error = "bad value '" + value + "' for " + key;
+            return false;
+        }
+    }
+    //A compressed LLC only models LRU and LFU; any other policy would silently run uncompressed
+    if (request->compressed && request->replace_policy != REPLACE_POLICY_LRU && request->replace_policy != REPLACE_POLICY_LFU) {
+        *error = std::string("compressed needs policy LRU or LFU, not ") + policy_names[request->replace_policy];
+        return false;
+    }
+    return true;
+}
+
+//Streams the request's results to out. Returns false once the daemon should shut down.
+bool daemon_handle_request(const daemon_request_t* request, FILE* out) {
+    daemon_clock_t::time_point start = daemon_clock_t::now();
+    bool cached = true;
+    switch (request->kind) {
+        case DAEMON_REQ_ATTACK:
+            handle_attack(request, get_warm_snapshot(request, &cached), out);
+            break;
+        case DAEMON_REQ_WALK:
+            print_walk(request, request->texture_size_kb, get_warm_snapshot(request, &cached), out);
+            fprintf(out, "{\"done\": true, \"kind\": \"walk\"");
+            break;
+        case DAEMON_REQ_SWEEP: {
+            const sim_snapshot_t* warm = get_warm_snapshot(request, &cached);
+            for (uint32_t kb = 1; kb <= DAEMON_MAX_TEXTURE_KB; kb *= 2) {
+                print_walk(request, kb, warm, out);
+            }
+            fprintf(out, "{\"done\": true, \"kind\": \"sweep\"");
+            break;
+        }
+        case DAEMON_REQ_STATUS:
+            fprintf(out, "{\"done\": true, \"kind\": \"status\", \"frames\": %zu, \"textures\": %zu, \"line_lists\": %zu, \"snapshots\": %zu", 
+                m_Frames.size(), resident_textures.size(), resident_lines.size(), warm_snapshots.size());
+            break;
+        case DAEMON_REQ_SHUTDOWN:
+            fprintf(out, "{\"done\": true, \"kind\": \"shutdown\"}\n");
+            fflush(out);
+            return false;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(daemon_clock_t::now() - start).count();
+    if (request->kind != DAEMON_REQ_STATUS) {
+        fprintf(out, ", \"warm_cached\": %s", cached ? "true" : "false");
+    }
+    fprintf(out, ", \"ms\": %.3f}\n", ms);
+    fflush(out);
+    return true;
+}
+
+namespace {
+    //Connections are served on their own threads, but the simulator is process-wide, so requests run one
+    //at a time under serve_mutex.
+    std::mutex serve_mutex;
+    std::atomic<bool> serving;
+    int server_fd = -1;
+
+    std::mutex clients_mutex;
+    std::condition_variable clients_done;
+    std::set<int> client_fds;
+    uint64_t num_clients;
+
+    //Wakes the accept loop and every client blocked reading its next request, so they all return.
+    void stop_serving() {
+        serving = false;
+        shutdown(server_fd, SHUT_RDWR);
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        for (int fd : client_fds) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+    void serve_client(int client) {
+        FILE* in = fdopen(client, "r");
+        FILE* out = fdopen(dup(client), "w");
+
+        char* line = nullptr;
+        size_t capacity = 0;
+        while (serving && getline(&line, &capacity, in) > 0) {
+            daemon_request_t request;
+            std::string error;
+            if (line[strspn(line, " \t\r\n")] == '\0') {
+                continue;
+            }
+            if (!daemon_parse_request(line, &request, &error)) {
+                fprintf(out, "{\"done\": true, \"error\": \"%s\"}\n", json_escape(error).c_str());
+                fflush(out);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(serve_mutex);
+            if (!serving) {
+                break;
+            }
+            if (!daemon_handle_request(&request, out)) {
+                lock.unlock();
+                stop_serving();
+            }
+        }
+        free(line);
+
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            client_fds.erase(client);
+        }
+        fclose(in);
+        fclose(out);
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        num_clients--;
+        clients_done.notify_all();
+    }
+}
+
+//Serves every connection concurrently until a shutdown request; each connection may send any number of
+//requests. Requests from different connections take turns on the simulator, so a client holding its
+//connection open never blocks the others, but a long request delays everyone's next one.
+int daemon_serve(const char* socket_path) {
+    signal(SIGPIPE, SIG_IGN);
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (server < 0 || strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Bad socket path %s\n", socket_path);
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path);
+    if (bind(server, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(server, 8) != 0) {
+        perror("bind");
+        close(server);
+        return 1;
+    }
+
+    daemon_init();
+    fprintf(stderr, "Listening on %s\n", socket_path);
+
+    server_fd = server;
+    serving = true;
+    while (serving) {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        if (!serving) {
+            close(client);
+            break;
+        }
+        client_fds.insert(client);
+        num_clients++;
+        std::thread(serve_client, client).detach();
+    }
+
+    std::unique_lock<std::mutex> lock(clients_mutex);
+    clients_done.wait(lock, []() { return num_clients == 0; });
+    close(server);
+    unlink(socket_path);
+    return 0;
+}
+
+//Sends one request and copies the streamed results to stdout.
+int daemon_query(const char* socket_path, const char* request) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0) {
+        perror("connect");
+        return 1;
+    }
+
+    std::string line = std::string(request) + "\n";
+    if (write(fd, line.data(), line.size()) != (ssize_t) line.size()) {
+        perror("write");
+        close(fd);
+        return 1;
+    }
+    shutdown(fd, SHUT_WR);
+
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        fwrite(buffer, 1, n, stdout);
+    }
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,51 @@
+//Experiment daemon. Keeps the attack frames, their compressed line addresses and warmed cache snapshots
+//resident, and answers requests on a Unix domain socket so what-if queries skip process startup, frame
+//generation, compression and the LLC warm-up.
+//
+//Protocol: one flat JSON object per line, e.g.
+//  {"kind": "attack", "s": 4, "policy": "SRRIP", "facade": false, "pixels": 64}
+//  {"kind": "walk", "texture_kb": 32}      {"kind": "sweep"}      {"kind": "status"}      {"kind": "shutdown"}
+//Optional keys: s, policy (LRU, LFU, SRRIP, BRRIP, QLRU), sample_sets, compressed (LRU and LFU only), facade,
+//facade_mode (full, selective, pad), render_order and walk_order (linear, reverse, morton, tiled, random),
+//order_seed, pixels, trials (stream each attacked pixel, default true). Unset keys default to cache_config,
+//facade_mode and attack_order. Results stream back as JSON lines, the last of which has "done": true.
+//Each connection is served on its own thread; requests from all of them run on the simulator one at a time.
+
+#ifndef DAEMON_HPP
+#define DAEMON_HPP
+
+#include "cache_sim.hpp"
+#include "frame.hpp"
+
+#include <cstdio>
+#include <string>
+
+typedef enum daemon_request_kind {
+    DAEMON_REQ_ATTACK,      //Pixel attack over the resident victim
+    DAEMON_REQ_WALK,        //LLC walk after a black and a noise texture of texture_kb
+    DAEMON_REQ_SWEEP,       //DAEMON_REQ_WALK for every power of two texture size up to 128KB
+    DAEMON_REQ_STATUS,      //What is resident
+    DAEMON_REQ_SHUTDOWN,
+} daemon_request_kind_t;
+
+typedef struct {
+    daemon_request_kind_t kind;
+    uint64_t s;
+    replace_policy_t replace_policy;
+    uint64_t sample_sets;
+    bool compressed;
+    bool use_facade;
+    facade_mode_t facade_mode;
+    attack_order_t order;
+    uint32_t texture_size_kb;
+    uint32_t pixels;
+    bool stream_trials;
+} daemon_request_t;
+
+extern void daemon_init();
+extern bool daemon_parse_request(const char* line, daemon_request_t* request, std::string* error);
+extern bool daemon_handle_request(const daemon_request_t* request, FILE* out);
+extern int daemon_serve(const char* socket_path);
+extern int daemon_query(const char* socket_path, const char* request);
+
+#endif
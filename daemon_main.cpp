@@ -0,0 +1,27 @@
+//Usage: compress_daemon serve <socket>
+//       compress_daemon query <socket> '<request>'     (see daemon.hpp for the protocol)
+
+//Stdlib Things
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "time.h"
+
+//My Things
+#include "daemon.hpp"
+#include "experiment.hpp"
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "serve") == 0) {
+        init_cache_config();
+        srand(time(NULL));
+        return daemon_serve(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "query") == 0) {
+        return daemon_query(argv[2], argv[3]);
+    }
+
+    fprintf(stderr, "Usage: compress_daemon serve <socket>\n");
+    fprintf(stderr, "       compress_daemon query <socket> '<request>'\n");
+    return 1;
+}
@@ -4,260 +4,158 @@
 #include "time.h"
 
 //My Things
-#include "cache_sim.hpp"
-#include "frame.hpp"
+#include "experiment.hpp"
+#include "facade_profile.hpp"
+#include "heatmap.hpp"
+#include "hostprof.hpp"
+#include "pipeline.hpp"
+#include "probe.hpp"
+#include "render.hpp"
+#include "timing.hpp"
 
-#define TIMING_THRESHOLD_BASELINE 62
-#define TIMING_THRESHOLD_FACADE 34
-#define NUM_LAYERS 10
+//Sequential early stopping: stop once the 95% interval on the accuracy is this narrow, 0 attacks every pixel.
+#define ATTACK_CI_WIDTH 0.0
+#define ATTACK_MIN_TRIALS 30
 
-#define C 16
-#define B 6
-#define S 10    //C-B for full associativity
+//Compress on a producer thread while simulating on this one, and print the stage throughputs.
+#define ATTACK_PIPELINED false
 
-// typedef struct {
-//     double accuracy;
-//     double avg_render_time;
-// } stats_t;
+//Attacker and victim on two cores sharing the LLC, interleaved by the sequencer when ATTACK_SEQUENCED.
+#define ATTACK_SHARED_LLC false
+#define ATTACK_SEQUENCED true
 
-typedef struct {
-    uint64_t num_evictions;
-    double walk_time;
-} llc_walk_stats_t;
+//Every trial is saved here for compress_eval, "" to skip.
+#define TRIAL_STORE_PATH ""
 
-typedef struct {
-    uint64_t texture_size;
-    llc_walk_stats_t uncompressed;
-    llc_walk_stats_t compressed;
-} llc_walk_stats_combined_t;
+//The attack checkpoints here and resumes from it after a crash, "" to skip.
+#define ATTACK_CHECKPOINT_PATH ""
 
+//Prime+Probe this many LLC sets instead of walking the whole buffer, 0 for the walk. With
+//ATTACK_COMPARE_PROBE, compare the walk against probing ATTACK_COMPARE_PROBE_SETS instead.
+#define ATTACK_PROBE_SETS 0
+#define ATTACK_COMPARE_PROBE false
+#define ATTACK_COMPARE_PROBE_SETS {64, 16, 4}
 
-// static stats_t stats_baseline;
-// static stats_t stats_facade;
+//Render the attacker frame through NUM_LAYERS filter layers and also report how well the render time
+//alone separates the pixels.
+#define ATTACK_LAYERED false
 
-//Cache
-static sim_config_t cache_config;
+//Orders the attacker frame is rendered in and the buffer is walked in, see access_order.hpp.
+#define ATTACK_RENDER_ORDER ACCESS_ORDER_LINEAR
+#define ATTACK_WALK_ORDER ACCESS_ORDER_REVERSE
 
-static std::string channel_to_str[] = {
-    "Red", "Green", "Blue", "Alpha"
-};
+//The facade the defended reads use, and whether to profile the cost and accuracy of every facade instead.
+#define FACADE_MODE FACADE_FULL
+#define PROFILE_FACADES false
 
-// static std::string bool_to_string(bool value) {
-//     return value ? "Yes" : "No";
-// }
+//Standard deviation of Gaussian jitter on every access latency, 0 for fixed latencies.
+#define ATTACK_TIMING_SIGMA 0.0
 
-// static void print_compress_result(std::string name, const compress_result_t* result) {
-//     printf("Compressed pattern: %s\n", name.c_str());
-//     printf("\tDid Compression: %s\n", bool_to_string(result->did_compression).c_str());
-//     printf("\tCompression Ratio: %.2f\n", result->compress_ratio);
-//     printf("\tLLC Time: %.2f\n", result->llc_time);
-//     for (size_t c = 0; c < 4; c++) {
-//         printf("\t%s Channel\n", channel_to_str[c].c_str());
-//         printf("\t\tSkip Bit: %d\n", result->skip[c]);
-//         printf("\t\t Prediction: %d\n", result->prediction[c]);
-//         printf("\t\t NumBits: %d\n", result->numBits[c]);
-//     }
-//     printf("\n");
-// }
+//Print the per-phase access and window latency percentiles of the attack.
+#define LATENCY_HISTOGRAMS false
 
-// void print_stats(stats_t* stats) {
-//     printf("\tAccuracy: %.4f\n", stats->accuracy);
-//     printf("\tAverage Render Time: %.4f\n", stats->avg_render_time);
-// }
+//With make HEATMAP=1, the LLC's per-set conflict heatmaps for the attack are written here.
+#define HEATMAP_PATH "heatmap.tsv"
+#define HEATMAP_SAMPLE_SHIFT 0
 
-static void print_cache_stats(sim_stats_t* stats) {
-    printf("Cache Statistics\n");
-    printf("----------------\n");
-    printf("Reads: %" PRIu64 "\n", stats->reads);
-    printf("Writes: %" PRIu64 "\n", stats->writes);
-    printf("\n");
-    printf("L1 accesses: %" PRIu64 "\n", stats->accesses_l1);
-    printf("L1 hits: %" PRIu64 "\n", stats->hits_l1);
-    printf("L1 misses: %" PRIu64 "\n", stats->misses_l1);
-    printf("L1 hit ratio: %.3f\n", stats->hit_ratio_l1);
-    printf("L1 miss ratio: %.3f\n", stats->miss_ratio_l1);
-    printf("L1 average access time (AAT): %.3f\n", stats->avg_access_time_l1);
-    printf("\n");
-    printf("Number of Evictions: %" PRIu64 "\n", stats->num_evictions);
-    printf("LLC Walk Time: %.3f\n", stats->llc_walk_time);
-    // printf("\n");
-    // printf("L2 reads: %" PRIu64 "\n", stats->reads_l2);
-    // printf("L2 writes: %" PRIu64 "\n", stats->writes_l2);
-    // printf("L2 read hits: %" PRIu64 "\n", stats->read_hits_l2);
-    // printf("L2 read misses: %" PRIu64 "\n", stats->read_misses_l2);
-    // printf("L2 prefetches: %" PRIu64 "\n", stats->prefetches_l2);
-    // printf("L2 read hit ratio: %.3f\n", stats->read_hit_ratio_l2);
-    // printf("L2 read miss ratio: %.3f\n", stats->read_miss_ratio_l2);
-    // printf("L2 average access time (AAT): %.3f\n", stats->avg_access_time_l2);
-}
-
-// static bool correct_guess(bool guess_white, uint8_t* pixel) {
-//     bool correct_guess = (guess_white && pixel[0] > 128) || (!guess_white && pixel[0] < 128);
-//     return correct_guess;
-// }
-
-static void init_cache_config() {
-    cache_config.l1_config.c = C;
-    cache_config.l1_config.b = B;
-    cache_config.l1_config.s = S;   //S=0: Direct Mapped, S=3: 8-Way Set Associative, S=10 (16-6): Fully Associative
-    cache_config.l1_config.replace_policy = REPLACE_POLICY_LRU;
-    cache_config.l1_config.write_strat = WRITE_STRAT_WBWA;
-    cache_config.l1_config.prefetcher_disabled = true;
-
-    //Don't use second cache.
-    cache_config.l2_config.disabled = true;
-}
-
-static void init_stats(sim_stats_t* stats) {
-    stats->accesses_l1 = 0;
-    stats->reads = 0;
-    stats->writes = 0;
-    stats->hits_l1 = 0;
-    stats->misses_l1 = 0;
-    stats->num_evictions = 0;
-    stats->llc_walk_time = 0;
-}
-
-void measure_llc_walk(size_t num_windows, llc_walk_stats_combined_t* stats, bool use_facade = false) {
-    sim_stats_t cache_stats_black;
-    init_stats(&cache_stats_black);
-    sim_stats_t cache_stats_noise;
-    init_stats(&cache_stats_noise);
-
-    frame_t* buffer_frame = get_new_frame_random(FRAME_NUM_WINDOWS_CACHE);
-    frame_t* frame_black = get_new_frame_black(num_windows);
-    frame_t* frame_noise = get_new_frame_random(num_windows);
-    //print_frame_nWindows();
-
-    //RUN COMPRESSED LAYERS
+int main() {
+    init_cache_config();
+    srand(time(NULL));
+    attack_order = {ATTACK_RENDER_ORDER, ATTACK_WALK_ORDER, (uint64_t) time(NULL)};
+    facade_mode = FACADE_MODE;
 
-    sim_setup(&cache_config);
-    read_frame(buffer_frame, &cache_stats_black);    //Dummy frame to fill entire LLC
-    if (use_facade) {
-        read_frame_facade(frame_black, &cache_stats_black);
-    } else {
-        read_frame(frame_black, &cache_stats_black);
+#ifdef SIM_HOSTPROF
+    if (!hostprof_init()) {
+        fprintf(stderr, "Hardware counters unavailable, profiling time only\n");
+    }
+#endif
+
+    if (ATTACK_TIMING_SIGMA > 0) {
+        timing_model_t timing;
+        timing_model_init(&timing, TIMING_MODEL_GAUSSIAN);
+        timing.seed = time(NULL);
+        timing.hit_sigma = ATTACK_TIMING_SIGMA;
+        timing.miss_sigma = ATTACK_TIMING_SIGMA;
+        timing_set_model(&timing);
     }
-    cache_stats_black.llc_walk_time = read_frame_backwards(buffer_frame, &cache_stats_black);
-    sim_finish(&cache_stats_black);
-
-    // print_cache_stats(&cache_stats_black);
-
-    stats->compressed.num_evictions = cache_stats_black.num_evictions;
-    stats->compressed.walk_time = cache_stats_black.llc_walk_time;
 
-    //RUN UNCOMPRESSED LAYERS
-    sim_setup(&cache_config);
-    read_frame(buffer_frame, &cache_stats_noise);    //Dummy frame to fill entire LLC
-    if (use_facade) {
-        read_frame_facade(frame_noise, &cache_stats_black);
+    //Trials are only recorded when they are saved
+    trial_store_t storage;
+    trial_store_t* store = TRIAL_STORE_PATH[0] != '\0' ? &storage : nullptr;
+    phase_latency_t* latency = nullptr;
+    if (LATENCY_HISTOGRAMS) {
+        latency = new phase_latency_t;
+        latency_clear(latency);
+        latency_attach(latency);
+    }
+#ifdef SIM_HEATMAP
+    heatmap_t heatmap;
+    const cache_config_t& llc = cache_config.l1_config;
+    heatmap_init(&heatmap, 1, 1ull << (llc.c - llc.b - llc.s), HEATMAP_SAMPLE_SHIFT, find_frame_at);
+    heatmap_attach(&heatmap);
+#endif
+    if (ATTACK_CI_WIDTH > 0) {
+        early_stop_config_t stop = {ATTACK_CI_WIDTH, ATTACK_MIN_TRIALS, (uint64_t) time(NULL)};
+        attack_result_t result = do_pixel_attack_sequential(false, &stop, store);
+        printf("%.2f [%.2f, %.2f] after %" PRIu64 " pixels\n", result.accuracy, result.ci_low, result.ci_high, result.trials);
+    } else if (PROFILE_FACADES) {
+        std::vector<facade_cost_t> costs;
+        profile_facades(&costs);
+        print_facade_costs(costs, stdout);
+    } else if (ATTACK_PIPELINED) {
+        pipeline_stats_t stats;
+        double accuracy = do_pixel_attack_pipelined(false, store, &stats);
+        printf("%.2f\n", accuracy);
+        print_pipeline_stats(&stats);
+    } else if (ATTACK_COMPARE_PROBE) {
+        std::vector<probe_comparison_t> comparison;
+        std::vector<uint64_t> probe_sets = ATTACK_COMPARE_PROBE_SETS;
+        probe_sets.insert(probe_sets.begin(), 0);
+        compare_probe_attack(false, probe_sets, &comparison);
+        print_probe_comparison(comparison);
+    } else if (ATTACK_PROBE_SETS > 0) {
+        double accuracy = do_pixel_attack_probe(false, ATTACK_PROBE_SETS, store);
+        printf("%.2f\n", accuracy);
+    } else if (ATTACK_LAYERED) {
+        trial_store_t render_store;
+        double accuracy = do_pixel_attack_layers(false, NUM_LAYERS, store, &render_store);
+        threshold_eval_t render = evaluate_thresholds(&render_store, 0);
+        printf("%.2f\n", accuracy);
+        printf("Render time over %d layers: AUC %.3f, best threshold %.0f, accuracy %.2f\n", NUM_LAYERS, render.auc, render.best_threshold, render.best_accuracy);
+    } else if (ATTACK_SHARED_LLC) {
+        double accuracy = do_pixel_attack_shared(false, ATTACK_SEQUENCED, store);
+        printf("%.2f\n", accuracy);
     } else {
-        read_frame(frame_noise, &cache_stats_black);
+        double accuracy = do_pixel_attack(false, store, ATTACK_CHECKPOINT_PATH[0] != '\0' ? ATTACK_CHECKPOINT_PATH : nullptr);
+        printf("%.2f\n", accuracy);
     }
-    cache_stats_noise.llc_walk_time = read_frame_backwards(buffer_frame, &cache_stats_noise);
-    sim_finish(&cache_stats_noise);
-
-    // print_cache_stats(&cache_stats_noise);
-
-    stats->uncompressed.num_evictions = cache_stats_noise.num_evictions;
-    stats->uncompressed.walk_time = cache_stats_noise.llc_walk_time;
 
-    // printf("TEXTURE SIZE: %ldKB\n", num_windows*2*WINDOW_SIZE_COMPRESSED / 1024);
-    // printf("--------------------------------\n");
-    // printf("BLACK LLC TIME\n");
-    // print_cache_stats(&cache_stats_black);
-    // printf("\n");
-    // printf("NOISE LLC TIME\n");
-    // print_cache_stats(&cache_stats_noise);
-    // printf("\n");
-
-    free_frames();
-}
-
-void print_stats_csv(llc_walk_stats_combined_t* stats, uint64_t num_stats) {
-    printf("Texture Size\tLLC Walk Time (Uncompressed)\tLLC Walk Time (Compressed)\n");
-    for (uint64_t i = 0; i < num_stats; i++) {
-        printf("%" PRIu64 "\t%.2f\t%.2f\n", 
-            stats[i].texture_size,
-            stats[i].uncompressed.walk_time / 1000, 
-            stats[i].compressed.walk_time / 1000);
+    if (latency != nullptr) {
+        latency_attach(nullptr);
+        print_phase_latency(latency, stdout);
+        delete latency;
     }
-}
-
-double do_pixel_attack(bool use_facade) {
-    //1024x1024 pixel frame
-    frame_t* victim_frame = get_new_frame_checkerboard(32);
-
-    uint64_t correct_pixels = 0;
-    uint64_t total_pixels = 0;
-
-    frame_t* buffer_frame = get_new_frame_random(FRAME_NUM_WINDOWS_CACHE);
-    frame_t* frame_black = get_new_frame_black(FRAME_NUM_WINDOWS_CACHE);
-    frame_t* frame_noise = get_new_frame_random(FRAME_NUM_WINDOWS_CACHE);
-
-    for (size_t w = 0; w < 32; w++) {
-        for (size_t p = 0; p < 32; p++) {
-            sim_stats_t cache_stats;
-            init_stats(&cache_stats);
 
-            sim_setup(&cache_config);
-            read_frame(buffer_frame, &cache_stats);    //Dummy frame to fill entire LLC
-
-            //get which frame to use
-            frame_t* attacker_frame;
-            bool actual_white = victim_frame->windows[w].pixels[p][0] > 127;
-            if (actual_white) {
-                attacker_frame = frame_noise;
-            } else {
-                attacker_frame = frame_black;
-            }
-
-            if (use_facade) {
-                read_frame_facade(attacker_frame, &cache_stats);
-            } else {
-                read_frame(attacker_frame, &cache_stats);
-            }
-            cache_stats.llc_walk_time = read_frame_backwards(buffer_frame, &cache_stats);
-            sim_finish(&cache_stats);
-
-            //Guess the Pixel
-            bool guess_white = cache_stats.llc_walk_time / 1000 > TIMING_THRESHOLD_BASELINE;
-            if (guess_white == actual_white) {
-                correct_pixels++;
-            } 
-
-            total_pixels++;
-        }
+#ifdef SIM_HOSTPROF
+    print_hostprof(stdout);
+    hostprof_close();
+#endif
+
+#ifdef SIM_HEATMAP
+    heatmap_detach();
+    FILE* heatmap_file = fopen(HEATMAP_PATH, "w");
+    if (heatmap_file == nullptr) {
+        fprintf(stderr, "Could not write %s\n", HEATMAP_PATH);
+        return 1;
     }
-
-    return (double) correct_pixels / 1024;
-}
-
-void generate_llc_times() {
-    uint64_t lowBoundKB = 1;
-    uint64_t upBoundKB = 128;
-    uint64_t strideKB = 1;
-    uint64_t num_iter = (upBoundKB - lowBoundKB) / strideKB + 1;
-
-    llc_walk_stats_combined_t* stats = new llc_walk_stats_combined_t[num_iter];
-    for (uint64_t i = 0; i < num_iter; i++) {
-        uint64_t nKB = lowBoundKB + i*strideKB;
-        if (nKB > upBoundKB) {
-            nKB = upBoundKB;
-        }
-        stats[i].texture_size = nKB;
-        measure_llc_walk(8*nKB, &stats[i], true);
+    for (size_t phase = 0; phase < HEATMAP_NUM_PHASES; phase++) {
+        heatmap_dump_phase(&heatmap, (sim_phase_t) phase, heatmap_file);
     }
+    fclose(heatmap_file);
+#endif
 
-    print_stats_csv(stats, num_iter);
-
-    delete[] stats;
+    if (store != nullptr && !trial_store_save(store, TRIAL_STORE_PATH)) {
+        fprintf(stderr, "Could not write %s\n", TRIAL_STORE_PATH);
+        return 1;
+    }
 }
-
-int main() {
-    init_cache_config();
-    srand(time(NULL));
-
-    double accuracy = do_pixel_attack(false);
-    printf("%.2f\n", accuracy);
-}
\ No newline at end of file
@@ -0,0 +1,82 @@
+//Offline threshold evaluation of a saved trial store: accuracy at every threshold, ROC/AUC and the
+//optimal threshold per configuration, without re-running the simulation.
+//
+//Usage: compress_eval <trials> [--roc] [--threshold T]
+
+//Stdlib Things
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//My Things
+#include "experiment.hpp"
+
+static const char* policy_to_str[] = {
+    "LRU", "LFU", "SRRIP", "BRRIP", "QLRU"
+};
+
+static const char* policy_name(replace_policy_t policy) {
+    return (uint32_t) policy < sizeof(policy_to_str) / sizeof(policy_to_str[0]) ? policy_to_str[policy] : "unknown";
+}
+
+static void usage() {
+    fprintf(stderr, "Usage: compress_eval <trials> [--roc] [--threshold T]\n");
+    fprintf(stderr, "  --roc          Print every ROC point as CSV\n");
+    fprintf(stderr, "  --threshold T  Also report the accuracy at T (default: the config's built-in threshold)\n");
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    bool print_roc = false;
+    double threshold = -1.0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--roc") == 0) {
+            print_roc = true;
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && path == nullptr) {
+            path = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (path == nullptr) {
+        usage();
+        return 1;
+    }
+
+    trial_store_t store;
+    if (!trial_store_load(&store, path)) {
+        fprintf(stderr, "Could not read %s\n", path);
+        return 1;
+    }
+
+    for (size_t c = 0; c < store.configs.size(); c++) {
+        const trial_config_t* config = &store.configs[c];
+        const cache_config_t* llc = &config->sim.l1_config;
+        double fixed = threshold >= 0 ? threshold : 
+            (config->use_facade ? TIMING_THRESHOLD_FACADE : TIMING_THRESHOLD_BASELINE);
+
+        std::vector<roc_point_t> roc;
+        threshold_eval_t eval = evaluate_thresholds(&store, (uint16_t) c, print_roc ? &roc : nullptr);
+
+        printf("Config %zu: (C,B,S)=(%" PRIu64 ",%" PRIu64 ",%" PRIu64 ") %s%s%s, render %s, walk %s\n", c, llc->c, llc->b, llc->s, 
+            policy_name(llc->replace_policy), config->use_facade ? " facade " : "", 
+            config->use_facade ? facade_mode_name(config->facade_mode) : "",
+            access_order_name(config->order.render), access_order_name(config->order.walk));
+        printf("\tTrials: %" PRIu64 "\n", eval.trials);
+        printf("\tAUC: %.4f\n", eval.auc);
+        printf("\tBest Threshold: %.3f (accuracy %.4f)\n", eval.best_threshold, eval.best_accuracy);
+        printf("\tAccuracy at %.3f: %.4f\n", fixed, trial_store_accuracy(&store, (uint16_t) c, fixed));
+
+        if (print_roc) {
+            printf("threshold,tpr,fpr,accuracy\n");
+            for (const roc_point_t& point : roc) {
+                printf("%.3f,%.4f,%.4f,%.4f\n", point.threshold, point.true_positive_rate, 
+                    point.false_positive_rate, point.accuracy);
+            }
+        }
+    }
+}
@@ -0,0 +1,562 @@
+//Stdlib Things
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdlib.h>
+#include <vector>
+
+//My Things
+#include "experiment.hpp"
+#include "checkpoint.hpp"
+
+#define C 16
+#define B 6
+#define S 10    //C-B for full associativity
+
+#define SAMPLE_SETS 0   //Number of LLC sets to simulate, 0 for all of them
+#define COMPRESSED_LLC false    //Compressed windows take half a way of the LLC, see cache_config_t::compressed
+
+#define ATTACK_CHECKPOINT_PIXELS 64
+
+// typedef struct {
+//     double accuracy;
+//     double avg_render_time;
+// } stats_t;
+
+// static stats_t stats_baseline;
+// static stats_t stats_facade;
+
+//Cache
+sim_config_t cache_config;
+attack_order_t attack_order = {ACCESS_ORDER_LINEAR, ACCESS_ORDER_REVERSE, 0};
+
+static std::string channel_to_str[] = {
+    "Red", "Green", "Blue", "Alpha"
+};
+
+// static std::string bool_to_string(bool value) {
+//     return value ? "Yes" : "No";
+// }
+
+// static void print_compress_result(std::string name, const compress_result_t* result) {
+//     printf("Compressed pattern: %s\n", name.c_str());
+//     printf("\tDid Compression: %s\n", bool_to_string(result->did_compression).c_str());
+//     printf("\tCompression Ratio: %.2f\n", result->compress_ratio);
+//     printf("\tLLC Time: %.2f\n", result->llc_time);
+//     for (size_t c = 0; c < 4; c++) {
+//         printf("\t%s Channel\n", channel_to_str[c].c_str());
+//         printf("\t\tSkip Bit: %d\n", result->skip[c]);
+//         printf("\t\t Prediction: %d\n", result->prediction[c]);
+//         printf("\t\t NumBits: %d\n", result->numBits[c]);
+//     }
+//     printf("\n");
+// }
+
+// void print_stats(stats_t* stats) {
+//     printf("\tAccuracy: %.4f\n", stats->accuracy);
+//     printf("\tAverage Render Time: %.4f\n", stats->avg_render_time);
+// }
+
+void print_cache_stats(sim_stats_t* stats) {
+    printf("Cache Statistics\n");
+    printf("----------------\n");
+    printf("Reads: %" PRIu64 "\n", stats->reads);
+    printf("Writes: %" PRIu64 "\n", stats->writes);
+    printf("\n");
+    printf("L1 accesses: %" PRIu64 "\n", stats->accesses_l1);
+    printf("L1 hits: %" PRIu64 "\n", stats->hits_l1);
+    printf("L1 misses: %" PRIu64 "\n", stats->misses_l1);
+    printf("L1 hit ratio: %.3f\n", stats->hit_ratio_l1);
+    printf("L1 miss ratio: %.3f\n", stats->miss_ratio_l1);
+    printf("L1 average access time (AAT): %.3f\n", stats->avg_access_time_l1);
+    printf("\n");
+    printf("Number of Evictions: %" PRIu64 "\n", stats->num_evictions);
+    printf("LLC Walk Time: %.3f\n", stats->llc_walk_time);
+    if (stats->sampled_sets < stats->total_sets) {
+        printf("Sampled Sets: %" PRIu64 " / %" PRIu64 "\n", stats->sampled_sets, stats->total_sets);
+        printf("Number of Evictions 95%% CI: +/- %.1f\n", stats->num_evictions_ci);
+        printf("LLC Walk Time 95%% CI: +/- %.3f\n", stats->llc_walk_time_ci);
+    }
+    // printf("\n");
+    // printf("L2 reads: %" PRIu64 "\n", stats->reads_l2);
+    // printf("L2 writes: %" PRIu64 "\n", stats->writes_l2);
+    // printf("L2 read hits: %" PRIu64 "\n", stats->read_hits_l2);
+    // printf("L2 read misses: %" PRIu64 "\n", stats->read_misses_l2);
+    // printf("L2 prefetches: %" PRIu64 "\n", stats->prefetches_l2);
+    // printf("L2 read hit ratio: %.3f\n", stats->read_hit_ratio_l2);
+    // printf("L2 read miss ratio: %.3f\n", stats->read_miss_ratio_l2);
+    // printf("L2 average access time (AAT): %.3f\n", stats->avg_access_time_l2);
+}
+
+// static bool correct_guess(bool guess_white, uint8_t* pixel) {
+//     bool correct_guess = (guess_white && pixel[0] > 128) || (!guess_white && pixel[0] < 128);
+//     return correct_guess;
+// }
+
+void init_cache_config() {
+    cache_config.l1_config.c = C;
+    cache_config.l1_config.b = B;
+    cache_config.l1_config.s = S;   //S=0: Direct Mapped, S=3: 8-Way Set Associative, S=10 (16-6): Fully Associative
+    cache_config.l1_config.replace_policy = REPLACE_POLICY_LRU;
+    cache_config.l1_config.write_strat = WRITE_STRAT_WBWA;
+    cache_config.l1_config.prefetcher_disabled = true;
+    cache_config.l1_config.compressed = COMPRESSED_LLC;
+
+    //Don't use second cache.
+    cache_config.l2_config.disabled = true;
+
+    cache_config.sample_sets = SAMPLE_SETS;
+}
+
+void init_stats(sim_stats_t* stats) {
+    stats->accesses_l1 = 0;
+    stats->reads = 0;
+    stats->writes = 0;
+    stats->hits_l1 = 0;
+    stats->misses_l1 = 0;
+    stats->num_evictions = 0;
+    stats->llc_walk_time = 0;
+    stats->sampled_sets = 0;
+    stats->total_sets = 0;
+    stats->num_evictions_ci = 0;
+    stats->llc_walk_time_ci = 0;
+}
+
+//Fills in the walk percentiles of one layer from its histograms, hands them on to the caller's
+//histograms if it attached any, and clears them for the next layer.
+static void take_walk_latency(phase_latency_t* latency, phase_latency_t* outer, llc_walk_stats_t* stats) {
+    stats->walk_p50 = hdr_hist_percentile(&latency->window[SIM_PHASE_WALK], 50);
+    stats->walk_p99 = hdr_hist_percentile(&latency->window[SIM_PHASE_WALK], 99);
+    if (outer != nullptr) {
+        latency_merge(outer, latency);
+    }
+    latency_clear(latency);
+}
+
+void measure_llc_walk(size_t num_windows, llc_walk_stats_combined_t* stats, bool use_facade) {
+    sim_stats_t cache_stats_black;
+    init_stats(&cache_stats_black);
+    sim_stats_t cache_stats_noise;
+    init_stats(&cache_stats_noise);
+
+    frame_t* buffer_frame = get_new_frame_random(FRAME_NUM_WINDOWS_CACHE);
+    frame_t* frame_black = get_new_frame_black(num_windows);
+    frame_t* frame_noise = get_new_frame_random(num_windows);
+    //print_frame_nWindows();
+
+    static thread_local std::unique_ptr<phase_latency_t> latency(new phase_latency_t);
+    latency_clear(latency.get());
+    phase_latency_t* outer = latency_attach(latency.get());
+
+    //RUN COMPRESSED LAYERS
+
+    sim_setup(&cache_config);
+    read_frame(buffer_frame, &cache_stats_black);    //Dummy frame to fill entire LLC
+    sim_set_phase(SIM_PHASE_ATTACK);
+    if (use_facade) {
+        read_frame_facade(frame_black, &cache_stats_black);
+    } else {
+        read_frame(frame_black, &cache_stats_black);
+    }
+    sim_set_phase(SIM_PHASE_WALK);
+    cache_stats_black.llc_walk_time = read_frame_backwards(buffer_frame, &cache_stats_black);
+    sim_finish(&cache_stats_black);
+
+    // print_cache_stats(&cache_stats_black);
+
+    stats->compressed.num_evictions = cache_stats_black.num_evictions;
+    stats->compressed.walk_time = cache_stats_black.llc_walk_time;
+    take_walk_latency(latency.get(), outer, &stats->compressed);
+
+    //RUN UNCOMPRESSED LAYERS
+    sim_setup(&cache_config);
+    read_frame(buffer_frame, &cache_stats_noise);    //Dummy frame to fill entire LLC
+    sim_set_phase(SIM_PHASE_ATTACK);
+    if (use_facade) {
+        read_frame_facade(frame_noise, &cache_stats_black);
+    } else {
+        read_frame(frame_noise, &cache_stats_black);
+    }
+    sim_set_phase(SIM_PHASE_WALK);
+    cache_stats_noise.llc_walk_time = read_frame_backwards(buffer_frame, &cache_stats_noise);
+    sim_finish(&cache_stats_noise);
+
+    // print_cache_stats(&cache_stats_noise);
+
+    stats->uncompressed.num_evictions = cache_stats_noise.num_evictions;
+    stats->uncompressed.walk_time = cache_stats_noise.llc_walk_time;
+    take_walk_latency(latency.get(), outer, &stats->uncompressed);
+    latency_attach(outer);
+
+    // printf("TEXTURE SIZE: %ldKB\n", num_windows*2*WINDOW_SIZE_COMPRESSED / 1024);
+    // printf("--------------------------------\n");
+    // printf("BLACK LLC TIME\n");
+    // print_cache_stats(&cache_stats_black);
+    // printf("\n");
+    // printf("NOISE LLC TIME\n");
+    // print_cache_stats(&cache_stats_noise);
+    // printf("\n");
+
+    free_frames();
+}
+
+void print_stats_csv(llc_walk_stats_combined_t* stats, uint64_t num_stats) {
+    printf("Texture Size\tLLC Walk Time (Uncompressed)\tLLC Walk Time (Compressed)\n");
+    for (uint64_t i = 0; i < num_stats; i++) {
+        printf("%" PRIu64 "\t%.2f\t%.2f\n", 
+            stats[i].texture_size,
+            stats[i].uncompressed.walk_time / 1000, 
+            stats[i].compressed.walk_time / 1000);
+    }
+}
+
+bool guess_pixel_white(double walk_time, bool use_facade) {
+    return walk_time / 1000 > (use_facade ? TIMING_THRESHOLD_FACADE : TIMING_THRESHOLD_BASELINE);
+}
+
+//Runs one pixel stealing trial: fill the LLC, render the attacker frame chosen by the victim pixel,
+//then time the walk of the LLC and guess the pixel from it.
+static pixel_trial_t attack_pixel(const attack_frames_t* frames, size_t w, size_t p, bool use_facade) {
+    pixel_trial_t trial;
+    sim_stats_t cache_stats;
+    init_stats(&cache_stats);
+
+    sim_setup(&cache_config);
+    read_frame(frames->buffer, &cache_stats);    //Dummy frame to fill entire LLC
+
+    //get which frame to use
+    frame_t* attacker_frame;
+    trial.actual_white = frames->victim->windows[w].pixels[p][0] > 127;
+    if (trial.actual_white) {
+        attacker_frame = frames->noise;
+    } else {
+        attacker_frame = frames->black;
+    }
+
+    sim_set_phase(SIM_PHASE_ATTACK);
+    const access_order_t* render_order = get_access_order(attack_order.render, attacker_frame->nWindows, attack_order.seed);
+    if (use_facade) {
+        read_frame_facade_ordered(attacker_frame, render_order, &cache_stats);
+    } else {
+        read_frame_ordered(attacker_frame, render_order, &cache_stats);
+    }
+    sim_set_phase(SIM_PHASE_WALK);
+    const access_order_t* walk_order = get_access_order(attack_order.walk, frames->buffer->nWindows, attack_order.seed);
+    cache_stats.llc_walk_time = read_frame_ordered(frames->buffer, walk_order, &cache_stats);
+    sim_finish(&cache_stats);
+
+    //Guess the Pixel
+    trial.walk_time = cache_stats.llc_walk_time;
+    trial.num_evictions = cache_stats.num_evictions;
+    trial.guess_white = guess_pixel_white(cache_stats.llc_walk_time, use_facade);
+    return trial;
+}
+
+void init_attack_frames(attack_frames_t* frames) {
+    //1024x1024 pixel frame
+    frames->victim = get_new_frame_checkerboard(ATTACK_NUM_WINDOWS);
+
+    frames->buffer = get_new_frame_random(FRAME_NUM_WINDOWS_CACHE);
+    frames->black = get_new_frame_black(FRAME_NUM_WINDOWS_CACHE);
+    frames->noise = get_new_frame_random(FRAME_NUM_WINDOWS_CACHE);
+}
+
+//95% Wilson score interval for a binomial proportion.
+static void wilson_interval(uint64_t successes, uint64_t n, double* low, double* high) {
+    const double z = 1.96;
+    const double p = (double) successes / n;
+    const double denom = 1.0 + z*z / n;
+    const double center = (p + z*z / (2.0*n)) / denom;
+    const double half = z * sqrt(p*(1.0 - p) / n + z*z / (4.0*n*n)) / denom;
+    *low = std::max(0.0, center - half);
+    *high = std::min(1.0, center + half);
+}
+
+//Progress of do_pixel_attack in its checkpoints, followed by the trial store's state when there is one.
+typedef struct {
+    uint64_t use_facade;
+    uint64_t facade_mode;
+    attack_order_t order;
+    uint64_t next_pixel;
+    uint64_t correct_pixels;
+    uint64_t frame_ids[4];      //victim, buffer, black, noise in m_Frames
+    uint64_t store_config;
+    uint64_t store_size;        //0 without a store
+} attack_progress_t;
+
+static uint64_t find_frame_id(frame_t* frame) {
+    return std::find(m_Frames.begin(), m_Frames.end(), frame) - m_Frames.begin();
+}
+
+static void save_attack_checkpoint(const char* path, const attack_progress_t* progress, 
+        const trial_store_t* store) {
+    std::vector<uint8_t> state(sizeof(attack_progress_t) + progress->store_size);
+    memcpy(state.data(), progress, sizeof(attack_progress_t));
+    if (store != nullptr) {
+        save_trial_store_state(store, state.data() + sizeof(attack_progress_t));
+    }
+    if (!checkpoint_save(path, CHECKPOINT_CAMPAIGN_ATTACK, state)) {
+        fprintf(stderr, "Could not write checkpoint %s\n", path);
+    }
+}
+
+typedef struct {
+    bool use_facade;
+    attack_progress_t* progress;
+    trial_store_t* store;
+} attack_resume_t;
+
+//Whether a checkpoint's attack reads the frames the way this one would.
+static bool same_attack_reads(const attack_progress_t* progress, bool use_facade) {
+    return progress->use_facade == use_facade && progress->facade_mode == (uint64_t) facade_mode &&
+        progress->order.render == attack_order.render && progress->order.walk == attack_order.walk &&
+        progress->order.seed == attack_order.seed;
+}
+
+//Accepts a checkpoint of an attack with the same facade, orders and store use, whose frames it names are
+//in the checkpoint's registry, and takes the store from it.
+static bool accept_attack_checkpoint(const std::vector<uint8_t>& state, uint64_t num_frames, void* arg) {
+    attack_resume_t* resume = (attack_resume_t*) arg;
+    attack_progress_t progress;
+    if (state.size() < sizeof(progress)) {
+        return false;
+    }
+    memcpy(&progress, state.data(), sizeof(progress));
+    if (!same_attack_reads(&progress, resume->use_facade) || (progress.store_size != 0) != (resume->store != nullptr) ||
+            state.size() != sizeof(progress) + progress.store_size || progress.next_pixel > ATTACK_NUM_PIXELS) {
+        return false;
+    }
+    for (uint64_t id : progress.frame_ids) {
+        if (id >= num_frames) {
+            return false;
+        }
+    }
+    if (resume->store != nullptr && !load_trial_store_state(resume->store, state.data() + sizeof(progress), progress.store_size)) {
+        return false;
+    }
+    *resume->progress = progress;
+    return true;
+}
+
+//Picks up an interrupted attack with the same facade, orders and store use; false to start over, in
+//which case neither the frame registry nor the store have been touched.
+static bool load_attack_checkpoint(const char* path, bool use_facade, attack_frames_t* frames, attack_progress_t* progress, 
+        trial_store_t* store) {
+    attack_resume_t resume = {use_facade, progress, store};
+    if (!checkpoint_load(path, CHECKPOINT_CAMPAIGN_ATTACK, accept_attack_checkpoint, &resume)) {
+        return false;
+    }
+
+    frames->victim = m_Frames[progress->frame_ids[0]];
+    frames->buffer = m_Frames[progress->frame_ids[1]];
+    frames->black = m_Frames[progress->frame_ids[2]];
+    frames->noise = m_Frames[progress->frame_ids[3]];
+    return true;
+}
+
+//Records every trial to store, if given, for offline threshold evaluation. With a checkpoint path, the
+//attack resumes from the checkpoint there if one exists, saves one every ATTACK_CHECKPOINT_PIXELS
+//pixels, and removes it when done.
+double do_pixel_attack(bool use_facade, trial_store_t* store, const char* checkpoint) {
+    attack_frames_t frames;
+    attack_progress_t progress;
+    if (checkpoint == nullptr || !load_attack_checkpoint(checkpoint, use_facade, &frames, &progress, store)) {
+        init_attack_frames(&frames);
+        memset(&progress, 0, sizeof(progress));
+        progress.use_facade = use_facade;
+        progress.facade_mode = facade_mode;
+        progress.order = attack_order;
+        progress.store_config = store != nullptr ? trial_store_add_config(store, &cache_config, use_facade, facade_mode, &attack_order) : 0;
+        frame_t* ordered[] = {frames.victim, frames.buffer, frames.black, frames.noise};
+        for (size_t i = 0; i < 4; i++) {
+            progress.frame_ids[i] = find_frame_id(ordered[i]);
+        }
+    }
+
+    for (; progress.next_pixel < ATTACK_NUM_PIXELS; progress.next_pixel++) {
+        const size_t w = progress.next_pixel / WINDOW_NUM_PIXELS;
+        const size_t p = progress.next_pixel % WINDOW_NUM_PIXELS;
+        if (checkpoint != nullptr && progress.next_pixel > 0 && progress.next_pixel % ATTACK_CHECKPOINT_PIXELS == 0) {
+            progress.store_size = store != nullptr ? trial_store_state_size(store) : 0;
+            save_attack_checkpoint(checkpoint, &progress, store);
+        }
+
+        pixel_trial_t trial = attack_pixel(&frames, w, p, use_facade);
+        if (store != nullptr) {
+            trial_store_record(store, progress.store_config, progress.next_pixel, trial.actual_white, trial.walk_time, trial.num_evictions);
+        }
+        if (trial.guess_white == trial.actual_white) {
+            progress.correct_pixels++;
+        } 
+    }
+
+    if (checkpoint != nullptr) {
+        checkpoint_remove(checkpoint);
+    }
+    return (double) progress.correct_pixels / ATTACK_NUM_PIXELS;
+}
+
+//Attacks pixels in a seeded random order and stops as soon as the 95% Wilson interval on the accuracy
+//is narrower than stop->ci_width (after at least stop->min_trials), or every pixel has been attacked.
+attack_result_t do_pixel_attack_sequential(bool use_facade, const early_stop_config_t* stop, trial_store_t* store) {
+    attack_frames_t frames;
+    init_attack_frames(&frames);
+    uint16_t config = store != nullptr ? trial_store_add_config(store, &cache_config, use_facade, facade_mode, &attack_order) : 0;
+
+    std::vector<uint32_t> order(ATTACK_NUM_PIXELS);
+    for (uint32_t i = 0; i < ATTACK_NUM_PIXELS; i++) {
+        order[i] = i;
+    }
+    std::mt19937_64 gen(stop->seed);
+    std::shuffle(order.begin(), order.end(), gen);
+
+    attack_result_t result;
+    uint64_t correct_pixels = 0;
+    result.trials = 0;
+    result.stopped_early = false;
+    for (uint32_t pixel : order) {
+        pixel_trial_t trial = attack_pixel(&frames, pixel / WINDOW_NUM_PIXELS, pixel % WINDOW_NUM_PIXELS, use_facade);
+        if (store != nullptr) {
+            trial_store_record(store, config, pixel, trial.actual_white, trial.walk_time, trial.num_evictions);
+        }
+        if (trial.guess_white == trial.actual_white) {
+            correct_pixels++;
+        }
+        result.trials++;
+
+        wilson_interval(correct_pixels, result.trials, &result.ci_low, &result.ci_high);
+        if (result.trials >= stop->min_trials && result.ci_high - result.ci_low < stop->ci_width) {
+            result.stopped_early = result.trials < ATTACK_NUM_PIXELS;
+            break;
+        }
+    }
+
+    result.accuracy = (double) correct_pixels / result.trials;
+    return result;
+}
+
+//The pixel attack with the attacker and victim on different cores of a shared LLC. Core 0 fills the
+//LLC with the buffer, core 1 renders the attacker frame, then core 0 times the walk of the buffer. The
+//walk time counts the attacker's private L1 hits too, so it is compared against the thresholds as is.
+double do_pixel_attack_shared(bool use_facade, bool sequenced, trial_store_t* store) {
+    attack_frames_t frames;
+    init_attack_frames(&frames);
+    uint16_t config = store != nullptr ? trial_store_add_config(store, &cache_config, use_facade, facade_mode, &attack_order) : 0;
+
+    shared_llc_config_t shared;
+    shared.num_cores = 2;
+    shared.l1_config = SHARED_L1_CONFIG;
+    shared.llc_config = cache_config.l1_config;
+    shared.sequenced = sequenced;
+
+    //Every frame is the same for each pixel, so the line streams are built once
+    std::vector<uint64_t> fill, walk, black, noise;
+    get_frame_lines(frames.buffer, false, &fill);
+    get_frame_lines_ordered(frames.buffer, get_access_order(attack_order.walk, FRAME_NUM_WINDOWS_CACHE, attack_order.seed), &walk);
+    const access_order_t* render_order = get_access_order(attack_order.render, FRAME_NUM_WINDOWS_CACHE, attack_order.seed);
+    get_frame_read_lines(frames.black, use_facade, render_order, &black);
+    get_frame_read_lines(frames.noise, use_facade, render_order, &noise);
+
+    uint64_t correct_pixels = 0;
+    for (uint32_t pixel = 0; pixel < ATTACK_NUM_PIXELS; pixel++) {
+        const bool actual_white = frames.victim->windows[pixel / WINDOW_NUM_PIXELS].pixels[pixel % WINDOW_NUM_PIXELS][0] > 127;
+        sim_stats_t stats[2];
+        init_stats(&stats[0]);
+        init_stats(&stats[1]);
+        double times[2];
+
+        shared_llc_setup(&shared);
+        shared_llc_run({fill, {}}, stats, times);
+        shared_llc_run({{}, actual_white ? noise : black}, stats, times);
+        shared_llc_run({walk, {}}, stats, times);
+        shared_llc_finish(stats);
+
+        if (store != nullptr) {
+            trial_store_record(store, config, pixel, actual_white, times[0], stats[0].num_evictions + stats[1].num_evictions);
+        }
+        if (guess_pixel_white(times[0], use_facade) == actual_white) {
+            correct_pixels++;
+        }
+    }
+
+    return (double) correct_pixels / ATTACK_NUM_PIXELS;
+}
+
+//Columns of the LLC walk results file, one row per texture size. Each measurement is slow, so rows
+//go to disk in small chunks.
+#define LLC_WALK_CHUNK_ROWS 8
+
+static const result_column_t llc_walk_columns[] = {
+    {"texture_size_kb", RESULT_TYPE_U32},
+    {"uncompressed_evictions", RESULT_TYPE_U64},
+    {"uncompressed_walk_time", RESULT_TYPE_F64},
+    {"compressed_evictions", RESULT_TYPE_U64},
+    {"compressed_walk_time", RESULT_TYPE_F64},
+    {"uncompressed_walk_p50", RESULT_TYPE_F64},
+    {"uncompressed_walk_p99", RESULT_TYPE_F64},
+    {"compressed_walk_p50", RESULT_TYPE_F64},
+    {"compressed_walk_p99", RESULT_TYPE_F64},
+};
+
+//Collects the walk times for texture sizes of 1KB to 128KB. The caller owns the returned array.
+//Each row is also appended to results, if given, as soon as it is measured.
+uint64_t collect_llc_times(llc_walk_stats_combined_t** outStats, results_writer_t* results) {
+    uint64_t lowBoundKB = 1;
+    uint64_t upBoundKB = 128;
+    uint64_t strideKB = 1;
+    uint64_t num_iter = (upBoundKB - lowBoundKB) / strideKB + 1;
+
+    llc_walk_stats_combined_t* stats = new llc_walk_stats_combined_t[num_iter];
+    for (uint64_t i = 0; i < num_iter; i++) {
+        uint64_t nKB = lowBoundKB + i*strideKB;
+        if (nKB > upBoundKB) {
+            nKB = upBoundKB;
+        }
+        stats[i].texture_size = nKB;
+        measure_llc_walk(8*nKB, &stats[i], true);
+
+        if (results != nullptr) {
+            result_value_t row[9];
+            row[0].u = stats[i].texture_size;
+            row[1].u = stats[i].uncompressed.num_evictions;
+            row[2].f = stats[i].uncompressed.walk_time;
+            row[3].u = stats[i].compressed.num_evictions;
+            row[4].f = stats[i].compressed.walk_time;
+            row[5].f = stats[i].uncompressed.walk_p50;
+            row[6].f = stats[i].uncompressed.walk_p99;
+            row[7].f = stats[i].compressed.walk_p50;
+            row[8].f = stats[i].compressed.walk_p99;
+            results_append(results, row);
+        }
+    }
+
+    *outStats = stats;
+    return num_iter;
+}
+
+//Prints the walk times and, given a path, also streams them to a results file.
+void generate_llc_times(const char* results_path) {
+    results_writer_t writer;
+    results_writer_t* results = nullptr;
+    if (results_path != nullptr) {
+        const uint32_t num_columns = sizeof(llc_walk_columns) / sizeof(llc_walk_columns[0]);
+        if (results_open_write(&writer, results_path, llc_walk_columns, num_columns, LLC_WALK_CHUNK_ROWS)) {
+            results = &writer;
+        } else {
+            fprintf(stderr, "Could not write %s\n", results_path);
+        }
+    }
+
+    llc_walk_stats_combined_t* stats;
+    uint64_t num_iter = collect_llc_times(&stats, results);
+
+    print_stats_csv(stats, num_iter);
+    if (results != nullptr && !results_close_write(results)) {
+        fprintf(stderr, "Could not write %s\n", results_path);
+    }
+
+    delete[] stats;
+}
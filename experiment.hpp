@@ -0,0 +1,78 @@
+//Experiments run against the cache simulator: LLC walk measurements and the pixel stealing attack.
+
+#ifndef EXPERIMENT_HPP
+#define EXPERIMENT_HPP
+
+#include "cache_sim.hpp"
+#include "frame.hpp"
+#include "latency.hpp"
+#include "results.hpp"
+#include "shared_llc.hpp"
+#include "trial_store.hpp"
+
+#define TIMING_THRESHOLD_BASELINE 62
+#define TIMING_THRESHOLD_FACADE 34
+#define NUM_LAYERS 10    //Filter layers in a layered render, see render.hpp
+
+typedef struct {
+    uint64_t num_evictions;
+    double walk_time;
+    double walk_p50;    //Window latency percentiles during the walk
+    double walk_p99;
+} llc_walk_stats_t;
+
+typedef struct {
+    uint64_t texture_size;
+    llc_walk_stats_t uncompressed;
+    llc_walk_stats_t compressed;
+} llc_walk_stats_combined_t;
+
+#define ATTACK_NUM_WINDOWS 32
+#define ATTACK_NUM_PIXELS ((ATTACK_NUM_WINDOWS) * (WINDOW_NUM_PIXELS))
+
+typedef struct {
+    frame_t* victim;
+    frame_t* buffer;    //Fills the LLC, then walked backwards to time it
+    frame_t* black;     //Attacker frame when the victim pixel is black (compressible)
+    frame_t* noise;     //Attacker frame when the victim pixel is white (incompressible)
+} attack_frames_t;
+
+typedef struct {
+    bool actual_white;
+    bool guess_white;
+    double walk_time;
+    uint64_t num_evictions;
+} pixel_trial_t;
+
+//Sequential early stopping for the pixel attack.
+typedef struct {
+    double ci_width;        //Stop once the 95% interval on the accuracy is narrower than this
+    uint64_t min_trials;    //Never stop before this many pixels
+    uint64_t seed;          //Seed of the randomized pixel order
+} early_stop_config_t;
+
+typedef struct {
+    double accuracy;
+    double ci_low;
+    double ci_high;
+    uint64_t trials;
+    bool stopped_early;
+} attack_result_t;
+
+extern sim_config_t cache_config;
+extern attack_order_t attack_order;
+
+extern void init_cache_config();
+extern void init_stats(sim_stats_t* stats);
+extern void print_cache_stats(sim_stats_t* stats);
+extern void measure_llc_walk(size_t num_windows, llc_walk_stats_combined_t* stats, bool use_facade = false);
+extern void print_stats_csv(llc_walk_stats_combined_t* stats, uint64_t num_stats);
+extern bool guess_pixel_white(double walk_time, bool use_facade);
+extern void init_attack_frames(attack_frames_t* frames);
+extern double do_pixel_attack(bool use_facade, trial_store_t* store=nullptr, const char* checkpoint=nullptr);
+extern attack_result_t do_pixel_attack_sequential(bool use_facade, const early_stop_config_t* stop, trial_store_t* store=nullptr);
+extern double do_pixel_attack_shared(bool use_facade, bool sequenced, trial_store_t* store=nullptr);
+extern uint64_t collect_llc_times(llc_walk_stats_combined_t** outStats, results_writer_t* results=nullptr);
+extern void generate_llc_times(const char* results_path=nullptr);
+
+#endif
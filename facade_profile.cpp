@@ -0,0 +1,71 @@
+#include "facade_profile.hpp"
+
+#include <chrono>
+
+//Renders one attacker frame into an LLC filled by the buffer and adds what the render cost to cost.
+static void profile_render(frame_t* buffer, frame_t* attacker_frame, bool use_facade, facade_cost_t* cost) {
+    sim_stats_t cache_stats;
+    init_stats(&cache_stats);
+
+    sim_setup(&cache_config);
+    read_frame(buffer, &cache_stats);
+    const uint64_t accesses = cache_stats.accesses_l1;
+    const uint64_t evictions = cache_stats.num_evictions;
+    sim_set_phase(SIM_PHASE_ATTACK);
+    cost->render_time += use_facade ? read_frame_facade(attacker_frame, &cache_stats) : read_frame(attacker_frame, &cache_stats);
+    cost->accesses += cache_stats.accesses_l1 - accesses;
+    cost->evictions += cache_stats.num_evictions - evictions;
+    sim_finish(&cache_stats);
+}
+
+void profile_facade(facade_mode_t mode, facade_cost_t* cost) {
+    const facade_mode_t previous = facade_mode;
+    const bool use_facade = mode != FACADE_NONE;
+    facade_mode = mode;
+    cost->mode = mode;
+    cost->accesses = 0;
+    cost->evictions = 0;
+    cost->render_time = 0;
+
+    attack_frames_t frames;
+    init_attack_frames(&frames);
+    profile_render(frames.buffer, frames.black, use_facade, cost);
+    profile_render(frames.buffer, frames.noise, use_facade, cost);
+    cost->accesses /= 2;
+    cost->evictions /= 2;
+    cost->render_time /= 2;
+    free_frames();
+
+    trial_store_t store;
+    auto start = std::chrono::steady_clock::now();
+    do_pixel_attack(use_facade, &store);
+    cost->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    threshold_eval_t eval = evaluate_thresholds(&store, 0);
+    cost->auc = eval.auc;
+    cost->best_accuracy = eval.best_accuracy;
+
+    facade_mode = previous;
+}
+
+void profile_facades(std::vector<facade_cost_t>* outCosts) {
+    outCosts->resize(FACADE_NUM_MODES);
+    for (int mode = 0; mode < FACADE_NUM_MODES; mode++) {
+        profile_facade((facade_mode_t) mode, &(*outCosts)[mode]);
+    }
+}
+
+//Costs are relative to the first row, normally FACADE_NONE.
+void print_facade_costs(const std::vector<facade_cost_t>& costs, FILE* out) {
+    if (costs.empty()) {
+        return;
+    }
+    const facade_cost_t& base = costs[0];
+    fprintf(out, "Facade\tAccesses\tExtra\tEvictions\tExtra\tRender Time\tExtra\tAUC\tBest Accuracy\tAttack Seconds\n");
+    for (const facade_cost_t& cost : costs) {
+        fprintf(out, "%s\t%.0f\t%+.0f%%\t%.0f\t%+.0f%%\t%.0f\t%+.0f%%\t%.3f\t%.2f\t%.2f\n", facade_mode_name(cost.mode),
+            cost.accesses, 100.0 * (cost.accesses / base.accesses - 1),
+            cost.evictions, base.evictions > 0 ? 100.0 * (cost.evictions / base.evictions - 1) : 0.0,
+            cost.render_time, 100.0 * (cost.render_time / base.render_time - 1),
+            cost.auc, cost.best_accuracy, cost.seconds);
+    }
+}
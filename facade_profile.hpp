@@ -0,0 +1,26 @@
+//What each facade_mode costs and what it buys.
+//For every mode, the attacker frames are rendered into a filled LLC to count the accesses, evictions
+//and time the render takes over an undefended read_frame, and the pixel attack is run to see how well
+//the walk still separates the pixels. The best accuracy is taken over every threshold, so a defense
+//only scores 0.50 if no threshold at all recovers the pixels.
+
+#ifndef FACADE_PROFILE_HPP
+#define FACADE_PROFILE_HPP
+
+#include "experiment.hpp"
+
+typedef struct {
+    facade_mode_t mode;
+    double accesses;        //Per attacker frame render, averaged over black and noise
+    double evictions;
+    double render_time;
+    double auc;
+    double best_accuracy;
+    double seconds;         //Host time of the attack
+} facade_cost_t;
+
+extern void profile_facade(facade_mode_t mode, facade_cost_t* cost);
+extern void profile_facades(std::vector<facade_cost_t>* outCosts);
+extern void print_facade_costs(const std::vector<facade_cost_t>& costs, FILE* out);
+
+#endif
@@ -1,10 +1,19 @@
 #include "frame.hpp"
 #include "cache_sim.hpp"
+#include "hostprof.hpp"
+#include "latency.hpp"
 
+#include <algorithm>
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 
 std::vector<frame_t*> m_Frames;
+static std::vector<uint64_t> m_FrameEnds;  //First line address past each frame in m_Frames
+facade_mode_t facade_mode = FACADE_FULL;
+
+static const char* facade_mode_names[FACADE_NUM_MODES] = {"none", "full", "selective", "pad"};
+static const uint64_t NO_PAD_LINE = UINT64_MAX;
 
 void print_frame_nWindows() {
     for (uint64_t i = 0; i < m_Frames.size(); i++) {
@@ -15,11 +24,8 @@ void print_frame_nWindows() {
 static uint64_t get_line_addr(uint64_t frame_id, uint64_t window_id) {
     const uint64_t WINDOW_SIZE = (2*WINDOW_SIZE_COMPRESSED);
 
-    uint64_t line_offset = 0;
-
-    for (uint64_t i = 0; i < frame_id; i++) {
-        line_offset += ((m_Frames[i])->nWindows * WINDOW_SIZE);
-    }
+    //A frame starts where the one before it ends
+    const uint64_t line_offset = frame_id == 0 ? 0 : m_FrameEnds[frame_id-1];
 
     return line_offset + window_id*WINDOW_SIZE;
 }
@@ -43,12 +49,28 @@ static void set_window_random(pixel_window_t* window) {
     }
 }
 
+//Random pixels drawn from state instead of rand().
+static void set_window_random_from(pixel_window_t* window, uint64_t* state) {
+    for (size_t j = 0; j < WINDOW_NUM_PIXELS; j++) {
+        *state ^= *state << 13;
+        *state ^= *state >> 7;
+        *state ^= *state << 17;
+        set_pixel(window->pixels[j], (uint8_t) (*state >> 56), (uint8_t) (*state >> 48), (uint8_t) (*state >> 40), (uint8_t) (*state >> 32));
+    }
+}
+
+static void register_frame(frame_t* frame) {
+    const uint64_t start = m_FrameEnds.empty() ? 0 : m_FrameEnds.back();
+    m_Frames.push_back(frame);
+    m_FrameEnds.push_back(start + frame->nWindows * 2*WINDOW_SIZE_COMPRESSED);
+}
+
 static frame_t* init_frame(size_t nWindows) {
     frame_t* frame = new frame_t();
     frame->nWindows = nWindows;
     frame->windows = new pixel_window_t[nWindows];
 
-    m_Frames.push_back(frame);
+    register_frame(frame);
     return frame;
 }
 
@@ -67,31 +89,251 @@ void free_frames() {
     for (int i = m_Frames.size()-1; i >= 0; i--) {
         frame_t* frame = m_Frames[i];
         m_Frames.erase(m_Frames.begin()+i);
-        delete[] frame->windows;
+        if (!frame->borrowed) {
+            delete[] frame->windows;
+        }
         delete frame;
     }
+    m_FrameEnds.clear();
 }
 
-static double read_window(frame_t* frame, uint64_t frame_id, uint64_t window_id, sim_stats_t* cache_stats) {
-    pixel_window_t* window = &(frame->windows[window_id]);
+//Index in m_Frames of the frame whose lines contain addr, or m_Frames.size() if none does. Only reads the
+//registry, so concurrent simulations may call it as long as none of them registers or frees frames.
+uint64_t find_frame_at(uint64_t addr) {
+    return std::upper_bound(m_FrameEnds.begin(), m_FrameEnds.end(), addr) - m_FrameEnds.begin();
+}
 
-    //Compress the window
-    compress_result_t compress_result = compress(window);
+//Flat copy of the frame registry, for checkpoints: the frame count, each frame's nWindows, each frame's
+//facade (its index, or NO_FACADE), then every frame's windows in registry order.
+static const uint64_t NO_FACADE = UINT64_MAX;
+
+uint64_t get_frames_state_size() {
+    uint64_t size = sizeof(uint64_t) * (1 + 2*m_Frames.size());
+    for (frame_t* frame : m_Frames) {
+        size += frame->nWindows * sizeof(pixel_window_t);
+    }
+    return size;
+}
+
+void save_frames_state(uint8_t* out) {
+    const uint64_t count = m_Frames.size();
+    memcpy(out, &count, sizeof(count));
+    out += sizeof(count);
+    for (frame_t* frame : m_Frames) {
+        memcpy(out, &frame->nWindows, sizeof(uint64_t));
+        out += sizeof(uint64_t);
+    }
+    for (frame_t* frame : m_Frames) {
+        uint64_t facade = NO_FACADE;
+        if (frame->facade != nullptr) {
+            get_frame_id(frame->facade, &facade);
+        }
+        memcpy(out, &facade, sizeof(facade));
+        out += sizeof(facade);
+    }
+    for (frame_t* frame : m_Frames) {
+        memcpy(out, frame->windows, frame->nWindows * sizeof(pixel_window_t));
+        out += frame->nWindows * sizeof(pixel_window_t);
+    }
+}
+
+//Whether in holds a whole registry as save_frames_state writes it, and how many frames.
+bool check_frames_state(const uint8_t* in, uint64_t size, uint64_t* outCount) {
+    uint64_t count;
+    if (size < sizeof(count)) {
+        return false;
+    }
+    memcpy(&count, in, sizeof(count));
+    if (count > (size - sizeof(count)) / (2*sizeof(uint64_t))) {
+        return false;
+    }
+    uint64_t remaining = size - sizeof(uint64_t) * (1 + 2*count);
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t nWindows, facade;
+        memcpy(&nWindows, in + sizeof(uint64_t) * (1 + i), sizeof(nWindows));
+        memcpy(&facade, in + sizeof(uint64_t) * (1 + count + i), sizeof(facade));
+        if (nWindows > remaining / sizeof(pixel_window_t) || (facade != NO_FACADE && facade >= count)) {
+            return false;
+        }
+        remaining -= nWindows * sizeof(pixel_window_t);
+    }
+    *outCount = count;
+    return remaining == 0;
+}
+
+//Replaces the registry with the saved one. Frame pointers from before are no longer valid.
+bool load_frames_state(const uint8_t* in, uint64_t size) {
+    uint64_t count;
+    if (!check_frames_state(in, size, &count)) {
+        return false;
+    }
+
+    free_frames();
+    const uint8_t* windows = in + sizeof(uint64_t) * (1 + 2*count);
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t n;
+        memcpy(&n, in + sizeof(uint64_t) * (1 + i), sizeof(n));
+        frame_t* frame = init_frame(n);
+        memcpy(frame->windows, windows, n * sizeof(pixel_window_t));
+        windows += n * sizeof(pixel_window_t);
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t facade;
+        memcpy(&facade, in + sizeof(uint64_t) * (1 + count + i), sizeof(facade));
+        m_Frames[i]->facade = facade != NO_FACADE ? m_Frames[facade] : nullptr;
+    }
+    return true;
+}
+
+//Reads a window's lines. If the window compresses and padLine is set, padLine is read in place of
+//the second line so the window's line count doesn't give it away.
+static double read_window(frame_t* frame, uint64_t frame_id, uint64_t window_id, sim_stats_t* cache_stats, uint64_t padLine = NO_PAD_LINE) {
+    pixel_window_t* window = &(frame->windows[window_id]);
 
     //Get the cache lines accessed
     uint64_t line;
     line = get_line_addr(frame_id, window_id);
 
-    //Access the cachelines via the cache simulator
-    double totalTime = sim_access('R', line, cache_stats);
+    //Under set sampling, skip the compression entirely if no line is simulated
+    if (!sim_is_sampled(line) && !sim_is_sampled(line+WINDOW_SIZE_COMPRESSED) && (padLine == NO_PAD_LINE || !sim_is_sampled(padLine))) {
+        return 0.0;
+    }
+
+    //Compress the window
+    HOSTPROF_BEGIN(HOSTPROF_COMPRESS);
+    compress_result_t compress_result = compress(window);
+    HOSTPROF_END(HOSTPROF_COMPRESS);
+
+    //Access the cachelines via the cache simulator; a compressed LLC stores a compressed window in half a way
+    double totalTime = compress_result.did_compression ? sim_access_compressed('R', line, cache_stats) : sim_access('R', line, cache_stats);
+    double secondTime = 0.0;
 
-    if (!compress_result.did_compression) {            
-        totalTime += sim_access('R', line+WINDOW_SIZE_COMPRESSED, cache_stats);
+    const bool secondRead = !compress_result.did_compression || padLine != NO_PAD_LINE;
+    if (secondRead) {
+        secondTime = sim_access('R', compress_result.did_compression ? padLine : line+WINDOW_SIZE_COMPRESSED, cache_stats);
+        totalTime += secondTime;
+    }
+
+    phase_latency_t* latency = latency_current;
+    if (latency != nullptr) {
+        const sim_phase_t phase = sim_get_phase();
+        hdr_hist_record(&latency->access[phase], totalTime - secondTime);
+        if (secondRead) {
+            hdr_hist_record(&latency->access[phase], secondTime);
+        }
+        hdr_hist_record(&latency->window[phase], totalTime);
     }
 
     return totalTime;
 }
 
+//First line address of a registered frame.
+uint64_t get_frame_base_line(frame_t* frame) {
+    uint64_t frame_id = 0;
+    get_frame_id(frame, &frame_id);
+    return get_line_addr(frame_id, 0);
+}
+
+//The lines read_window accesses, without simulating them: the window's first line, and the second
+//unless the window compresses, in which case the first is marked SIM_LINE_COMPRESSED. Returns the number
+//of lines written to outLines.
+uint64_t get_window_lines(frame_t* frame, uint64_t base_line, uint64_t window_id, uint64_t* outLines) {
+    const uint64_t line = base_line + window_id*2*WINDOW_SIZE_COMPRESSED;
+    outLines[0] = line;
+    if (compress(&frame->windows[window_id]).did_compression) {
+        outLines[0] |= SIM_LINE_COMPRESSED;
+        return 1;
+    }
+    outLines[1] = line + WINDOW_SIZE_COMPRESSED;
+    return 2;
+}
+
+//Appends the lines read_frame (or read_frame_backwards) accesses, in order.
+void get_frame_lines(frame_t* frame, bool backwards, std::vector<uint64_t>* outLines) {
+    get_frame_lines_ordered(frame, get_access_order(backwards ? ACCESS_ORDER_REVERSE : ACCESS_ORDER_LINEAR, frame->nWindows), outLines);
+}
+
+//Appends the lines read_frame_ordered accesses, in order.
+void get_frame_lines_ordered(frame_t* frame, const access_order_t* order, std::vector<uint64_t>* outLines) {
+    const uint64_t base = get_frame_base_line(frame);
+    for (uint32_t window_id : order->windows) {
+        uint64_t lines[2];
+        uint64_t count = get_window_lines(frame, base, window_id, lines);
+        outLines->insert(outLines->end(), lines, lines + count);
+    }
+}
+
+//First line a FACADE_SELECTIVE or FACADE_PAD read pads window 0 with; window w is padded with the
+//line 2*w past it.
+static uint64_t get_pad_base_line(frame_t* frame, facade_mode_t mode) {
+    if (mode == FACADE_SELECTIVE) {
+        return get_frame_base_line(get_facade_frame(frame));
+    }
+    return get_frame_base_line(frame) + WINDOW_SIZE_COMPRESSED;
+}
+
+//Appends the lines a read of frame in order accesses, with the facade_mode padding when use_facade
+//as read_frame_facade_ordered.
+void get_frame_read_lines(frame_t* frame, bool use_facade, const access_order_t* order, std::vector<uint64_t>* outLines) {
+    get_frame_read_lines_mode(frame, use_facade ? facade_mode : FACADE_NONE, order, outLines);
+}
+
+//get_frame_read_lines behind the facade of mode rather than the global facade_mode.
+void get_frame_read_lines_mode(frame_t* frame, facade_mode_t mode, const access_order_t* order, std::vector<uint64_t>* outLines) {
+    if (mode == FACADE_FULL) {
+        get_frame_lines_ordered(get_facade_frame(frame), order, outLines);
+    }
+    if (mode != FACADE_SELECTIVE && mode != FACADE_PAD) {
+        get_frame_lines_ordered(frame, order, outLines);
+        return;
+    }
+
+    const uint64_t base = get_frame_base_line(frame);
+    const uint64_t padBase = get_pad_base_line(frame, mode);
+    for (uint32_t window_id : order->windows) {
+        const uint64_t line = base + window_id*2*WINDOW_SIZE_COMPRESSED;
+        if (compress(&frame->windows[window_id]).did_compression) {
+            outLines->push_back(line | SIM_LINE_COMPRESSED);
+            outLines->push_back(padBase + window_id*2*WINDOW_SIZE_COMPRESSED);
+        } else {
+            outLines->push_back(line);
+            outLines->push_back(line + WINDOW_SIZE_COMPRESSED);
+        }
+    }
+}
+
+//Simulates a line list from the builders above. Sums per window, in read_window's order, so the total
+//matches reading the frame; a window's second line always directly follows its first.
+double read_frame_lines(const std::vector<uint64_t>& lines, sim_stats_t* cache_stats) {
+    double totalTime = 0.0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        double windowTime = sim_access_line('R', lines[i], cache_stats);
+        if (i + 1 < lines.size() && is_window_second_line(lines[i], lines[i+1])) {
+            windowTime += sim_access_line('R', lines[++i], cache_stats);
+        }
+        totalTime += windowTime;
+    }
+    return totalTime;
+}
+
+//A new frame with the same pixels, e.g. a render target written by a filter that preserves them.
+frame_t* get_new_frame_copy(frame_t* ogFrame) {
+    frame_t* frame = init_frame(ogFrame->nWindows);
+    memcpy(frame->windows, ogFrame->windows, ogFrame->nWindows * sizeof(pixel_window_t));
+    return frame;
+}
+
+//Registers a frame over windows the caller owns, read in place and never freed here.
+frame_t* get_new_frame_borrowed(pixel_window_t* windows, uint64_t nWindows) {
+    frame_t* frame = new frame_t();
+    frame->nWindows = nWindows;
+    frame->windows = windows;
+    frame->borrowed = true;
+
+    register_frame(frame);
+    return frame;
+}
+
 //Constructs a 128x128 pixel frame split into 512 windows, which uncompressed is enough to fill a 64KB cache
 frame_t* get_new_frame_checkerboard(uint64_t nWindows) {
     frame_t* frame = init_frame(nWindows);
@@ -130,56 +372,82 @@ frame_t* get_new_frame_random(uint64_t nWindows) {
     return frame;
 }
 
+//The frame read ahead of ogFrame under FACADE_FULL: random where ogFrame compresses and black where it
+//doesn't, so together they always take 3 lines a window. Built on the first call and kept with ogFrame,
+//which is assumed not to change after that. Its noise is seeded by its place in the registry rather than
+//drawn from rand(), so a run resumed from a checkpoint builds the same facades as one that wasn't.
 frame_t* get_facade_frame(frame_t* ogFrame) {
-    //Solution 1: Generate new frame every time requested.
+    if (ogFrame->facade != nullptr) {
+        return ogFrame->facade;
+    }
+    HOSTPROF_BEGIN(HOSTPROF_FACADE);
+    uint64_t state = (m_Frames.size() + 1) * 0x9E3779B97F4A7C15ull;
     frame_t* frame = init_frame(ogFrame->nWindows);
     for (uint64_t i = 0; i < frame->nWindows; i++) {
         if (compress(&ogFrame->windows[i]).did_compression) {
-            set_window_random(&frame->windows[i]);
+            set_window_random_from(&frame->windows[i], &state);
         } else {
             set_window_black(&frame->windows[i]);
         }
     }
+    HOSTPROF_END(HOSTPROF_FACADE);
 
+    ogFrame->facade = frame;
     return frame;
 }
 
+const char* facade_mode_name(facade_mode_t mode) {
+    return mode < FACADE_NUM_MODES ? facade_mode_names[mode] : "unknown";
+}
+
 //returns the time required to read the frame
 double read_frame(frame_t* frame, sim_stats_t* cache_stats) {
+    return read_frame_ordered(frame, get_access_order(ACCESS_ORDER_LINEAR, frame->nWindows), cache_stats);
+}
+
+//returns the time required to read the frame's windows in the order of the table
+double read_frame_ordered(frame_t* frame, const access_order_t* order, sim_stats_t* cache_stats) {
     double totalTime = 0.0;
     uint64_t frame_id;
     get_frame_id(frame, &frame_id);
-    for (uint64_t i = 0; i < frame->nWindows; i++) {
-        totalTime += read_window(frame, frame_id, i, cache_stats);
+    for (uint32_t window_id : order->windows) {
+        totalTime += read_window(frame, frame_id, window_id, cache_stats);
     }
 
     return totalTime;
 }
 
 double read_frame_facade(frame_t* frame, sim_stats_t* cache_stats) {
-    frame_t* facade = get_facade_frame(frame);
-    double totalTime = 0.0;
-    totalTime += read_frame(facade, cache_stats);
-    totalTime += read_frame(frame, cache_stats);
-
-    return totalTime;
+    return read_frame_facade_ordered(frame, get_access_order(ACCESS_ORDER_LINEAR, frame->nWindows), cache_stats);
 }
 
-double read_frame_backwards(frame_t* frame, sim_stats_t* cache_stats) {
+//Reads frame behind the facade of facade_mode.
+double read_frame_facade_ordered(frame_t* frame, const access_order_t* order, sim_stats_t* cache_stats) {
+    if (facade_mode == FACADE_NONE) {
+        return read_frame_ordered(frame, order, cache_stats);
+    }
+    if (facade_mode == FACADE_FULL) {
+        double totalTime = 0.0;
+        totalTime += read_frame_ordered(get_facade_frame(frame), order, cache_stats);
+        totalTime += read_frame_ordered(frame, order, cache_stats);
+        return totalTime;
+    }
+
     double totalTime = 0.0;
     uint64_t frame_id;
+    const uint64_t padBase = get_pad_base_line(frame, facade_mode);
     get_frame_id(frame, &frame_id);
-    for (uint64_t i = frame->nWindows-1; i >= 0; i--) {
-        totalTime += read_window(frame, frame_id, i, cache_stats);
-
-        if (i == 0) {
-            break;
-        }
+    for (uint32_t window_id : order->windows) {
+        totalTime += read_window(frame, frame_id, window_id, cache_stats, padBase + window_id*2*WINDOW_SIZE_COMPRESSED);
     }
 
     return totalTime;
 }
 
+double read_frame_backwards(frame_t* frame, sim_stats_t* cache_stats) {
+    return read_frame_ordered(frame, get_access_order(ACCESS_ORDER_REVERSE, frame->nWindows), cache_stats);
+}
+
 // static double render_baseline(frame_t* frame) {
 //     double total = 0;
 //     for (size_t row_start = 0; row_start < FRAME_NUM_ROWS; row_start += WINDOW_NUM_ROWS) {
@@ -1,6 +1,7 @@
 #ifndef FRAME_HPP
 #define FRAME_HPP
 
+#include "access_order.hpp"
 #include "cache_sim.hpp"
 #include "compress_alg.hpp"
 
@@ -16,21 +17,58 @@ typedef enum window_type {
     WINDOW_TYPE_RANDOM
 } window_type_t;
 
+//How read_frame_facade and get_frame_read_lines hide which windows compress. Every mode reads the
+//same number of lines for a compressible window as for an incompressible one.
+typedef enum facade_mode {
+    FACADE_NONE,
+    FACADE_FULL,        //Read the whole facade frame, then the frame: 3 lines per window
+    FACADE_SELECTIVE,   //Read one line of the facade frame for each window that compresses
+    FACADE_PAD,         //Read a compressed window's unused second line: 2 lines per window, no facade frame
+    FACADE_NUM_MODES
+} facade_mode_t;
+
 //A frame is a texture that is designed to occupy the whole LLC.
-typedef struct {
+typedef struct frame {
     uint64_t nWindows;
     pixel_window_t* windows;
+    bool borrowed;          //windows belong to the caller and are not freed with the frame
+    struct frame* facade;   //Built by the first get_facade_frame
 } frame_t;
 
+extern facade_mode_t facade_mode;
+
+//Whether line is the second line of the window whose first line is first, in a line list.
+inline bool is_window_second_line(uint64_t first, uint64_t line) {
+    return line == (first & ~SIM_LINE_COMPRESSED) + WINDOW_SIZE_COMPRESSED;
+}
+
 extern std::vector<frame_t*> m_Frames;
 
 extern void print_frame_nWindows();
 extern double read_frame(frame_t* frame, sim_stats_t* cache_stats);
 extern double read_frame_facade(frame_t* frame, sim_stats_t* cache_stats);
 extern double read_frame_backwards(frame_t* frame, sim_stats_t* cache_stats);
+extern double read_frame_ordered(frame_t* frame, const access_order_t* order, sim_stats_t* cache_stats);
+extern double read_frame_facade_ordered(frame_t* frame, const access_order_t* order, sim_stats_t* cache_stats);
 extern frame_t* get_new_frame_checkerboard(uint64_t nWindows);
 extern frame_t* get_new_frame_black(uint64_t nWindows);
 extern frame_t* get_new_frame_random(uint64_t nWindows);
+extern frame_t* get_facade_frame(frame_t* ogFrame);
+extern const char* facade_mode_name(facade_mode_t mode);
+extern frame_t* get_new_frame_copy(frame_t* ogFrame);
+extern frame_t* get_new_frame_borrowed(pixel_window_t* windows, uint64_t nWindows);
+extern uint64_t get_frame_base_line(frame_t* frame);
+extern uint64_t get_window_lines(frame_t* frame, uint64_t base_line, uint64_t window_id, uint64_t* outLines);
+extern void get_frame_lines(frame_t* frame, bool backwards, std::vector<uint64_t>* outLines);
+extern void get_frame_lines_ordered(frame_t* frame, const access_order_t* order, std::vector<uint64_t>* outLines);
+extern void get_frame_read_lines(frame_t* frame, bool use_facade, const access_order_t* order, std::vector<uint64_t>* outLines);
+extern void get_frame_read_lines_mode(frame_t* frame, facade_mode_t mode, const access_order_t* order, std::vector<uint64_t>* outLines);
+extern double read_frame_lines(const std::vector<uint64_t>& lines, sim_stats_t* cache_stats);
 extern void free_frames();
+extern uint64_t find_frame_at(uint64_t addr);
+extern uint64_t get_frames_state_size();
+extern void save_frames_state(uint8_t* out);
+extern bool check_frames_state(const uint8_t* in, uint64_t size, uint64_t* outCount);
+extern bool load_frames_state(const uint8_t* in, uint64_t size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "heatmap.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+thread_local heatmap_t* heatmap_current = nullptr;
+
+static const char* phase_names[HEATMAP_NUM_PHASES] = {"warmup", "attack", "walk"};
+static const char* metric_names[HEATMAP_NUM_METRICS] = {"hits", "evictions", "cross_evictions"};
+
+//Records every 2^sample_shift-th of the num_sets sets of the given level.
+void heatmap_init(heatmap_t* heatmap, uint8_t level, uint64_t num_sets, uint32_t sample_shift, heatmap_owner_fn_t owner_of) {
+    heatmap->level = level;
+    heatmap->sample_shift = sample_shift;
+    heatmap->num_rows = (num_sets + (1ull << sample_shift) - 1) >> sample_shift;
+    heatmap->owner_of = owner_of;
+    heatmap->phase = SIM_PHASE_WARMUP;
+    heatmap->phase_dump = nullptr;
+    heatmap->phase_dumps = 0;
+    heatmap->counts.assign(HEATMAP_NUM_PHASES * heatmap->num_rows * HEATMAP_MAX_OWNERS * HEATMAP_NUM_METRICS, 0);
+    memset(heatmap->conflicts, 0, sizeof(heatmap->conflicts));
+}
+
+//Records this thread's accesses into heatmap until detached.
+void heatmap_attach(heatmap_t* heatmap) {
+    heatmap_current = heatmap;
+}
+
+void heatmap_detach() {
+    heatmap_current = nullptr;
+}
+
+void heatmap_clear(heatmap_t* heatmap) {
+    std::fill(heatmap->counts.begin(), heatmap->counts.end(), 0);
+    memset(heatmap->conflicts, 0, sizeof(heatmap->conflicts));
+}
+
+//Adds from into into. Both must have been initialized with the same sets and sampling.
+void heatmap_merge(heatmap_t* into, const heatmap_t* from) {
+    for (uint64_t i = 0; i < into->counts.size(); i++) {
+        into->counts[i] += from->counts[i];
+    }
+    for (size_t p = 0; p < HEATMAP_NUM_PHASES; p++) {
+        for (size_t i = 0; i < HEATMAP_MAX_OWNERS; i++) {
+            for (size_t v = 0; v < HEATMAP_MAX_OWNERS; v++) {
+                into->conflicts[p][i][v] += from->conflicts[p][i][v];
+            }
+        }
+    }
+}
+
+//Called by sim_set_phase. Counts after this go to the new phase; the phase that ended is dumped
+//first if the heatmap has a phase_dump file.
+void heatmap_set_phase(sim_phase_t phase) {
+    heatmap_t* heatmap = heatmap_current;
+    if (heatmap == nullptr || heatmap->phase == phase) {
+        return;
+    }
+    if (heatmap->phase_dump != nullptr) {
+        fprintf(heatmap->phase_dump, "# dump %" PRIu64 "\n", heatmap->phase_dumps++);
+        heatmap_dump_phase(heatmap, heatmap->phase, heatmap->phase_dump);
+    }
+    heatmap->phase = phase;
+}
+
+//Writes one metric as a tab-separated matrix: a row per sampled set, a column per owner.
+void heatmap_dump(const heatmap_t* heatmap, sim_phase_t phase, heatmap_metric_t metric, FILE* out) {
+    fprintf(out, "# %s %s\nset", phase_names[phase], metric_names[metric]);
+    for (size_t owner = 0; owner < HEATMAP_MAX_OWNERS; owner++) {
+        fprintf(out, "\tframe%zu%s", owner, owner == HEATMAP_MAX_OWNERS - 1 ? "+" : "");
+    }
+    fprintf(out, "\n");
+    for (uint64_t row = 0; row < heatmap->num_rows; row++) {
+        fprintf(out, "%" PRIu64, row << heatmap->sample_shift);
+        const uint64_t* cells = &heatmap->counts[(phase * heatmap->num_rows + row) * HEATMAP_MAX_OWNERS * HEATMAP_NUM_METRICS];
+        for (size_t owner = 0; owner < HEATMAP_MAX_OWNERS; owner++) {
+            fprintf(out, "\t%" PRIu64, cells[owner * HEATMAP_NUM_METRICS + metric]);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+//Writes the evictions of the phase as a matrix: a row per evicting owner, a column per evicted owner.
+void heatmap_dump_conflicts(const heatmap_t* heatmap, sim_phase_t phase, FILE* out) {
+    fprintf(out, "# %s conflicts\nevictor", phase_names[phase]);
+    for (size_t owner = 0; owner < HEATMAP_MAX_OWNERS; owner++) {
+        fprintf(out, "\tframe%zu", owner);
+    }
+    fprintf(out, "\n");
+    for (size_t evictor = 0; evictor < HEATMAP_MAX_OWNERS; evictor++) {
+        fprintf(out, "frame%zu", evictor);
+        for (size_t owner = 0; owner < HEATMAP_MAX_OWNERS; owner++) {
+            fprintf(out, "\t%" PRIu64, heatmap->conflicts[phase][evictor][owner]);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+//Every metric and the conflicts of a phase, separated by blank lines.
+void heatmap_dump_phase(const heatmap_t* heatmap, sim_phase_t phase, FILE* out) {
+    for (size_t metric = 0; metric < HEATMAP_NUM_METRICS; metric++) {
+        heatmap_dump(heatmap, phase, (heatmap_metric_t) metric, out);
+        fprintf(out, "\n");
+    }
+    heatmap_dump_conflicts(heatmap, phase, out);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,96 @@
+//Per-set conflict instrumentation for one level of the simulated hierarchy.
+//Counts hits, evictions and cross-frame evictions per set and per owning frame, split by sim_phase_t,
+//plus which frame evicted which. Built only with -DSIM_HEATMAP (make HEATMAP=1); otherwise the
+//HEATMAP_* hooks in Cache compile to nothing.
+//
+//A heatmap records the accesses made on the thread it is attached to, so concurrent simulations each
+//attach their own and merge them afterwards. Only every 2^sample_shift-th set is recorded.
+
+#ifndef HEATMAP_HPP
+#define HEATMAP_HPP
+
+#include "cache_sim.hpp"
+
+#include <cstdio>
+#include <vector>
+
+#define HEATMAP_NUM_PHASES 3
+#define HEATMAP_MAX_OWNERS 16   //Frames past the last get lumped into it
+
+typedef enum heatmap_metric {
+    HEATMAP_METRIC_HITS,
+    HEATMAP_METRIC_EVICTIONS,       //Blocks of the owner evicted from the set
+    HEATMAP_METRIC_CROSS_EVICTIONS, //Those evicted by another owner's install
+    HEATMAP_NUM_METRICS
+} heatmap_metric_t;
+
+//Maps a block address to its owner, e.g. find_frame_at.
+typedef uint64_t (*heatmap_owner_fn_t)(uint64_t addr);
+
+typedef struct {
+    uint8_t level;          //1 = L1, 2 = L2
+    uint32_t sample_shift;
+    uint64_t num_rows;      //Sampled sets
+    heatmap_owner_fn_t owner_of;
+    sim_phase_t phase;
+    //[phase][row][owner][metric]
+    std::vector<uint64_t> counts;
+    //[phase][evicting owner][evicted owner]
+    uint64_t conflicts[HEATMAP_NUM_PHASES][HEATMAP_MAX_OWNERS][HEATMAP_MAX_OWNERS];
+    FILE* phase_dump;       //If set, each phase's matrices are appended here when it ends
+    uint64_t phase_dumps;
+} heatmap_t;
+
+extern thread_local heatmap_t* heatmap_current;
+
+extern void heatmap_init(heatmap_t* heatmap, uint8_t level, uint64_t num_sets, uint32_t sample_shift, heatmap_owner_fn_t owner_of);
+extern void heatmap_attach(heatmap_t* heatmap);
+extern void heatmap_detach();
+extern void heatmap_clear(heatmap_t* heatmap);
+extern void heatmap_merge(heatmap_t* into, const heatmap_t* from);
+extern void heatmap_set_phase(sim_phase_t phase);
+extern void heatmap_dump(const heatmap_t* heatmap, sim_phase_t phase, heatmap_metric_t metric, FILE* out);
+extern void heatmap_dump_conflicts(const heatmap_t* heatmap, sim_phase_t phase, FILE* out);
+extern void heatmap_dump_phase(const heatmap_t* heatmap, sim_phase_t phase, FILE* out);
+
+inline uint64_t heatmap_owner(const heatmap_t* heatmap, uint64_t addr) {
+    const uint64_t owner = heatmap->owner_of != nullptr ? heatmap->owner_of(addr) : 0;
+    return owner < HEATMAP_MAX_OWNERS ? owner : HEATMAP_MAX_OWNERS - 1;
+}
+
+inline uint64_t* heatmap_cell(heatmap_t* heatmap, uint64_t row, uint64_t owner) {
+    return &heatmap->counts[((heatmap->phase * heatmap->num_rows + row) * HEATMAP_MAX_OWNERS + owner) * HEATMAP_NUM_METRICS];
+}
+
+inline bool heatmap_sampled(const heatmap_t* heatmap, uint8_t level, uint64_t index) {
+    return heatmap->level == level && (index & ((1ull << heatmap->sample_shift) - 1)) == 0;
+}
+
+inline void heatmap_record_hit(heatmap_t* heatmap, uint8_t level, uint64_t index, uint64_t addr) {
+    if (heatmap_sampled(heatmap, level, index)) {
+        heatmap_cell(heatmap, index >> heatmap->sample_shift, heatmap_owner(heatmap, addr))[HEATMAP_METRIC_HITS]++;
+    }
+}
+
+inline void heatmap_record_evict(heatmap_t* heatmap, uint8_t level, uint64_t index, uint64_t victim, uint64_t installed) {
+    if (heatmap_sampled(heatmap, level, index)) {
+        const uint64_t victimOwner = heatmap_owner(heatmap, victim);
+        const uint64_t installOwner = heatmap_owner(heatmap, installed);
+        uint64_t* cell = heatmap_cell(heatmap, index >> heatmap->sample_shift, victimOwner);
+        cell[HEATMAP_METRIC_EVICTIONS]++;
+        cell[HEATMAP_METRIC_CROSS_EVICTIONS] += victimOwner != installOwner;
+        heatmap->conflicts[heatmap->phase][installOwner][victimOwner]++;
+    }
+}
+
+#ifdef SIM_HEATMAP
+#define HEATMAP_HIT(level, index, addr) \
+    do { if (heatmap_current != nullptr) heatmap_record_hit(heatmap_current, level, index, addr); } while (0)
+#define HEATMAP_EVICT(level, index, victim, installed) \
+    do { if (heatmap_current != nullptr) heatmap_record_evict(heatmap_current, level, index, victim, installed); } while (0)
+#else
+#define HEATMAP_HIT(level, index, addr) do {} while (0)
+#define HEATMAP_EVICT(level, index, victim, installed) do {} while (0)
+#endif
+
+#endif
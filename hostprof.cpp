@@ -0,0 +1,201 @@
+#include "hostprof.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+typedef struct {
+    uint64_t ns;
+    uint64_t counters[HOSTPROF_NUM_COUNTERS];
+} hostprof_sample_t;
+
+typedef struct {
+    uint64_t calls;
+    hostprof_sample_t total;
+    hostprof_sample_t start;
+    bool open;
+} hostprof_stats_t;
+
+static const char* region_names[HOSTPROF_NUM_REGIONS] = {"warmup", "attack", "walk", "facade", "compress"};
+static const uint64_t counter_configs[HOSTPROF_NUM_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+//Counters only exist on the thread that called hostprof_init.
+static thread_local int group_fd = -1;
+static thread_local int counter_fds[HOSTPROF_NUM_COUNTERS];
+static thread_local bool counters_open;
+
+//Every thread accumulates its own regions; they are merged when printed, and when the thread exits.
+static std::mutex threads_mutex;
+static std::vector<hostprof_stats_t*> thread_regions;
+static hostprof_stats_t exited_regions[HOSTPROF_NUM_REGIONS];
+
+static void add_regions(hostprof_stats_t* to, const hostprof_stats_t* from) {
+    for (size_t r = 0; r < HOSTPROF_NUM_REGIONS; r++) {
+        to[r].calls += from[r].calls;
+        to[r].total.ns += from[r].total.ns;
+        for (size_t c = 0; c < HOSTPROF_NUM_COUNTERS; c++) {
+            to[r].total.counters[c] += from[r].total.counters[c];
+        }
+    }
+}
+
+namespace {
+    struct local_regions_t {
+        hostprof_stats_t regions[HOSTPROF_NUM_REGIONS];
+
+        local_regions_t() {
+            memset(regions, 0, sizeof(regions));
+            std::lock_guard<std::mutex> lock(threads_mutex);
+            thread_regions.push_back(regions);
+        }
+
+        ~local_regions_t() {
+            std::lock_guard<std::mutex> lock(threads_mutex);
+            add_regions(exited_regions, regions);
+            thread_regions.erase(std::find(thread_regions.begin(), thread_regions.end(), regions));
+        }
+    };
+}
+
+static thread_local local_regions_t local;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void take_sample(hostprof_sample_t* sample) {
+    sample->ns = now_ns();
+    if (group_fd < 0) {
+        return;
+    }
+    //The number of counters, the group's time enabled and running, then each value in the order they were
+    //opened. When the PMU is multiplexed the group only counts while running, so scale up to the time enabled.
+    uint64_t values[3 + HOSTPROF_NUM_COUNTERS];
+    if (read(group_fd, values, sizeof(values)) == (ssize_t) sizeof(values)) {
+        const double scale = values[2] == 0 ? 0.0 : (double) values[1] / values[2];
+        for (size_t c = 0; c < HOSTPROF_NUM_COUNTERS; c++) {
+            sample->counters[c] = (uint64_t) (values[3 + c] * scale);
+        }
+    }
+}
+
+static int open_counter(uint64_t config, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = group < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+//Opens the counters for the calling thread. Returns false, and profiles time only, if any of them
+//cannot be opened (no PMU access, perf_event_paranoid, seccomp).
+bool hostprof_init() {
+    hostprof_close();
+    hostprof_reset();
+    for (size_t c = 0; c < HOSTPROF_NUM_COUNTERS; c++) {
+        counter_fds[c] = open_counter(counter_configs[c], c == 0 ? -1 : counter_fds[0]);
+        if (counter_fds[c] < 0) {
+            for (size_t o = 0; o < c; o++) {
+                close(counter_fds[o]);
+            }
+            return false;
+        }
+    }
+    group_fd = counter_fds[0];
+    counters_open = true;
+    ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void hostprof_close() {
+    if (group_fd < 0) {
+        return;
+    }
+    for (size_t c = 0; c < HOSTPROF_NUM_COUNTERS; c++) {
+        close(counter_fds[c]);
+    }
+    group_fd = -1;
+    counters_open = false;
+}
+
+//Clears every thread's regions. Call while no other thread is profiling.
+void hostprof_reset() {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    memset(exited_regions, 0, sizeof(exited_regions));
+    for (hostprof_stats_t* regions : thread_regions) {
+        memset(regions, 0, HOSTPROF_NUM_REGIONS*sizeof(hostprof_stats_t));
+    }
+}
+
+void hostprof_begin(hostprof_region_t region) {
+    hostprof_stats_t* stats = &local.regions[region];
+    take_sample(&stats->start);
+    stats->open = true;
+}
+
+//Ends the region if it was begun, so phase switches can end whichever phase is current.
+void hostprof_end(hostprof_region_t region) {
+    hostprof_stats_t* stats = &local.regions[region];
+    if (!stats->open) {
+        return;
+    }
+    hostprof_sample_t end;
+    take_sample(&end);
+    stats->total.ns += end.ns - stats->start.ns;
+    for (size_t c = 0; c < HOSTPROF_NUM_COUNTERS; c++) {
+        stats->total.counters[c] += end.counters[c] - stats->start.counters[c];
+    }
+    stats->calls++;
+    stats->open = false;
+}
+
+//Prints the regions of every thread combined, with counters if this thread opened them. Call while no
+//other thread is profiling.
+void print_hostprof(FILE* out) {
+    hostprof_stats_t regions[HOSTPROF_NUM_REGIONS];
+    memset(regions, 0, sizeof(regions));
+    {
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        add_regions(regions, exited_regions);
+        for (hostprof_stats_t* threadRegions : thread_regions) {
+            add_regions(regions, threadRegions);
+        }
+    }
+
+    if (!counters_open) {
+        fprintf(out, "Region\tCalls\tms\n");
+        for (size_t r = 0; r < HOSTPROF_NUM_REGIONS; r++) {
+            fprintf(out, "%s\t%" PRIu64 "\t%.3f\n", region_names[r], regions[r].calls, regions[r].total.ns / 1e6);
+        }
+        return;
+    }
+
+    fprintf(out, "Region\tCalls\tms\tCycles\tInstructions\tIPC\tLLC Misses\tBranch Misses\tMPKI (LLC/Branch)\n");
+    for (size_t r = 0; r < HOSTPROF_NUM_REGIONS; r++) {
+        const hostprof_sample_t* total = &regions[r].total;
+        const double kiloInstructions = total->counters[HOSTPROF_INSTRUCTIONS] / 1000.0;
+        fprintf(out, "%s\t%" PRIu64 "\t%.3f\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%" PRIu64 "\t%" PRIu64 "\t%.2f/%.2f\n",
+            region_names[r], regions[r].calls, total->ns / 1e6,
+            total->counters[HOSTPROF_CYCLES], total->counters[HOSTPROF_INSTRUCTIONS],
+            total->counters[HOSTPROF_CYCLES] == 0 ? 0.0 : (double) total->counters[HOSTPROF_INSTRUCTIONS] / total->counters[HOSTPROF_CYCLES],
+            total->counters[HOSTPROF_LLC_MISSES], total->counters[HOSTPROF_BRANCH_MISSES],
+            kiloInstructions == 0 ? 0.0 : total->counters[HOSTPROF_LLC_MISSES] / kiloInstructions,
+            kiloInstructions == 0 ? 0.0 : total->counters[HOSTPROF_BRANCH_MISSES] / kiloInstructions);
+    }
+}
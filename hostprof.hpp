@@ -0,0 +1,50 @@
+//Host-side profiling of the simulator's own phases.
+//Each region accumulates wall time and, where perf_event_open is allowed, the host's cycles,
+//instructions, LLC misses and branch misses spent in it. Without counters only the time is kept.
+//Built only with -DSIM_HOSTPROF (make HOSTPROF=1); otherwise the HOSTPROF_* hooks compile to nothing.
+//
+//The sim phases are profiled from sim_setup, sim_set_phase and sim_finish. Facade generation and
+//compress() are nested in them, so their counts are also part of the enclosing phase, along with the
+//cost of reading the counters around every compress() call. Each thread profiles into its own
+//regions, which print_hostprof adds up; the counters only count the thread that called hostprof_init,
+//and are scaled up for the time the PMU multiplexed them out.
+
+#ifndef HOSTPROF_HPP
+#define HOSTPROF_HPP
+
+#include <cstdio>
+#include <inttypes.h>
+
+typedef enum hostprof_region {
+    HOSTPROF_WARMUP,    //Same order as sim_phase_t
+    HOSTPROF_ATTACK,
+    HOSTPROF_WALK,
+    HOSTPROF_FACADE,    //get_facade_frame
+    HOSTPROF_COMPRESS,  //compress() in read_window
+    HOSTPROF_NUM_REGIONS
+} hostprof_region_t;
+
+typedef enum hostprof_counter {
+    HOSTPROF_CYCLES,
+    HOSTPROF_INSTRUCTIONS,
+    HOSTPROF_LLC_MISSES,
+    HOSTPROF_BRANCH_MISSES,
+    HOSTPROF_NUM_COUNTERS
+} hostprof_counter_t;
+
+extern bool hostprof_init();
+extern void hostprof_begin(hostprof_region_t region);
+extern void hostprof_end(hostprof_region_t region);
+extern void hostprof_reset();
+extern void print_hostprof(FILE* out);
+extern void hostprof_close();
+
+#ifdef SIM_HOSTPROF
+#define HOSTPROF_BEGIN(region) hostprof_begin(region)
+#define HOSTPROF_END(region) hostprof_end(region)
+#else
+#define HOSTPROF_BEGIN(region) do {} while (0)
+#define HOSTPROF_END(region) do {} while (0)
+#endif
+
+#endif
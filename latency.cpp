@@ -0,0 +1,101 @@
+#include "latency.hpp"
+
+#include <cstring>
+
+thread_local phase_latency_t* latency_current = nullptr;
+
+static const char* phase_names[LATENCY_NUM_PHASES] = {"warmup", "attack", "walk"};
+
+//Lowest value in units that falls in a bucket.
+static uint64_t bucket_floor(uint64_t bucket) {
+    if (bucket < 2*LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    const uint64_t shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    return (bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS) << shift;
+}
+
+//Lowest latency that falls in a bucket.
+double hdr_hist_bucket_value(uint64_t bucket) {
+    return (double) bucket_floor(bucket) / LATENCY_UNITS_PER_TIME;
+}
+
+void hdr_hist_clear(hdr_hist_t* hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void hdr_hist_merge(hdr_hist_t* into, const hdr_hist_t* from) {
+    for (uint64_t b = 0; b < LATENCY_NUM_BUCKETS; b++) {
+        into->buckets[b] += from->buckets[b];
+    }
+    into->count += from->count;
+    into->sum += from->sum;
+    into->min = from->min < into->min ? from->min : into->min;
+    into->max = from->max > into->max ? from->max : into->max;
+}
+
+//Smallest recorded value (to the bucket's precision) that at least percentile% of values are at or
+//below. 0 for an empty histogram.
+double hdr_hist_percentile(const hdr_hist_t* hist, double percentile) {
+    if (hist->count == 0) {
+        return 0.0;
+    }
+    uint64_t rank = (uint64_t) (percentile / 100.0 * hist->count + 0.5);
+    rank = rank < 1 ? 1 : (rank > hist->count ? hist->count : rank);
+
+    uint64_t seen = 0;
+    for (uint64_t b = hdr_hist_bucket(hist->min); b < LATENCY_NUM_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen >= rank) {
+            //The extremes are known exactly
+            uint64_t units = bucket_floor(b);
+            units = units < hist->min ? hist->min : (units > hist->max ? hist->max : units);
+            return (double) units / LATENCY_UNITS_PER_TIME;
+        }
+    }
+    return (double) hist->max / LATENCY_UNITS_PER_TIME;
+}
+
+double hdr_hist_mean(const hdr_hist_t* hist) {
+    return hist->count == 0 ? 0.0 : hist->sum / hist->count;
+}
+
+void latency_clear(phase_latency_t* latency) {
+    for (size_t p = 0; p < LATENCY_NUM_PHASES; p++) {
+        hdr_hist_clear(&latency->access[p]);
+        hdr_hist_clear(&latency->window[p]);
+        hdr_hist_clear(&latency->hit[p]);
+        hdr_hist_clear(&latency->miss[p]);
+    }
+}
+
+void latency_merge(phase_latency_t* into, const phase_latency_t* from) {
+    for (size_t p = 0; p < LATENCY_NUM_PHASES; p++) {
+        hdr_hist_merge(&into->access[p], &from->access[p]);
+        hdr_hist_merge(&into->window[p], &from->window[p]);
+        hdr_hist_merge(&into->hit[p], &from->hit[p]);
+        hdr_hist_merge(&into->miss[p], &from->miss[p]);
+    }
+}
+
+//Records this thread's reads into latency (nullptr to stop). Returns the histograms attached before.
+phase_latency_t* latency_attach(phase_latency_t* latency) {
+    phase_latency_t* previous = latency_current;
+    latency_current = latency;
+    return previous;
+}
+
+void print_phase_latency(const phase_latency_t* latency, FILE* out) {
+    fprintf(out, "Phase\tKind\tCount\tMean\tP50\tP90\tP99\tP99.9\tMax\n");
+    for (size_t p = 0; p < LATENCY_NUM_PHASES; p++) {
+        const hdr_hist_t* hists[] = {&latency->access[p], &latency->window[p], &latency->hit[p], &latency->miss[p]};
+        const char* kinds[] = {"access", "window", "hit", "miss"};
+        for (size_t k = 0; k < 4; k++) {
+            const hdr_hist_t* hist = hists[k];
+            fprintf(out, "%s\t%s\t%" PRIu64 "\t%.2f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\n", phase_names[p], kinds[k], hist->count,
+                hdr_hist_mean(hist), hdr_hist_percentile(hist, 50), hdr_hist_percentile(hist, 90), hdr_hist_percentile(hist, 99),
+                hdr_hist_percentile(hist, 99.9), hdr_hist_percentile(hist, 100));
+        }
+    }
+}
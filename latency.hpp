@@ -0,0 +1,71 @@
+//Latency distributions of the simulated accesses, split by sim_phase_t.
+//hdr_hist_t is an HDR-style histogram: values are kept in fixed point with LATENCY_SUB_BUCKET_BITS
+//significant bits, so the bucket of a value is a shift and an add and memory does not grow with the
+//range. Values below 2^(LATENCY_SUB_BUCKET_BITS+1) units fall in buckets of their own and are exact.
+//
+//read_window records every access and every window into the histograms attached to the calling
+//thread, and sim_access records every simulated access by its outcome, so the hit and miss histograms
+//can be fed to timing_model_from_hist. Histograms from parallel trials are combined with latency_merge.
+
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include "cache_sim.hpp"
+
+#include <cstdio>
+
+#define LATENCY_UNITS_PER_TIME 10   //Resolution of 0.1 time units
+#define LATENCY_SUB_BUCKET_BITS 7
+#define LATENCY_MAX_BITS 40         //Larger values are clamped
+#define LATENCY_SUB_BUCKETS (1 << (LATENCY_SUB_BUCKET_BITS))
+#define LATENCY_NUM_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+#define LATENCY_NUM_PHASES 3
+
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    uint64_t buckets[LATENCY_NUM_BUCKETS];
+} hdr_hist_t;
+
+typedef struct {
+    hdr_hist_t access[LATENCY_NUM_PHASES];  //Each sim_access
+    hdr_hist_t window[LATENCY_NUM_PHASES];  //Each window read, i.e. its one or two accesses
+    hdr_hist_t hit[LATENCY_NUM_PHASES];     //Each sim_access that hit in the LLC
+    hdr_hist_t miss[LATENCY_NUM_PHASES];    //Each sim_access that missed
+} phase_latency_t;
+
+extern thread_local phase_latency_t* latency_current;
+
+extern void hdr_hist_clear(hdr_hist_t* hist);
+extern void hdr_hist_merge(hdr_hist_t* into, const hdr_hist_t* from);
+extern double hdr_hist_percentile(const hdr_hist_t* hist, double percentile);
+extern double hdr_hist_mean(const hdr_hist_t* hist);
+extern double hdr_hist_bucket_value(uint64_t bucket);
+extern void latency_clear(phase_latency_t* latency);
+extern void latency_merge(phase_latency_t* into, const phase_latency_t* from);
+extern phase_latency_t* latency_attach(phase_latency_t* latency);
+extern void print_phase_latency(const phase_latency_t* latency, FILE* out);
+
+inline uint64_t hdr_hist_bucket(uint64_t units) {
+    if (units < 2*LATENCY_SUB_BUCKETS) {
+        return units;
+    }
+    const uint64_t shift = 63 - __builtin_clzll(units) - LATENCY_SUB_BUCKET_BITS;
+    return shift * LATENCY_SUB_BUCKETS + (units >> shift);
+}
+
+inline void hdr_hist_record(hdr_hist_t* hist, double value) {
+    uint64_t units = (uint64_t) (value * LATENCY_UNITS_PER_TIME + 0.5);
+    if (units >= (1ull << LATENCY_MAX_BITS)) {
+        units = (1ull << LATENCY_MAX_BITS) - 1;
+    }
+    hist->buckets[hdr_hist_bucket(units)]++;
+    hist->count++;
+    hist->sum += value;
+    hist->min = units < hist->min ? units : hist->min;
+    hist->max = units > hist->max ? units : hist->max;
+}
+
+#endif
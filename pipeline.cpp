@@ -0,0 +1,214 @@
+#include "pipeline.hpp"
+#include "spsc_ring.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+typedef SpscRing<line_batch_t, PIPELINE_RING_SLOTS> batch_ring_t;
+typedef std::chrono::steady_clock pipeline_clock_t;
+
+namespace {
+    inline double seconds_since(pipeline_clock_t::time_point start) {
+        return std::chrono::duration<double>(pipeline_clock_t::now() - start).count();
+    }
+
+    typedef struct {
+        batch_ring_t* ring;
+        line_batch_t* open;     //ACCESS batch being filled, nullptr if none
+        pipeline_stage_stats_t* stats;
+    } producer_t;
+
+    line_batch_t* acquire_batch(producer_t* producer) {
+        line_batch_t* batch = producer->ring->acquire_write();
+        if (batch == nullptr) {
+            pipeline_clock_t::time_point start = pipeline_clock_t::now();
+            while ((batch = producer->ring->acquire_write()) == nullptr) {
+                std::this_thread::yield();
+            }
+            producer->stats->stall_seconds += seconds_since(start);
+        }
+        return batch;
+    }
+
+    void commit_batch(producer_t* producer) {
+        producer->ring->commit_write();
+        producer->stats->batches++;
+    }
+
+    void flush_lines(producer_t* producer) {
+        if (producer->open != nullptr) {
+            commit_batch(producer);
+            producer->open = nullptr;
+        }
+    }
+
+    //Commands are ordered after every line emitted before them.
+    void emit_cmd(producer_t* producer, pipeline_cmd_t cmd, uint8_t phase=0, uint32_t pixel=0, bool actual_white=false) {
+        flush_lines(producer);
+        line_batch_t* batch = acquire_batch(producer);
+        batch->cmd = cmd;
+        batch->phase = phase;
+        batch->pixel = pixel;
+        batch->actual_white = actual_white;
+        batch->count = 0;
+        commit_batch(producer);
+    }
+
+    //Emits lines, keeping a window's two lines in one batch so the consumer can sum them per window.
+    void emit_lines(producer_t* producer, const std::vector<uint64_t>& lines) {
+        for (size_t i = 0; i < lines.size(); ) {
+            if (producer->open == nullptr) {
+                producer->open = acquire_batch(producer);
+                producer->open->cmd = PIPELINE_CMD_ACCESS;
+                producer->open->count = 0;
+            }
+
+            line_batch_t* batch = producer->open;
+            batch->lines[batch->count++] = lines[i++];
+            if (i < lines.size() && is_window_second_line(lines[i-1], lines[i])) {
+                batch->lines[batch->count++] = lines[i++];
+            }
+            if (batch->count + 2 > PIPELINE_BATCH_LINES) {
+                flush_lines(producer);
+            }
+        }
+    }
+
+    //Emits the lines a read of frame in order accesses, behind the facade of facade_mode when use_facade,
+    //compressing its windows (and a full facade's) on the way.
+    void emit_frame(producer_t* producer, frame_t* frame, bool use_facade, const access_order_t* order) {
+        static thread_local std::vector<uint64_t> lines;
+        lines.clear();
+        get_frame_read_lines(frame, use_facade, order, &lines);
+        emit_lines(producer, lines);
+        producer->stats->items += frame->nWindows * (use_facade && facade_mode == FACADE_FULL ? 2 : 1);
+    }
+
+    //Emits the same accesses as attack_pixel, for every pixel of the victim. The facades the reads need
+    //are built before the producer starts, so it never registers frames while the consumer simulates.
+    void produce(batch_ring_t* ring, const attack_frames_t* frames, bool use_facade, const access_order_t* render_order,
+            const access_order_t* walk_order, pipeline_stage_stats_t* stats) {
+        pipeline_clock_t::time_point start = pipeline_clock_t::now();
+        producer_t producer = {ring, nullptr, stats};
+        const access_order_t* fill_order = get_access_order(ACCESS_ORDER_LINEAR, frames->buffer->nWindows);
+        for (uint32_t pixel = 0; pixel < ATTACK_NUM_PIXELS; pixel++) {
+            const size_t w = pixel / WINDOW_NUM_PIXELS;
+            const size_t p = pixel % WINDOW_NUM_PIXELS;
+            const bool actual_white = frames->victim->windows[w].pixels[p][0] > 127;
+            frame_t* attacker_frame = actual_white ? frames->noise : frames->black;
+
+            emit_cmd(&producer, PIPELINE_CMD_BEGIN_TRIAL);
+            emit_frame(&producer, frames->buffer, false, fill_order);
+            emit_cmd(&producer, PIPELINE_CMD_PHASE, SIM_PHASE_ATTACK);
+            emit_frame(&producer, attacker_frame, use_facade, render_order);
+            emit_cmd(&producer, PIPELINE_CMD_PHASE, SIM_PHASE_WALK);
+            emit_frame(&producer, frames->buffer, false, walk_order);
+            emit_cmd(&producer, PIPELINE_CMD_END_TRIAL, 0, pixel, actual_white);
+        }
+        emit_cmd(&producer, PIPELINE_CMD_STOP);
+        stats->seconds = seconds_since(start);
+    }
+}
+
+//Same trials and results as do_pixel_attack. The consumer simulates every line the producer emits and
+//leaves set sampling to sim_access, since sim_is_sampled is not safe to call from the producer.
+double do_pixel_attack_pipelined(bool use_facade, trial_store_t* store, pipeline_stats_t* stats) {
+    attack_frames_t frames;
+    init_attack_frames(&frames);
+    uint16_t config = store != nullptr ? trial_store_add_config(store, &cache_config, use_facade, facade_mode, &attack_order) : 0;
+
+    pipeline_stats_t local_stats;
+    if (stats == nullptr) {
+        stats = &local_stats;
+    }
+    *stats = pipeline_stats_t();
+
+    //Built once per attacker frame up front, so the producer never registers frames while the consumer
+    //simulates
+    if (use_facade && (facade_mode == FACADE_FULL || facade_mode == FACADE_SELECTIVE)) {
+        get_facade_frame(frames.black);
+        get_facade_frame(frames.noise);
+    }
+    const access_order_t* render_order = get_access_order(attack_order.render, FRAME_NUM_WINDOWS_CACHE, attack_order.seed);
+    const access_order_t* walk_order = get_access_order(attack_order.walk, FRAME_NUM_WINDOWS_CACHE, attack_order.seed);
+
+    batch_ring_t* ring = new batch_ring_t();
+    std::thread producer(produce, ring, &frames, use_facade, render_order, walk_order, &stats->producer);
+
+    pipeline_clock_t::time_point start = pipeline_clock_t::now();
+    pipeline_stage_stats_t* consumer = &stats->consumer;
+    uint64_t correct_pixels = 0;
+    sim_stats_t cache_stats;
+    double walk_time = 0.0;
+    sim_phase_t phase = SIM_PHASE_WARMUP;
+    for (bool running = true; running; ) {
+        line_batch_t* batch = ring->acquire_read();
+        if (batch == nullptr) {
+            pipeline_clock_t::time_point stall = pipeline_clock_t::now();
+            while ((batch = ring->acquire_read()) == nullptr) {
+                std::this_thread::yield();
+            }
+            consumer->stall_seconds += seconds_since(stall);
+        }
+
+        switch ((pipeline_cmd_t) batch->cmd) {
+            case PIPELINE_CMD_ACCESS:
+                //Sum per window, in read_window's order, so the walk time matches the serial attack exactly.
+                //A window's second line always directly follows its first.
+                for (uint32_t i = 0; i < batch->count; i++) {
+                    double windowTime = sim_access_line('R', batch->lines[i], &cache_stats);
+                    if (i + 1 < batch->count && is_window_second_line(batch->lines[i], batch->lines[i+1])) {
+                        windowTime += sim_access_line('R', batch->lines[++i], &cache_stats);
+                    }
+                    if (phase == SIM_PHASE_WALK) {
+                        walk_time += windowTime;
+                    }
+                }
+                consumer->items += batch->count;
+                break;
+            case PIPELINE_CMD_BEGIN_TRIAL:
+                init_stats(&cache_stats);
+                sim_setup(&cache_config);
+                walk_time = 0.0;
+                phase = SIM_PHASE_WARMUP;
+                break;
+            case PIPELINE_CMD_PHASE:
+                phase = (sim_phase_t) batch->phase;
+                sim_set_phase(phase);
+                break;
+            case PIPELINE_CMD_END_TRIAL: {
+                cache_stats.llc_walk_time = walk_time;
+                sim_finish(&cache_stats);
+                bool guess_white = guess_pixel_white(cache_stats.llc_walk_time, use_facade);
+                correct_pixels += guess_white == (bool) batch->actual_white;
+                if (store != nullptr) {
+                    trial_store_record(store, config, batch->pixel, batch->actual_white, 
+                        cache_stats.llc_walk_time, cache_stats.num_evictions);
+                }
+                break;
+            }
+            case PIPELINE_CMD_STOP:
+                running = false;
+                break;
+        }
+        ring->commit_read();
+        consumer->batches++;
+    }
+    consumer->seconds = seconds_since(start);
+
+    producer.join();
+    delete ring;
+    return (double) correct_pixels / ATTACK_NUM_PIXELS;
+}
+
+void print_pipeline_stats(const pipeline_stats_t* stats) {
+    const pipeline_stage_stats_t* stages[] = {&stats->producer, &stats->consumer};
+    const char* names[] = {"Compress (windows)", "Simulate (lines)"};
+    printf("Stage\tItems\tBatches\tSeconds\tStalled\tItems/s (busy)\n");
+    for (size_t i = 0; i < 2; i++) {
+        const double busy = stages[i]->seconds - stages[i]->stall_seconds;
+        printf("%s\t%" PRIu64 "\t%" PRIu64 "\t%.3f\t%.3f\t%.0f\n", names[i], stages[i]->items, stages[i]->batches, 
+            stages[i]->seconds, stages[i]->stall_seconds, busy > 0 ? stages[i]->items / busy : 0.0);
+    }
+}
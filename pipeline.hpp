@@ -0,0 +1,46 @@
+//The pixel attack as a two-stage pipeline.
+//A producer thread compresses the frames' windows and emits the resulting line addresses in batches;
+//the consumer (the calling thread) drives the cache simulator with them. The stages share only an
+//SpscRing of batches, so compression overlaps with simulation.
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "experiment.hpp"
+
+#define PIPELINE_BATCH_LINES 1024
+#define PIPELINE_RING_SLOTS 16
+
+typedef enum pipeline_cmd {
+    PIPELINE_CMD_ACCESS,        //Read every line of the batch
+    PIPELINE_CMD_BEGIN_TRIAL,   //sim_setup
+    PIPELINE_CMD_PHASE,         //sim_set_phase(phase)
+    PIPELINE_CMD_END_TRIAL,     //sim_finish and score the pixel
+    PIPELINE_CMD_STOP,
+} pipeline_cmd_t;
+
+typedef struct {
+    uint8_t cmd;            //pipeline_cmd_t
+    uint8_t phase;          //sim_phase_t, PHASE only
+    uint8_t actual_white;   //END_TRIAL only
+    uint32_t pixel;         //END_TRIAL only
+    uint32_t count;         //Lines used, ACCESS only
+    uint64_t lines[PIPELINE_BATCH_LINES];
+} line_batch_t;
+
+typedef struct {
+    uint64_t batches;
+    uint64_t items;         //Windows compressed by the producer, lines simulated by the consumer
+    double seconds;         //Wall time of the stage
+    double stall_seconds;   //Time spent waiting on a full (producer) or empty (consumer) ring
+} pipeline_stage_stats_t;
+
+typedef struct {
+    pipeline_stage_stats_t producer;
+    pipeline_stage_stats_t consumer;
+} pipeline_stats_t;
+
+extern double do_pixel_attack_pipelined(bool use_facade, trial_store_t* store=nullptr, pipeline_stats_t* stats=nullptr);
+extern void print_pipeline_stats(const pipeline_stats_t* stats);
+
+#endif
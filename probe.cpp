@@ -0,0 +1,130 @@
+#include "probe.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+//Groups the buffer's lines by LLC set under cache_config and keeps those of probe_sets sets picked like
+//the sampled sets (every set when probe_sets is 0 or covers the cache).
+void build_probe_plan(frame_t* buffer, uint64_t probe_sets, probe_plan_t* plan) {
+    sim_stats_t stats;
+    init_stats(&stats);
+    sim_setup(&cache_config);
+    plan->llc_sets = sim_llc_num_sets();
+    if (probe_sets == 0 || probe_sets > plan->llc_sets) {
+        probe_sets = plan->llc_sets;
+    }
+
+    std::vector<int64_t> slot(plan->llc_sets, -1);
+    plan->sets.resize(probe_sets);
+    sim_pick_llc_sets(probe_sets, plan->sets.data());
+    std::sort(plan->sets.begin(), plan->sets.end());
+    for (uint64_t i = 0; i < probe_sets; i++) {
+        slot[plan->sets[i]] = i;
+    }
+
+    std::vector<uint64_t> lines;
+    get_frame_lines(buffer, false, &lines);
+    plan->eviction_sets.assign(probe_sets, std::vector<uint64_t>());
+    for (uint64_t line : lines) {
+        const int64_t s = slot[sim_llc_set(line)];
+        if (s >= 0) {
+            plan->eviction_sets[s].push_back(line);
+        }
+    }
+    sim_finish(&stats);
+}
+
+void probe_prime(const probe_plan_t* plan, sim_stats_t* stats) {
+    for (const std::vector<uint64_t>& lines : plan->eviction_sets) {
+        for (uint64_t line : lines) {
+            sim_access_line('R', line, stats);
+        }
+    }
+}
+
+//Probes every eviction set in reverse and returns the time scaled up to the whole LLC.
+double probe_walk_time(const probe_plan_t* plan, sim_stats_t* stats) {
+    double totalTime = 0.0;
+    for (const std::vector<uint64_t>& lines : plan->eviction_sets) {
+        for (auto it = lines.rbegin(); it != lines.rend(); it++) {
+            totalTime += sim_access_line('R', *it, stats);
+        }
+    }
+    return totalTime * plan->llc_sets / plan->sets.size();
+}
+
+//do_pixel_attack with each trial measured by probing probe_sets sets.
+double do_pixel_attack_probe(bool use_facade, uint64_t probe_sets, trial_store_t* store) {
+    attack_frames_t frames;
+    init_attack_frames(&frames);
+    uint16_t config = store != nullptr ? trial_store_add_config(store, &cache_config, use_facade, facade_mode, &attack_order) : 0;
+    probe_plan_t plan;
+    build_probe_plan(frames.buffer, probe_sets, &plan);
+
+    uint64_t correct_pixels = 0;
+    for (uint32_t pixel = 0; pixel < ATTACK_NUM_PIXELS; pixel++) {
+        const bool actual_white = frames.victim->windows[pixel / WINDOW_NUM_PIXELS].pixels[pixel % WINDOW_NUM_PIXELS][0] > 127;
+        frame_t* attacker_frame = actual_white ? frames.noise : frames.black;
+        sim_stats_t cache_stats;
+        init_stats(&cache_stats);
+
+        sim_setup(&cache_config);
+        probe_prime(&plan, &cache_stats);
+        sim_set_phase(SIM_PHASE_ATTACK);
+        const access_order_t* render_order = get_access_order(attack_order.render, attacker_frame->nWindows, attack_order.seed);
+        if (use_facade) {
+            read_frame_facade_ordered(attacker_frame, render_order, &cache_stats);
+        } else {
+            read_frame_ordered(attacker_frame, render_order, &cache_stats);
+        }
+        sim_set_phase(SIM_PHASE_WALK);
+        cache_stats.llc_walk_time = probe_walk_time(&plan, &cache_stats);
+        sim_finish(&cache_stats);
+
+        if (store != nullptr) {
+            trial_store_record(store, config, pixel, actual_white, cache_stats.llc_walk_time, cache_stats.num_evictions);
+        }
+        if (guess_pixel_white(cache_stats.llc_walk_time, use_facade) == actual_white) {
+            correct_pixels++;
+        }
+    }
+
+    free_frames();
+    return (double) correct_pixels / ATTACK_NUM_PIXELS;
+}
+
+//Runs the attack once per entry of probe_sets (0 = the full backwards walk) and reports each one's
+//accuracy at the built-in threshold, its ROC AUC and best threshold, and its run time.
+void compare_probe_attack(bool use_facade, const std::vector<uint64_t>& probe_sets, std::vector<probe_comparison_t>* out) {
+    for (uint64_t sets : probe_sets) {
+        trial_store_t store;
+        probe_comparison_t result;
+        result.probe_sets = sets;
+        auto start = std::chrono::steady_clock::now();
+        if (sets == 0) {
+            result.accuracy = do_pixel_attack(use_facade, &store);
+            free_frames();
+        } else {
+            result.accuracy = do_pixel_attack_probe(use_facade, sets, &store);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        threshold_eval_t eval = evaluate_thresholds(&store, 0);
+        result.auc = eval.auc;
+        result.best_threshold = eval.best_threshold;
+        result.best_accuracy = eval.best_accuracy;
+        out->push_back(result);
+    }
+}
+
+void print_probe_comparison(const std::vector<probe_comparison_t>& comparison) {
+    printf("Probed Sets\tAccuracy\tAUC\tBest Threshold\tBest Accuracy\tSeconds\n");
+    for (const probe_comparison_t& result : comparison) {
+        if (result.probe_sets == 0) {
+            printf("all (walk)");
+        } else {
+            printf("%" PRIu64, result.probe_sets);
+        }
+        printf("\t%.4f\t%.4f\t%.2f\t%.4f\t%.2f\n", result.accuracy, result.auc, result.best_threshold, result.best_accuracy, result.seconds);
+    }
+}
@@ -0,0 +1,37 @@
+//Prime+Probe measurement of the pixel attack, in place of walking the whole buffer.
+//The attacker picks probe_sets LLC sets spread over the cache (sim_pick_llc_sets) and takes, as each set's eviction
+//set, the buffer frame's lines that map to it. Each trial primes just those lines, lets the victim
+//render, then probes them in reverse. The probe time scaled by the fraction of sets probed is the
+//walk-time equivalent compared against the usual thresholds, so a trial costs the victim's render
+//plus time proportional to the sets probed.
+
+#ifndef PROBE_HPP
+#define PROBE_HPP
+
+#include "experiment.hpp"
+
+#include <vector>
+
+typedef struct {
+    uint64_t llc_sets;
+    std::vector<uint64_t> sets;
+    std::vector<std::vector<uint64_t>> eviction_sets;   //Buffer lines per probed set, in buffer order
+} probe_plan_t;
+
+typedef struct {
+    uint64_t probe_sets;    //0 for the full backwards walk
+    double accuracy;
+    double auc;
+    double best_threshold;
+    double best_accuracy;
+    double seconds;
+} probe_comparison_t;
+
+extern void build_probe_plan(frame_t* buffer, uint64_t probe_sets, probe_plan_t* plan);
+extern void probe_prime(const probe_plan_t* plan, sim_stats_t* stats);
+extern double probe_walk_time(const probe_plan_t* plan, sim_stats_t* stats);
+extern double do_pixel_attack_probe(bool use_facade, uint64_t probe_sets, trial_store_t* store=nullptr);
+extern void compare_probe_attack(bool use_facade, const std::vector<uint64_t>& probe_sets, std::vector<probe_comparison_t>* out);
+extern void print_probe_comparison(const std::vector<probe_comparison_t>& comparison);
+
+#endif
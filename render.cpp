@@ -0,0 +1,79 @@
+#include "render.hpp"
+
+//Allocates the pipeline's render targets and caches every layer's line lists, read in attack_order.render.
+void render_pipeline_init(render_pipeline_t* pipeline, frame_t* texture, bool use_facade) {
+    const access_order_t* order = get_access_order(attack_order.render, texture->nWindows, attack_order.seed);
+    pipeline->texture_reads.clear();
+    get_frame_read_lines(texture, use_facade, order, &pipeline->texture_reads);
+    for (size_t t = 0; t < 2; t++) {
+        pipeline->targets[t] = get_new_frame_copy(texture);
+        pipeline->target_reads[t].clear();
+        get_frame_read_lines(pipeline->targets[t], use_facade, order, &pipeline->target_reads[t]);
+        pipeline->target_writes[t].clear();
+        get_frame_lines(pipeline->targets[t], false, &pipeline->target_writes[t]);
+    }
+}
+
+//Renders num_layers layers and returns the time they took.
+double render_layers(const render_pipeline_t* pipeline, uint32_t num_layers, sim_stats_t* stats) {
+    double totalTime = 0.0;
+    for (uint32_t layer = 0; layer < num_layers; layer++) {
+        const std::vector<uint64_t>& reads = layer == 0 ? pipeline->texture_reads : pipeline->target_reads[(layer - 1) % 2];
+        for (uint64_t line : reads) {
+            totalTime += sim_access_line('R', line, stats);
+        }
+        for (uint64_t line : pipeline->target_writes[layer % 2]) {
+            totalTime += sim_access_line('W', line, stats);
+        }
+    }
+    return totalTime;
+}
+
+//The pixel attack with the attacker frame rendered through num_layers layers. Each trial is guessed
+//from the LLC walk as usual and recorded in walk_store; the render time, which the layers amplify, is
+//recorded in render_store so its separability can be compared.
+double do_pixel_attack_layers(bool use_facade, uint32_t num_layers, trial_store_t* walk_store, trial_store_t* render_store) {
+    attack_frames_t frames;
+    init_attack_frames(&frames);
+    uint16_t walk_config = walk_store != nullptr ? trial_store_add_config(walk_store, &cache_config, use_facade, facade_mode, &attack_order) : 0;
+    uint16_t render_config = render_store != nullptr ? trial_store_add_config(render_store, &cache_config, use_facade, facade_mode, &attack_order) : 0;
+
+    render_pipeline_t black, noise;
+    render_pipeline_init(&black, frames.black, use_facade);
+    render_pipeline_init(&noise, frames.noise, use_facade);
+    std::vector<uint64_t> fill, walk;
+    get_frame_lines(frames.buffer, false, &fill);
+    get_frame_lines_ordered(frames.buffer, get_access_order(attack_order.walk, frames.buffer->nWindows, attack_order.seed), &walk);
+
+    uint64_t correct_pixels = 0;
+    for (uint32_t pixel = 0; pixel < ATTACK_NUM_PIXELS; pixel++) {
+        const bool actual_white = frames.victim->windows[pixel / WINDOW_NUM_PIXELS].pixels[pixel % WINDOW_NUM_PIXELS][0] > 127;
+        sim_stats_t cache_stats;
+        init_stats(&cache_stats);
+
+        sim_setup(&cache_config);
+        for (uint64_t line : fill) {
+            sim_access_line('R', line, &cache_stats);
+        }
+        sim_set_phase(SIM_PHASE_ATTACK);
+        const double renderTime = render_layers(actual_white ? &noise : &black, num_layers, &cache_stats);
+        sim_set_phase(SIM_PHASE_WALK);
+        for (uint64_t line : walk) {
+            cache_stats.llc_walk_time += sim_access_line('R', line, &cache_stats);
+        }
+        sim_finish(&cache_stats);
+
+        if (walk_store != nullptr) {
+            trial_store_record(walk_store, walk_config, pixel, actual_white, cache_stats.llc_walk_time, cache_stats.num_evictions);
+        }
+        if (render_store != nullptr) {
+            trial_store_record(render_store, render_config, pixel, actual_white, renderTime, cache_stats.num_evictions);
+        }
+        if (guess_pixel_white(cache_stats.llc_walk_time, use_facade) == actual_white) {
+            correct_pixels++;
+        }
+    }
+
+    free_frames();
+    return (double) correct_pixels / ATTACK_NUM_PIXELS;
+}
@@ -0,0 +1,28 @@
+//Multi-layer rendering of the attacker frame.
+//The pixel-stealing attack stacks filter layers: layer 0 reads the texture and writes a render target,
+//and every later layer reads the previous render target and writes the other of a ping-pong pair. The
+//filters keep the pixels, so the render targets compress like the texture. Writes go through sim_access
+//as 'W', so under WRITE_STRAT_WBWA the render targets are dirty in the LLC and written back on eviction.
+//
+//Each window is compressed once when the pipeline is built; the layers then replay the cached line
+//lists, so the cost per layer is just the simulated accesses.
+
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include "experiment.hpp"
+
+#include <vector>
+
+typedef struct {
+    frame_t* targets[2];
+    std::vector<uint64_t> texture_reads;    //With the facade's lines when it is on
+    std::vector<uint64_t> target_reads[2];
+    std::vector<uint64_t> target_writes[2];
+} render_pipeline_t;
+
+extern void render_pipeline_init(render_pipeline_t* pipeline, frame_t* texture, bool use_facade);
+extern double render_layers(const render_pipeline_t* pipeline, uint32_t num_layers, sim_stats_t* stats);
+extern double do_pixel_attack_layers(bool use_facade, uint32_t num_layers, trial_store_t* walk_store=nullptr, trial_store_t* render_store=nullptr);
+
+#endif
@@ -0,0 +1,352 @@
+#include "results.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    template <typename T>
+    void put_value(std::vector<uint8_t>& buffer, T value) {
+        uint8_t bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    T get_value(const uint8_t* values, uint64_t i) {
+        T value;
+        memcpy(&value, values + i*sizeof(T), sizeof(T));
+        return value;
+    }
+
+    double get_typed(result_type_t type, const uint8_t* values, uint64_t i) {
+        switch (type) {
+            case RESULT_TYPE_U8: return get_value<uint8_t>(values, i);
+            case RESULT_TYPE_U16: return get_value<uint16_t>(values, i);
+            case RESULT_TYPE_U32: return get_value<uint32_t>(values, i);
+            case RESULT_TYPE_U64: return get_value<uint64_t>(values, i);
+            case RESULT_TYPE_F64: return get_value<double>(values, i);
+        }
+        return 0.0;
+    }
+
+    //As get_typed, but unsigned values stay integers.
+    result_value_t get_value_typed(result_type_t type, const uint8_t* values, uint64_t i) {
+        result_value_t value;
+        if (type == RESULT_TYPE_F64) {
+            value.f = get_value<double>(values, i);
+        } else if (type == RESULT_TYPE_U64) {
+            value.u = get_value<uint64_t>(values, i);
+        } else {
+            value.u = (uint64_t) get_typed(type, values, i);
+        }
+        return value;
+    }
+
+    //Calls fn(chunkValues, firstInChunk, countInChunk, rowsBefore) for each chunk overlapping the row range.
+    template <typename Fn>
+    void for_each_chunk(const results_reader_t* reader, uint32_t column, uint64_t first_row, uint64_t count, Fn fn) {
+        const uint64_t end = std::min(reader->num_rows, first_row + count);
+        for (const results_reader_chunk_t& chunk : reader->chunks) {
+            const uint64_t chunkEnd = chunk.first_row + chunk.rows;
+            if (chunkEnd <= first_row || chunk.first_row >= end) {
+                continue;
+            }
+            const uint64_t from = std::max(first_row, chunk.first_row);
+            const uint64_t to = std::min(end, chunkEnd);
+            const uint8_t* values = chunk.base + chunk.rows*reader->column_offsets[column];
+            fn(values, from - chunk.first_row, to - from, from - first_row);
+        }
+    }
+
+    void add_chunk(results_reader_t* reader, uint64_t offset, uint64_t rows) {
+        results_reader_chunk_t chunk = {reader->map + offset, reader->num_rows, rows};
+        reader->chunks.push_back(chunk);
+        reader->num_rows += rows;
+    }
+
+    //Finds the chunks of a file with no footer from their headers, stopping at the first one that is
+    //missing or cut short.
+    void scan_chunks(results_reader_t* reader, uint64_t offset, uint64_t rowSize) {
+        results_chunk_header_t chunkHeader;
+        while (rowSize != 0 && offset + sizeof(chunkHeader) <= reader->size) {
+            memcpy(&chunkHeader, reader->map + offset, sizeof(chunkHeader));
+            offset += sizeof(chunkHeader);
+            if (memcmp(chunkHeader.magic, RESULTS_CHUNK_MAGIC, sizeof(chunkHeader.magic)) != 0 || chunkHeader.rows == 0 ||
+                    chunkHeader.rows > (reader->size - offset) / rowSize) {
+                return;
+            }
+            add_chunk(reader, offset, chunkHeader.rows);
+            offset += chunkHeader.rows*rowSize;
+        }
+    }
+}
+
+size_t result_type_size(result_type_t type) {
+    switch (type) {
+        case RESULT_TYPE_U8: return 1;
+        case RESULT_TYPE_U16: return 2;
+        case RESULT_TYPE_U32: return 4;
+        case RESULT_TYPE_U64: return 8;
+        case RESULT_TYPE_F64: return 8;
+    }
+    return 0;
+}
+
+bool results_open_write(results_writer_t* writer, const char* path, const result_column_t* columns, 
+        uint32_t num_columns, uint64_t chunk_rows) {
+    writer->file = fopen(path, "wb");
+    if (writer->file == nullptr) {
+        return false;
+    }
+
+    writer->columns.assign(num_columns, results_column_desc_t());
+    writer->buffers.assign(num_columns, std::vector<uint8_t>());
+    writer->chunks.clear();
+    writer->chunk_rows = chunk_rows;
+    writer->pending_rows = 0;
+    for (uint32_t c = 0; c < num_columns; c++) {
+        memset(&writer->columns[c], 0, sizeof(results_column_desc_t));
+        strncpy(writer->columns[c].name, columns[c].name, RESULTS_NAME_LEN - 1);
+        writer->columns[c].type = columns[c].type;
+        writer->buffers[c].reserve(chunk_rows * result_type_size(columns[c].type));
+    }
+
+    results_header_t header;
+    memcpy(header.magic, RESULTS_MAGIC, sizeof(header.magic));
+    header.version = RESULTS_VERSION;
+    header.num_columns = num_columns;
+    bool ok = fwrite(&header, sizeof(header), 1, writer->file) == 1 &&
+        fwrite(writer->columns.data(), sizeof(results_column_desc_t), num_columns, writer->file) == num_columns;
+    writer->offset = sizeof(header) + num_columns*sizeof(results_column_desc_t);
+    return ok;
+}
+
+void results_append(results_writer_t* writer, const result_value_t* row) {
+    for (size_t c = 0; c < writer->columns.size(); c++) {
+        std::vector<uint8_t>& buffer = writer->buffers[c];
+        switch ((result_type_t) writer->columns[c].type) {
+            case RESULT_TYPE_U8: put_value<uint8_t>(buffer, row[c].u); break;
+            case RESULT_TYPE_U16: put_value<uint16_t>(buffer, row[c].u); break;
+            case RESULT_TYPE_U32: put_value<uint32_t>(buffer, row[c].u); break;
+            case RESULT_TYPE_U64: put_value<uint64_t>(buffer, row[c].u); break;
+            case RESULT_TYPE_F64: put_value<double>(buffer, row[c].f); break;
+        }
+    }
+
+    writer->pending_rows++;
+    if (writer->pending_rows == writer->chunk_rows) {
+        results_flush(writer);
+    }
+}
+
+//Writes the pending rows as one chunk and pushes it to the OS.
+bool results_flush(results_writer_t* writer) {
+    if (writer->pending_rows == 0) {
+        return true;
+    }
+
+    results_chunk_header_t chunkHeader;
+    memcpy(chunkHeader.magic, RESULTS_CHUNK_MAGIC, sizeof(chunkHeader.magic));
+    chunkHeader.rows = writer->pending_rows;
+    bool ok = fwrite(&chunkHeader, sizeof(chunkHeader), 1, writer->file) == 1;
+    writer->offset += sizeof(chunkHeader);
+
+    results_chunk_t chunk = {writer->offset, writer->pending_rows};
+    for (std::vector<uint8_t>& buffer : writer->buffers) {
+        ok = ok && fwrite(buffer.data(), 1, buffer.size(), writer->file) == buffer.size();
+        writer->offset += buffer.size();
+        buffer.clear();
+    }
+    writer->chunks.push_back(chunk);
+    writer->pending_rows = 0;
+    return fflush(writer->file) == 0 && ok;
+}
+
+bool results_close_write(results_writer_t* writer) {
+    bool ok = results_flush(writer);
+
+    results_trailer_t trailer;
+    trailer.num_chunks = writer->chunks.size();
+    trailer.num_rows = 0;
+    for (const results_chunk_t& chunk : writer->chunks) {
+        trailer.num_rows += chunk.rows;
+    }
+    trailer.index_offset = writer->offset;
+    memcpy(trailer.magic, RESULTS_TRAILER_MAGIC, sizeof(trailer.magic));
+
+    ok = ok && fwrite(writer->chunks.data(), sizeof(results_chunk_t), writer->chunks.size(), writer->file) == writer->chunks.size() &&
+        fwrite(&trailer, sizeof(trailer), 1, writer->file) == 1;
+    ok = fclose(writer->file) == 0 && ok;
+    writer->file = nullptr;
+    return ok;
+}
+
+//Opens a results file for reading. A file its writer did not close (a crashed or killed sweep) opens
+//with the rows of every chunk that was flushed in full, and closed set to false.
+bool results_open_read(results_reader_t* reader, const char* path) {
+    reader->map = nullptr;
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(reader->fd, &st) != 0 || (size_t) st.st_size < sizeof(results_header_t)) {
+        results_close_read(reader);
+        return false;
+    }
+    reader->size = st.st_size;
+    void* map = mmap(nullptr, reader->size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+    if (map == MAP_FAILED) {
+        results_close_read(reader);
+        return false;
+    }
+    reader->map = (const uint8_t*) map;
+
+    results_header_t header;
+    memcpy(&header, reader->map, sizeof(header));
+    const uint64_t columnsEnd = sizeof(header) + (uint64_t) header.num_columns*sizeof(results_column_desc_t);
+    if (memcmp(header.magic, RESULTS_MAGIC, sizeof(header.magic)) != 0 || header.version != RESULTS_VERSION ||
+            columnsEnd > reader->size) {
+        results_close_read(reader);
+        return false;
+    }
+
+    reader->columns.resize(header.num_columns);
+    memcpy(reader->columns.data(), reader->map + sizeof(header), header.num_columns*sizeof(results_column_desc_t));
+    reader->column_offsets.resize(header.num_columns);
+    uint64_t rowSize = 0;
+    for (uint32_t c = 0; c < header.num_columns; c++) {
+        if (reader->columns[c].type > RESULT_TYPE_F64) {
+            results_close_read(reader);
+            return false;
+        }
+        reader->column_offsets[c] = rowSize;
+        rowSize += result_type_size((result_type_t) reader->columns[c].type);
+    }
+
+    results_trailer_t trailer;
+    reader->closed = reader->size >= columnsEnd + sizeof(trailer);
+    if (reader->closed) {
+        memcpy(&trailer, reader->map + reader->size - sizeof(trailer), sizeof(trailer));
+        const uint64_t indexEnd = reader->size - sizeof(trailer);
+        reader->closed = memcmp(trailer.magic, RESULTS_TRAILER_MAGIC, sizeof(trailer.magic)) == 0 &&
+            trailer.index_offset >= columnsEnd && trailer.index_offset <= indexEnd &&
+            (indexEnd - trailer.index_offset) % sizeof(results_chunk_t) == 0 &&
+            trailer.num_chunks == (indexEnd - trailer.index_offset) / sizeof(results_chunk_t);
+    }
+
+    reader->chunks.clear();
+    reader->num_rows = 0;
+    if (!reader->closed) {
+        scan_chunks(reader, columnsEnd, rowSize);
+        return true;
+    }
+    for (uint64_t i = 0; i < trailer.num_chunks; i++) {
+        results_chunk_t chunk;
+        memcpy(&chunk, reader->map + trailer.index_offset + i*sizeof(chunk), sizeof(chunk));
+        if (chunk.offset < columnsEnd || chunk.offset > trailer.index_offset || 
+                (rowSize != 0 && chunk.rows > (trailer.index_offset - chunk.offset) / rowSize)) {
+            results_close_read(reader);
+            return false;
+        }
+        add_chunk(reader, chunk.offset, chunk.rows);
+    }
+    return true;
+}
+
+void results_close_read(results_reader_t* reader) {
+    if (reader->map != nullptr) {
+        munmap((void*) reader->map, reader->size);
+        reader->map = nullptr;
+    }
+    if (reader->fd >= 0) {
+        close(reader->fd);
+        reader->fd = -1;
+    }
+}
+
+int results_find_column(const results_reader_t* reader, const char* name) {
+    for (size_t c = 0; c < reader->columns.size(); c++) {
+        if (strncmp(reader->columns[c].name, name, RESULTS_NAME_LEN) == 0) {
+            return (int) c;
+        }
+    }
+    return -1;
+}
+
+//Copies rows [first_row, first_row + count) of a column into out, returns the number of rows copied.
+uint64_t results_read_column(const results_reader_t* reader, uint32_t column, uint64_t first_row, 
+        uint64_t count, double* out) {
+    const result_type_t type = (result_type_t) reader->columns[column].type;
+    uint64_t copied = 0;
+    for_each_chunk(reader, column, first_row, count, [&](const uint8_t* values, uint64_t from, uint64_t n, uint64_t dst) {
+        for (uint64_t i = 0; i < n; i++) {
+            out[dst + i] = get_typed(type, values, from + i);
+        }
+        copied += n;
+    });
+    return copied;
+}
+
+//As results_read_column, but unsigned columns are read into u and F64 columns into f, so U64 values
+//wider than a double's mantissa are kept exactly.
+uint64_t results_read_values(const results_reader_t* reader, uint32_t column, uint64_t first_row, 
+        uint64_t count, result_value_t* out) {
+    const result_type_t type = (result_type_t) reader->columns[column].type;
+    uint64_t copied = 0;
+    for_each_chunk(reader, column, first_row, count, [&](const uint8_t* values, uint64_t from, uint64_t n, uint64_t dst) {
+        for (uint64_t i = 0; i < n; i++) {
+            out[dst + i] = get_value_typed(type, values, from + i);
+        }
+        copied += n;
+    });
+    return copied;
+}
+
+result_agg_t results_aggregate(const results_reader_t* reader, uint32_t column, uint64_t first_row, uint64_t count) {
+    const result_type_t type = (result_type_t) reader->columns[column].type;
+    result_agg_t agg = {0, 0.0, 0.0, 0.0, 0.0};
+    for_each_chunk(reader, column, first_row, count, [&](const uint8_t* values, uint64_t from, uint64_t n, uint64_t) {
+        for (uint64_t i = from; i < from + n; i++) {
+            double value = get_typed(type, values, i);
+            agg.min = agg.count == 0 ? value : std::min(agg.min, value);
+            agg.max = agg.count == 0 ? value : std::max(agg.max, value);
+            agg.sum += value;
+            agg.count++;
+        }
+    });
+    agg.mean = agg.count == 0 ? 0.0 : agg.sum / agg.count;
+    return agg;
+}
+
+void results_export_csv(const results_reader_t* reader, FILE* out, const std::vector<uint32_t>& columns, 
+        uint64_t first_row, uint64_t count) {
+    for (size_t i = 0; i < columns.size(); i++) {
+        fprintf(out, "%s%s", i == 0 ? "" : ",", reader->columns[columns[i]].name);
+    }
+    fprintf(out, "\n");
+
+    const uint64_t end = std::min(reader->num_rows, first_row + count);
+    for (const results_reader_chunk_t& chunk : reader->chunks) {
+        const uint64_t from = std::max(first_row, chunk.first_row);
+        const uint64_t to = std::min(end, chunk.first_row + chunk.rows);
+        for (uint64_t row = from; row < to; row++) {
+            for (size_t i = 0; i < columns.size(); i++) {
+                const uint32_t c = columns[i];
+                const result_type_t type = (result_type_t) reader->columns[c].type;
+                const uint8_t* values = chunk.base + chunk.rows*reader->column_offsets[c];
+                if (type == RESULT_TYPE_F64) {
+                    fprintf(out, "%s%.17g", i == 0 ? "" : ",", get_typed(type, values, row - chunk.first_row));
+                } else {
+                    fprintf(out, "%s%" PRIu64, i == 0 ? "" : ",", get_value_typed(type, values, row - chunk.first_row).u);
+                }
+            }
+            fprintf(out, "\n");
+        }
+    }
+}
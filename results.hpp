@@ -0,0 +1,127 @@
+//Append-only columnar results files.
+//Rows are buffered per column and written out a chunk at a time, so a long sweep is on disk as it runs.
+//A chunk holds each column's values contiguously at a fixed width after a header giving its row count;
+//the footer indexes the chunks. The reader maps the file and slices or aggregates a column straight
+//from the mapping. A file whose writer never closed it has no footer, so the reader finds its chunks
+//by walking the chunk headers instead, up to the first incomplete chunk.
+//
+//Layout: results_header_t, num_columns * results_column_desc_t,
+//        chunks (results_chunk_header_t, then each column's values),
+//        num_chunks * results_chunk_t, results_trailer_t
+
+#ifndef RESULTS_HPP
+#define RESULTS_HPP
+
+#include <cstdio>
+#include <inttypes.h>
+#include <vector>
+
+#define RESULTS_MAGIC "SIMRES01"
+#define RESULTS_TRAILER_MAGIC "SIMRESFT"
+#define RESULTS_CHUNK_MAGIC "SIMRESCH"
+#define RESULTS_VERSION 2
+#define RESULTS_CHUNK_ROWS 4096
+#define RESULTS_NAME_LEN 23
+
+typedef enum result_type {
+    RESULT_TYPE_U8,
+    RESULT_TYPE_U16,
+    RESULT_TYPE_U32,
+    RESULT_TYPE_U64,
+    RESULT_TYPE_F64,
+} result_type_t;
+
+typedef struct {
+    const char* name;
+    result_type_t type;
+} result_column_t;
+
+//One cell of a row; unsigned columns take u, F64 columns take f.
+typedef union {
+    uint64_t u;
+    double f;
+} result_value_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_columns;
+} results_header_t;
+
+typedef struct {
+    char name[RESULTS_NAME_LEN];
+    uint8_t type;
+} results_column_desc_t;
+
+typedef struct {
+    char magic[8];
+    uint64_t rows;
+} results_chunk_header_t;
+
+typedef struct {
+    uint64_t offset;    //File offset of the chunk's first column
+    uint64_t rows;
+} results_chunk_t;
+
+typedef struct {
+    uint64_t num_chunks;
+    uint64_t num_rows;
+    uint64_t index_offset;
+    char magic[8];
+} results_trailer_t;
+
+typedef struct {
+    uint64_t count;
+    double sum;
+    double min;
+    double max;
+    double mean;
+} result_agg_t;
+
+typedef struct {
+    FILE* file;
+    std::vector<results_column_desc_t> columns;
+    std::vector<std::vector<uint8_t>> buffers;  //Pending rows, per column
+    std::vector<results_chunk_t> chunks;
+    uint64_t chunk_rows;
+    uint64_t pending_rows;
+    uint64_t offset;
+} results_writer_t;
+
+typedef struct {
+    const uint8_t* base;
+    uint64_t first_row;
+    uint64_t rows;
+} results_reader_chunk_t;
+
+typedef struct {
+    int fd;
+    const uint8_t* map;
+    size_t size;
+    uint64_t num_rows;
+    bool closed;                            //False if the chunks were found without a footer
+    std::vector<results_column_desc_t> columns;
+    std::vector<uint64_t> column_offsets;   //Bytes per row before each column
+    std::vector<results_reader_chunk_t> chunks;
+} results_reader_t;
+
+extern size_t result_type_size(result_type_t type);
+
+extern bool results_open_write(results_writer_t* writer, const char* path, const result_column_t* columns, 
+    uint32_t num_columns, uint64_t chunk_rows=RESULTS_CHUNK_ROWS);
+extern void results_append(results_writer_t* writer, const result_value_t* row);
+extern bool results_flush(results_writer_t* writer);
+extern bool results_close_write(results_writer_t* writer);
+
+extern bool results_open_read(results_reader_t* reader, const char* path);
+extern void results_close_read(results_reader_t* reader);
+extern int results_find_column(const results_reader_t* reader, const char* name);
+extern uint64_t results_read_column(const results_reader_t* reader, uint32_t column, uint64_t first_row, 
+    uint64_t count, double* out);
+extern uint64_t results_read_values(const results_reader_t* reader, uint32_t column, uint64_t first_row, 
+    uint64_t count, result_value_t* out);
+extern result_agg_t results_aggregate(const results_reader_t* reader, uint32_t column, uint64_t first_row, uint64_t count);
+extern void results_export_csv(const results_reader_t* reader, FILE* out, const std::vector<uint32_t>& columns, 
+    uint64_t first_row, uint64_t count);
+
+#endif
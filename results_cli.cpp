@@ -0,0 +1,109 @@
+//Slices and aggregates columns of a results file without loading it.
+//
+//Usage: compress_results <file> [--columns a,b,...] [--rows first:end] [--csv]
+//Without --csv, prints count/min/max/mean/sum of each selected column over the selected rows.
+
+//Stdlib Things
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//My Things
+#include "results.hpp"
+
+static const char* type_to_str[] = {
+    "u8", "u16", "u32", "u64", "f64"
+};
+
+static void usage() {
+    fprintf(stderr, "Usage: compress_results <file> [--columns a,b,...] [--rows first:end] [--csv]\n");
+    fprintf(stderr, "  --columns  Comma-separated column names (default: all)\n");
+    fprintf(stderr, "  --rows     Half-open row range, either bound may be empty (default: all)\n");
+    fprintf(stderr, "  --csv      Export the selection as CSV instead of aggregating it\n");
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    const char* column_list = nullptr;
+    uint64_t first_row = 0;
+    uint64_t end_row = UINT64_MAX;
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--columns") == 0 && i + 1 < argc) {
+            column_list = argv[++i];
+        } else if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+            const char* range = argv[++i];
+            const char* colon = strchr(range, ':');
+            if (colon == nullptr) {
+                usage();
+                return 1;
+            }
+            first_row = strtoull(range, nullptr, 10);
+            if (colon[1] != '\0') {
+                end_row = strtoull(colon + 1, nullptr, 10);
+            }
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (argv[i][0] != '-' && path == nullptr) {
+            path = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (path == nullptr || end_row < first_row) {
+        usage();
+        return 1;
+    }
+
+    results_reader_t reader;
+    if (!results_open_read(&reader, path)) {
+        fprintf(stderr, "Could not read %s\n", path);
+        return 1;
+    }
+    if (!reader.closed) {
+        fprintf(stderr, "%s was not closed; reading the %" PRIu64 " rows of its complete chunks\n", path, reader.num_rows);
+    }
+
+    std::vector<uint32_t> columns;
+    if (column_list == nullptr) {
+        for (uint32_t c = 0; c < reader.columns.size(); c++) {
+            columns.push_back(c);
+        }
+    } else {
+        std::string list(column_list);
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t comma = list.find(',', start);
+            std::string name = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+            int c = results_find_column(&reader, name.c_str());
+            if (c < 0) {
+                fprintf(stderr, "No column %s\n", name.c_str());
+                results_close_read(&reader);
+                return 1;
+            }
+            columns.push_back(c);
+            if (comma == std::string::npos) {
+                break;
+            }
+            start = comma + 1;
+        }
+    }
+
+    const uint64_t count = end_row - first_row;
+    if (csv) {
+        results_export_csv(&reader, stdout, columns, first_row, count);
+    } else {
+        printf("%" PRIu64 " rows, %zu chunks\n", reader.num_rows, reader.chunks.size());
+        printf("Column\tType\tCount\tMin\tMax\tMean\tSum\n");
+        for (uint32_t c : columns) {
+            result_agg_t agg = results_aggregate(&reader, c, first_row, count);
+            printf("%s\t%s\t%" PRIu64 "\t%.3f\t%.3f\t%.3f\t%.3f\n", reader.columns[c].name, type_to_str[reader.columns[c].type], 
+                agg.count, agg.min, agg.max, agg.mean, agg.sum);
+        }
+    }
+
+    results_close_read(&reader);
+}
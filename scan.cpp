@@ -0,0 +1,297 @@
+#include "scan.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+//Block rows per work item, so one large image is still split across threads.
+#define SCAN_ITEM_BLOCK_ROWS 64
+
+#define SCAN_ROW_BYTES ((WINDOW_ROW_SIZE) * (NUM_CHANNELS))
+
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+
+//compress()'s l[c] for each max-min difference: ceil(log2(diff)), except that a diff of 1 gives 0.
+static const struct bits_table_t {
+    uint8_t bits[256];
+    bits_table_t() {
+        for (uint32_t diff = 0; diff < 256; diff++) {
+            bits[diff] = diff <= 1 ? 0 : 32 - __builtin_clz(diff - 1);
+        }
+    }
+} bits_table;
+
+//Shuffles that swap the halves, and the quarters, of a vector
+static const v16u8 swap_halves = {8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7};
+static const v16u8 swap_quarters = {4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3};
+
+namespace {
+    inline v16u8 load16(const uint8_t* p) {
+        v16u8 v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    //Folds the 4 RGBA pixels in a vector so lane c holds the min (or max) of channel c.
+    inline v16u8 fold_min(v16u8 v) {
+        v16u8 swapped = __builtin_shuffle(v, swap_halves);
+        v = v < swapped ? v : swapped;
+        v16u8 high = __builtin_shuffle(v, swap_quarters);
+        return v < high ? v : high;
+    }
+
+    inline v16u8 fold_max(v16u8 v) {
+        v16u8 swapped = __builtin_shuffle(v, swap_halves);
+        v = v > swapped ? v : swapped;
+        v16u8 high = __builtin_shuffle(v, swap_quarters);
+        return v > high ? v : high;
+    }
+
+    //Scans one block of RGBA pixels whose rows are stride bytes apart.
+    inline void scan_block(const uint8_t* block, uint64_t stride, scan_hist_t* hist) {
+        v16u8 lo = load16(block);
+        v16u8 hi = lo;
+        for (size_t r = 0; r < WINDOW_NUM_ROWS; r++) {
+            for (size_t half = 0; half < SCAN_ROW_BYTES; half += 16) {
+                v16u8 v = load16(block + r*stride + half);
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+            }
+        }
+        const v16u8 diff = fold_max(hi) - fold_min(lo);
+
+        uint32_t total = 0;
+        for (size_t c = 0; c < NUM_CHANNELS; c++) {
+            const uint8_t l = bits_table.bits[diff[c]];
+            hist->num_bits[c][l]++;
+            hist->skip[c] += l == 0;
+            total += l;
+        }
+        hist->total_bits[total]++;
+        hist->compressible += total <= COMPRESS_THRESHOLD;
+        hist->windows++;
+    }
+
+    bool parse_ppm_header(const uint8_t* data, uint64_t size, uint64_t* width, uint64_t* height, uint64_t* offset) {
+        uint64_t pos = 2;
+        uint64_t fields[3];
+        for (size_t f = 0; f < 3; f++) {
+            while (pos < size && (isspace(data[pos]) || data[pos] == '#')) {
+                if (data[pos] == '#') {
+                    while (pos < size && data[pos] != '\n') {
+                        pos++;
+                    }
+                } else {
+                    pos++;
+                }
+            }
+            if (pos >= size || !isdigit(data[pos])) {
+                return false;
+            }
+            fields[f] = 0;
+            while (pos < size && isdigit(data[pos])) {
+                fields[f] = fields[f]*10 + (data[pos++] - '0');
+            }
+        }
+        //Exactly one whitespace byte separates the header from the pixels
+        *width = fields[0];
+        *height = fields[1];
+        *offset = pos + 1;
+        return fields[2] == 255 && *offset + *width * *height * 3 <= size;
+    }
+}
+
+void scan_hist_clear(scan_hist_t* hist) {
+    memset(hist, 0, sizeof(*hist));
+}
+
+void scan_hist_merge(scan_hist_t* into, const scan_hist_t* from) {
+    into->windows += from->windows;
+    into->compressible += from->compressible;
+    for (size_t c = 0; c < NUM_CHANNELS; c++) {
+        into->skip[c] += from->skip[c];
+        for (size_t l = 0; l <= SCAN_MAX_BITS; l++) {
+            into->num_bits[c][l] += from->num_bits[c][l];
+        }
+    }
+    for (size_t t = 0; t <= SCAN_MAX_TOTAL_BITS; t++) {
+        into->total_bits[t] += from->total_bits[t];
+    }
+}
+
+//Tallies a single window, with the same rows-of-WINDOW_ROW_SIZE layout the frames use.
+void scan_window(const pixel_window_t* window, scan_hist_t* hist) {
+    scan_block(&window->pixels[0][0], SCAN_ROW_BYTES, hist);
+}
+
+//Tallies the blocks in block rows [first_block_row, end_block_row) of an image.
+void scan_rows(const scan_image_t* image, uint64_t first_block_row, uint64_t end_block_row, scan_hist_t* hist) {
+    const uint64_t blocks_per_row = image->width / WINDOW_ROW_SIZE;
+    //RGB rows are widened to RGBA a block row at a time
+    static thread_local std::vector<uint8_t> widened;
+    if (image->channels == 3) {
+        widened.resize(image->width * NUM_CHANNELS * WINDOW_NUM_ROWS);
+    }
+
+    for (uint64_t br = first_block_row; br < end_block_row; br++) {
+        const uint8_t* rows = image->data + br * WINDOW_NUM_ROWS * image->stride;
+        uint64_t stride = image->stride;
+        if (image->channels == 3) {
+            stride = image->width * NUM_CHANNELS;
+            for (uint64_t r = 0; r < WINDOW_NUM_ROWS; r++) {
+                const uint8_t* in = rows + r * image->stride;
+                uint8_t* out = widened.data() + r * stride;
+                for (uint64_t x = 0; x < image->width; x++) {
+                    out[4*x] = in[3*x];
+                    out[4*x + 1] = in[3*x + 1];
+                    out[4*x + 2] = in[3*x + 2];
+                    out[4*x + 3] = 255;
+                }
+            }
+            rows = widened.data();
+        }
+        for (uint64_t b = 0; b < blocks_per_row; b++) {
+            scan_block(rows + b * SCAN_ROW_BYTES, stride, hist);
+        }
+    }
+}
+
+//Maps a binary PPM (P6, maxval 255), or a raw RGBA file raw_width pixels wide. Raw files are only
+//accepted when raw_width is given.
+bool scan_open_image(const char* path, uint64_t raw_width, scan_image_t* outImage) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 2) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    const uint8_t* data = (const uint8_t*) map;
+    uint64_t offset = 0;
+    outImage->path = path;
+    outImage->map = data;
+    outImage->map_size = st.st_size;
+    scan_hist_clear(&outImage->hist);
+    bool ok;
+    if (data[0] == 'P' && data[1] == '6') {
+        ok = parse_ppm_header(data, st.st_size, &outImage->width, &outImage->height, &offset);
+        outImage->channels = 3;
+    } else {
+        ok = raw_width > 0;
+        outImage->width = raw_width;
+        outImage->height = ok ? st.st_size / (raw_width * NUM_CHANNELS) : 0;
+        outImage->channels = NUM_CHANNELS;
+    }
+    if (!ok) {
+        munmap(map, st.st_size);
+        return false;
+    }
+    outImage->data = data + offset;
+    outImage->stride = outImage->width * outImage->channels;
+    return true;
+}
+
+void scan_close_image(scan_image_t* image) {
+    munmap((void*) image->map, image->map_size);
+    image->map = nullptr;
+    image->data = nullptr;
+}
+
+//Collects the .ppm and .rgba files under path, recursing into directories, in sorted order. A path
+//that is a file is taken whatever its extension.
+void scan_find_images(const char* path, std::vector<std::string>* outPaths) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        outPaths->push_back(path);
+        return;
+    }
+
+    DIR* dir = opendir(path);
+    if (dir == nullptr) {
+        return;
+    }
+    std::vector<std::string> entries;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            entries.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+
+    for (const std::string& name : entries) {
+        const std::string child = std::string(path) + "/" + name;
+        if (stat(child.c_str(), &st) != 0) {
+            continue;
+        }
+        const size_t dot = name.rfind('.');
+        const std::string ext = dot == std::string::npos ? "" : name.substr(dot);
+        if (S_ISDIR(st.st_mode)) {
+            scan_find_images(child.c_str(), outPaths);
+        } else if (ext == ".ppm" || ext == ".rgba") {
+            outPaths->push_back(child);
+        }
+    }
+}
+
+//Fills in every image's hist. Images are split into runs of block rows which num_threads threads take
+//in turn; each run is tallied separately and merged in order afterwards.
+void scan_images(std::vector<scan_image_t>* images, uint32_t num_threads) {
+    typedef struct {
+        uint64_t image;
+        uint64_t first_block_row;
+        uint64_t end_block_row;
+        scan_hist_t hist;
+    } scan_item_t;
+
+    std::vector<scan_item_t> items;
+    for (uint64_t i = 0; i < images->size(); i++) {
+        const uint64_t block_rows = (*images)[i].height / WINDOW_NUM_ROWS;
+        for (uint64_t br = 0; br < block_rows; br += SCAN_ITEM_BLOCK_ROWS) {
+            items.push_back({i, br, std::min<uint64_t>(br + SCAN_ITEM_BLOCK_ROWS, block_rows), {}});
+        }
+    }
+
+    std::atomic<uint64_t> next_item(0);
+    auto worker = [&]() {
+        for (uint64_t n = next_item++; n < items.size(); n = next_item++) {
+            scan_item_t& item = items[n];
+            scan_hist_clear(&item.hist);
+            scan_rows(&(*images)[item.image], item.first_block_row, item.end_block_row, &item.hist);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t t = 1; t < num_threads; t++) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (scan_image_t& image : *images) {
+        scan_hist_clear(&image.hist);
+    }
+    for (const scan_item_t& item : items) {
+        scan_hist_merge(&(*images)[item.image].hist, &item.hist);
+    }
+}
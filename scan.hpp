@@ -0,0 +1,47 @@
+//Scans image corpora for how often their windows compress under compress().
+//Images are tiled into pixel_window_t-shaped blocks (WINDOW_ROW_SIZE x WINDOW_NUM_ROWS pixels) and each
+//block goes through a vectorized kernel that computes the same numBits/skip/did_compression as
+//compress(). Blocks that would run past the right or bottom edge of an image are not scanned.
+
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include "compress_alg.hpp"
+
+#include <string>
+#include <vector>
+
+#define SCAN_MAX_BITS 8
+#define SCAN_MAX_TOTAL_BITS ((SCAN_MAX_BITS) * (NUM_CHANNELS))
+
+typedef struct {
+    uint64_t windows;
+    uint64_t compressible;
+    uint64_t skip[NUM_CHANNELS];
+    uint64_t num_bits[NUM_CHANNELS][SCAN_MAX_BITS + 1];
+    uint64_t total_bits[SCAN_MAX_TOTAL_BITS + 1];   //Sum of numBits over the channels
+} scan_hist_t;
+
+//An image mapped for scanning. Pixels are RGBA, or RGB with an opaque alpha channel.
+typedef struct {
+    std::string path;
+    const uint8_t* map;
+    const uint8_t* data;
+    uint64_t map_size;
+    uint64_t width;
+    uint64_t height;
+    uint64_t channels;  //3 or 4
+    uint64_t stride;    //Bytes per row
+    scan_hist_t hist;
+} scan_image_t;
+
+extern void scan_hist_clear(scan_hist_t* hist);
+extern void scan_hist_merge(scan_hist_t* into, const scan_hist_t* from);
+extern void scan_window(const pixel_window_t* window, scan_hist_t* hist);
+extern void scan_rows(const scan_image_t* image, uint64_t first_block_row, uint64_t end_block_row, scan_hist_t* hist);
+extern bool scan_open_image(const char* path, uint64_t raw_width, scan_image_t* outImage);
+extern void scan_close_image(scan_image_t* image);
+extern void scan_find_images(const char* path, std::vector<std::string>* outPaths);
+extern void scan_images(std::vector<scan_image_t>* images, uint32_t num_threads);
+
+#endif
@@ -0,0 +1,170 @@
+//Scans images for how often their windows compress under compress().
+//
+//Usage: compress_scan <path>... [--raw-width W] [--threads T] [--per-image] [--out <file>]
+//Directories are searched recursively for .ppm (P6) and .rgba (raw, W pixels wide) files.
+
+//Stdlib Things
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+//My Things
+#include "results.hpp"
+#include "scan.hpp"
+
+static const char* channel_names[NUM_CHANNELS] = {"r", "g", "b", "a"};
+
+static void usage() {
+    fprintf(stderr, "Usage: compress_scan <path>... [--raw-width W] [--threads T] [--per-image] [--out <file>]\n");
+    fprintf(stderr, "  --raw-width  Width in pixels of .rgba files (required to scan them)\n");
+    fprintf(stderr, "  --threads    Scanning threads (default: one per CPU)\n");
+    fprintf(stderr, "  --per-image  Print a line per image before the totals\n");
+    fprintf(stderr, "  --out        Write a results file with a row per image\n");
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole == 0 ? 0.0 : 100.0 * part / whole;
+}
+
+static void print_hist(const scan_hist_t* hist) {
+    printf("windows\t%" PRIu64 "\n", hist->windows);
+    printf("compressible\t%" PRIu64 "\t%.2f%%\n", hist->compressible, percent(hist->compressible, hist->windows));
+    for (size_t c = 0; c < NUM_CHANNELS; c++) {
+        printf("skip_%s\t%" PRIu64 "\t%.2f%%\n", channel_names[c], hist->skip[c], percent(hist->skip[c], hist->windows));
+    }
+
+    printf("\nnumBits");
+    for (size_t c = 0; c < NUM_CHANNELS; c++) {
+        printf("\t%s", channel_names[c]);
+    }
+    printf("\n");
+    for (size_t l = 0; l <= SCAN_MAX_BITS; l++) {
+        printf("%zu", l);
+        for (size_t c = 0; c < NUM_CHANNELS; c++) {
+            printf("\t%.2f%%", percent(hist->num_bits[c][l], hist->windows));
+        }
+        printf("\n");
+    }
+
+    printf("\ntotal_bits\twindows\n");
+    for (size_t t = 0; t <= SCAN_MAX_TOTAL_BITS; t++) {
+        if (hist->total_bits[t] != 0) {
+            printf("%zu%s\t%.2f%%\n", t, t <= COMPRESS_THRESHOLD ? "*" : "", percent(hist->total_bits[t], hist->windows));
+        }
+    }
+}
+
+static bool write_results(const std::vector<scan_image_t>& images, const char* path) {
+    std::vector<result_column_t> columns = {
+        {"width", RESULT_TYPE_U32},
+        {"height", RESULT_TYPE_U32},
+        {"windows", RESULT_TYPE_U64},
+        {"compressible", RESULT_TYPE_U64},
+    };
+    std::vector<std::string> names;
+    for (size_t c = 0; c < NUM_CHANNELS; c++) {
+        names.push_back(std::string("skip_") + channel_names[c]);
+    }
+    for (size_t t = 0; t <= SCAN_MAX_TOTAL_BITS; t++) {
+        names.push_back("total_bits_" + std::to_string(t));
+    }
+    for (const std::string& name : names) {
+        columns.push_back({name.c_str(), RESULT_TYPE_U64});
+    }
+
+    results_writer_t writer;
+    if (!results_open_write(&writer, path, columns.data(), columns.size())) {
+        return false;
+    }
+    std::vector<result_value_t> row(columns.size());
+    for (const scan_image_t& image : images) {
+        size_t col = 0;
+        row[col++].u = image.width;
+        row[col++].u = image.height;
+        row[col++].u = image.hist.windows;
+        row[col++].u = image.hist.compressible;
+        for (size_t c = 0; c < NUM_CHANNELS; c++) {
+            row[col++].u = image.hist.skip[c];
+        }
+        for (size_t t = 0; t <= SCAN_MAX_TOTAL_BITS; t++) {
+            row[col++].u = image.hist.total_bits[t];
+        }
+        results_append(&writer, row.data());
+    }
+    return results_close_write(&writer);
+}
+
+int main(int argc, char** argv) {
+    std::vector<const char*> paths;
+    uint64_t raw_width = 0;
+    uint32_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool per_image = false;
+    const char* out_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--raw-width") == 0 && i + 1 < argc) {
+            raw_width = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--per-image") == 0) {
+            per_image = true;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (argv[i][0] != '-') {
+            paths.push_back(argv[i]);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (paths.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    for (const char* path : paths) {
+        scan_find_images(path, &files);
+    }
+    std::vector<scan_image_t> images;
+    uint64_t bytes = 0;
+    for (const std::string& file : files) {
+        scan_image_t image;
+        if (!scan_open_image(file.c_str(), raw_width, &image)) {
+            fprintf(stderr, "Skipping %s: not a P6 PPM%s\n", file.c_str(), raw_width == 0 ? " (raw files need --raw-width)" : "");
+            continue;
+        }
+        bytes += image.stride * image.height;
+        images.push_back(image);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    scan_images(&images, num_threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    scan_hist_t total;
+    scan_hist_clear(&total);
+    for (const scan_image_t& image : images) {
+        if (per_image) {
+            printf("%s\t%" PRIu64 "x%" PRIu64 "\t%" PRIu64 " windows\t%.2f%% compressible\n", image.path.c_str(), image.width, image.height,
+                image.hist.windows, percent(image.hist.compressible, image.hist.windows));
+        }
+        scan_hist_merge(&total, &image.hist);
+    }
+    if (per_image) {
+        printf("\n");
+    }
+    printf("images\t%zu\n", images.size());
+    print_hist(&total);
+    fprintf(stderr, "Scanned %.1f MB in %.3f s (%.2f GB/s) on %u threads\n", bytes / 1e6, seconds, bytes / 1e9 / seconds, num_threads);
+
+    bool ok = out_path == nullptr || write_results(images, out_path);
+    if (!ok) {
+        fprintf(stderr, "Could not write %s\n", out_path);
+    }
+    for (scan_image_t& image : images) {
+        scan_close_image(&image);
+    }
+    return ok ? 0 : 1;
+}
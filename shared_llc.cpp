@@ -0,0 +1,214 @@
+#include "shared_llc.hpp"
+#include "cache.hpp"
+#include "timing.hpp"
+
+#include <atomic>
+#include <thread>
+
+#define SHARED_SPINS_BEFORE_YIELD 64
+#define SHARED_TURN_NONE UINT32_MAX
+
+//Stats are per core and passed in by the caller, so only the FULL counters are kept.
+#define SHARED_STATS_LEVEL STATS_LEVEL_FULL
+
+static shared_llc_config_t shared_config;
+static Cache* l1s[SHARED_LLC_MAX_CORES];
+static Cache* llc;
+static std::atomic<uint8_t>* set_locks;
+
+//Sequencer: whose turn it is, and which cores have no accesses left
+static std::atomic<uint32_t> turn;
+static std::atomic<bool> core_done[SHARED_LLC_MAX_CORES];
+
+namespace {
+    inline void spin_wait(uint32_t* spins) {
+        if (++*spins >= SHARED_SPINS_BEFORE_YIELD) {
+            std::this_thread::yield();
+            *spins = 0;
+        }
+    }
+
+    inline void lock_set(uint64_t index) {
+        uint32_t spins = 0;
+        while (set_locks[index].exchange(1, std::memory_order_acquire)) {
+            while (set_locks[index].load(std::memory_order_relaxed)) {
+                spin_wait(&spins);
+            }
+        }
+    }
+
+    inline void unlock_set(uint64_t index) {
+        set_locks[index].store(0, std::memory_order_release);
+    }
+
+    inline void wait_turn(uint32_t core) {
+        uint32_t spins = 0;
+        while (turn.load(std::memory_order_acquire) != core) {
+            spin_wait(&spins);
+        }
+    }
+
+    //Hands the turn to the next core that still has accesses, or to nobody.
+    inline void pass_turn(uint32_t core) {
+        for (uint32_t i = 1; i <= shared_config.num_cores; i++) {
+            uint32_t next = (core + i) % shared_config.num_cores;
+            if (!core_done[next].load(std::memory_order_relaxed)) {
+                turn.store(next, std::memory_order_release);
+                return;
+            }
+        }
+        turn.store(SHARED_TURN_NONE, std::memory_order_release);
+    }
+
+    //Starts a sequenced run in which only the active cores take turns.
+    void reset_sequencer(const bool* active) {
+        uint32_t first = SHARED_TURN_NONE;
+        for (uint32_t c = 0; c < shared_config.num_cores; c++) {
+            core_done[c].store(!active[c], std::memory_order_relaxed);
+            if (active[c] && first == SHARED_TURN_NONE) {
+                first = c;
+            }
+        }
+        turn.store(first, std::memory_order_release);
+    }
+}
+
+void shared_llc_setup(const shared_llc_config_t* config) {
+    shared_config = *config;
+    if (shared_config.num_cores > SHARED_LLC_MAX_CORES) {
+        shared_config.num_cores = SHARED_LLC_MAX_CORES;
+    }
+    shared_config.llc_config.prefetcher_disabled = true;
+
+    for (uint32_t c = 0; c < shared_config.num_cores; c++) {
+        l1s[c] = new Cache(shared_config.l1_config, true);
+    }
+    llc = new Cache(shared_config.llc_config, false);
+    set_locks = new std::atomic<uint8_t>[llc->get_num_sets()];
+    for (uint64_t i = 0; i < llc->get_num_sets(); i++) {
+        set_locks[i].store(0, std::memory_order_relaxed);
+    }
+
+    bool active[SHARED_LLC_MAX_CORES];
+    std::fill(active, active + SHARED_LLC_MAX_CORES, true);
+    reset_sequencer(active);
+}
+
+//Returns the time of the access: an L1 hit, an LLC hit or an LLC miss. LLC events are counted in the
+//*_l2 fields of the core's stats. A compressed LLC stores a compressed line in half a way, as
+//sim_access_compressed.
+double shared_llc_access(uint32_t core, char rw, uint64_t addr, sim_stats_t* stats, bool compressed) {
+    if (shared_config.sequenced) {
+        wait_turn(core);
+    }
+    if (rw == 'R') {
+        stats->reads++;
+    } else {
+        stats->writes++;
+    }
+
+    Cache* l1 = l1s[core];
+    uint64_t l1_tag, l1_index;
+    l1->parse_addr(addr, &l1_tag, &l1_index);
+    double accessTime = SHARED_L1_HIT_TIME;
+    if (!l1->access<SHARED_STATS_LEVEL>(rw, l1_tag, l1_index, stats)) {
+        uint64_t llc_tag, llc_index;
+        llc->parse_addr(addr, &llc_tag, &llc_index);
+        lock_set(llc_index);
+        const bool llcHit = llc->access<SHARED_STATS_LEVEL>('R', llc_tag, llc_index, stats);
+        if (llcHit) {
+            llc->resize<SHARED_STATS_LEVEL>('R', llc_tag, llc_index, compressed, stats);
+        } else {
+            llc->install<SHARED_STATS_LEVEL>('R', llc_tag, llc_index, stats, nullptr, compressed);
+        }
+        unlock_set(llc_index);
+
+        uint64_t wbAddrs[CACHE_MAX_WRITEBACKS];
+        const uint32_t numWritebacks = l1->install<SHARED_STATS_LEVEL>(rw, l1_tag, l1_index, stats, wbAddrs);
+        for (uint32_t w = 0; w < numWritebacks; w++) {
+            uint64_t wb_tag, wb_index;
+            llc->parse_addr(wbAddrs[w], &wb_tag, &wb_index);
+            lock_set(wb_index);
+            llc->access<SHARED_STATS_LEVEL>('W', wb_tag, wb_index, stats);
+            unlock_set(wb_index);
+        }
+
+        accessTime = llcHit ? HIT_TIME : HIT_TIME + MISS_TIME;
+        if (timing_model_active) {
+            accessTime = timing_sample(llcHit);
+        }
+    }
+
+    if (shared_config.sequenced) {
+        pass_turn(core);
+    }
+    return accessTime;
+}
+
+//Takes a core out of the sequencer's rotation once it has no accesses left.
+void shared_llc_core_done(uint32_t core) {
+    if (!shared_config.sequenced) {
+        return;
+    }
+    wait_turn(core);
+    core_done[core].store(true, std::memory_order_relaxed);
+    pass_turn(core);
+}
+
+//Reads streams[c], a line list as get_frame_lines builds, on core c, each core on its own thread (the
+//calling thread when only one core has accesses). stats and outTimes have one entry per stream; outTimes
+//gets each core's total access time.
+void shared_llc_run(const std::vector<std::vector<uint64_t>>& streams, sim_stats_t* stats, double* outTimes) {
+    const uint32_t num_streams = std::min<uint32_t>(streams.size(), shared_config.num_cores);
+    bool active[SHARED_LLC_MAX_CORES] = {false};
+    uint32_t num_active = 0;
+    for (uint32_t c = 0; c < num_streams; c++) {
+        active[c] = !streams[c].empty();
+        num_active += active[c];
+        outTimes[c] = 0.0;
+    }
+    reset_sequencer(active);
+
+    auto run_core = [&](uint32_t core) {
+        double totalTime = 0.0;
+        for (uint64_t line : streams[core]) {
+            totalTime += shared_llc_access(core, 'R', line & ~SIM_LINE_COMPRESSED, &stats[core], (line & SIM_LINE_COMPRESSED) != 0);
+        }
+        outTimes[core] = totalTime;
+        shared_llc_core_done(core);
+    };
+
+    if (num_active == 1) {
+        for (uint32_t c = 0; c < num_streams; c++) {
+            if (active[c]) {
+                run_core(c);
+            }
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (uint32_t c = 0; c < num_streams; c++) {
+        if (active[c]) {
+            threads.push_back(std::thread(run_core, c));
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+//Computes each core's L1 ratios and frees the hierarchy. stats has one entry per core.
+void shared_llc_finish(sim_stats_t* stats) {
+    for (uint32_t c = 0; c < shared_config.num_cores; c++) {
+        stats[c].hit_ratio_l1 = stats[c].accesses_l1 == 0 ? 0.0 : (double) stats[c].hits_l1 / stats[c].accesses_l1;
+        stats[c].miss_ratio_l1 = stats[c].accesses_l1 == 0 ? 0.0 : (double) stats[c].misses_l1 / stats[c].accesses_l1;
+        stats[c].avg_access_time_l1 = SHARED_L1_HIT_TIME + stats[c].miss_ratio_l1 * HIT_TIME;
+        delete l1s[c];
+        l1s[c] = nullptr;
+    }
+    delete llc;
+    llc = nullptr;
+    delete[] set_locks;
+    set_locks = nullptr;
+}
@@ -0,0 +1,46 @@
+//Several simulated cores, each with a private L1, sharing one LLC.
+//Every core is driven by its own host thread. The LLC is guarded by a spinlock per set, so cores that
+//touch different sets proceed in parallel. With the sequencer on, the cores' accesses are interleaved
+//round-robin instead, which makes a run deterministic.
+//
+//The LLC is non-inclusive like the single-core hierarchy: its evictions do not invalidate the L1s, and
+//dirty L1 victims are written back to it. Its prefetcher is always off, since the prefetcher tracks one
+//miss stream for the whole cache.
+
+#ifndef SHARED_LLC_HPP
+#define SHARED_LLC_HPP
+
+#include "cache_sim.hpp"
+
+#include <vector>
+
+#define SHARED_LLC_MAX_CORES 16
+#define SHARED_L1_HIT_TIME 4.0
+
+typedef struct {
+    uint32_t num_cores;
+    cache_config_t l1_config;   //Each core's private L1
+    cache_config_t llc_config;
+    bool sequenced;
+} shared_llc_config_t;
+
+static const cache_config_t SHARED_L1_CONFIG = {/*.disabled =*/ false,
+                                                /*.prefetcher_disabled =*/ true,
+                                                /*.strided_prefetch_disabled =*/ true,
+                                                /*.c =*/ 12, // 4KB Cache
+                                                /*.b =*/ 6,  // 64-byte blocks
+                                                /*.s =*/ 3,  // 8-way
+                                                /*.replace_policy =*/ REPLACE_POLICY_LRU,
+                                                /*.prefetch_insert_policy =*/ INSERT_POLICY_MIP,
+                                                /*.write_strat =*/ WRITE_STRAT_WBWA,
+                                                /*.slices =*/ 1,
+                                                /*.hashed_index =*/ false,
+                                                /*.compressed =*/ false};
+
+extern void shared_llc_setup(const shared_llc_config_t* config);
+extern double shared_llc_access(uint32_t core, char rw, uint64_t addr, sim_stats_t* stats, bool compressed=false);
+extern void shared_llc_core_done(uint32_t core);
+extern void shared_llc_run(const std::vector<std::vector<uint64_t>>& streams, sim_stats_t* stats, double* outTimes);
+extern void shared_llc_finish(sim_stats_t* stats);
+
+#endif
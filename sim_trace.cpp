@@ -0,0 +1,105 @@
+#include "sim_trace.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#define SIM_TRACE_BUFFER_SIZE (1 << 20)
+
+sim_event_hook_t sim_event_hook = nullptr;
+void* sim_event_ctx = nullptr;
+uint64_t sim_event_time = 0;
+
+static FILE* trace_log = nullptr;
+
+void sim_set_event_hook(sim_event_hook_t hook, void* ctx) {
+    sim_event_hook = hook;
+    sim_event_ctx = ctx;
+}
+
+void sim_trace_print(const sim_event_t* event, void* ctx) {
+    const char* name = event->level == 1 ? "L1" : "L2";
+    switch (event->type) {
+    case SIM_EVENT_ACCESS:
+        printf("\nTime: %" PRIu64 ". Address: 0x%" PRIx64 ". Read/Write: %c\n", event->time, event->addr, event->rw);
+        break;
+    case SIM_EVENT_DECOMPOSE:
+        printf("%s decomposed address 0x%" PRIx64 " -> Tag: 0x%" PRIx64 " and Index: 0x%" PRIx64 "\n", 
+            name, event->addr, event->tag, event->index);
+        break;
+    case SIM_EVENT_BYPASS:
+        if (event->rw == 'R') {
+            printf("%s is disabled, treating this as an %s read miss\n", name, name);
+        } else {
+            printf("%s is disabled, writing through to memory\n", name);
+        }
+        break;
+    case SIM_EVENT_HIT:
+        if (event->level == 1) {
+            printf("L1 hit");
+        } else if (event->rw == 'R') {
+            printf("L2 read hit");
+        } else {
+            printf("L2 found block in cache on write");
+        }
+        printf(", moving Tag: 0x%" PRIx64 " and Index: 0x%" PRIx64 " to MRU position%s\n", 
+            event->tag, event->index, event->dirty ? " and setting dirty bit" : "");
+        break;
+    case SIM_EVENT_MISS:
+        if (event->level == 1) {
+            printf("L1 miss\n");
+        } else if (event->rw == 'R') {
+            printf("L2 read miss\n");
+        } else {
+            printf("L2 did not find block in cache on write, writing through to memory anyway\n");
+        }
+        break;
+    case SIM_EVENT_EVICT:
+        printf("Evict from %s: block with valid=1, dirty=%d, tag 0x%" PRIx64 " and index=0x%" PRIx64 "\n", 
+            name, event->dirty, event->tag, event->index);
+        break;
+    case SIM_EVENT_INSTALL:
+        printf("Install in %s: tag 0x%" PRIx64 " and index=0x%" PRIx64 "\n", name, event->tag, event->index);
+        break;
+    case SIM_EVENT_PREFETCH:
+        printf("Prefetch block with address 0x%" PRIx64 " from memory to L2\n", event->addr);
+        break;
+    case SIM_EVENT_WRITEBACK:
+        printf("Writing back dirty block with address 0x%" PRIx64 " to L2\n", event->addr);
+        break;
+    }
+}
+
+static void write_event(const sim_event_t* event, void* ctx) {
+    fwrite(event, sizeof(sim_event_t), 1, (FILE*) ctx);
+}
+
+//Streams every event to path as raw records. Returns false if the file can't be opened.
+bool sim_trace_log_open(const char* path) {
+    sim_trace_log_close();
+    trace_log = fopen(path, "wb");
+    if (trace_log == nullptr) {
+        return false;
+    }
+    setvbuf(trace_log, nullptr, _IOFBF, SIM_TRACE_BUFFER_SIZE);
+
+    sim_trace_header_t header;
+    memcpy(header.magic, SIM_TRACE_MAGIC, sizeof(header.magic));
+    header.version = SIM_TRACE_VERSION;
+    header.record_size = sizeof(sim_event_t);
+    fwrite(&header, sizeof(header), 1, trace_log);
+
+    sim_set_event_hook(write_event, trace_log);
+    return true;
+}
+
+void sim_trace_log_close() {
+    if (trace_log == nullptr) {
+        return;
+    }
+
+    if (sim_event_ctx == trace_log) {
+        sim_set_event_hook(nullptr, nullptr);
+    }
+    fclose(trace_log);
+    trace_log = nullptr;
+}
@@ -0,0 +1,80 @@
+//Structured cache events, replacing the old DEBUG printfs.
+//Events are only produced by the STATS_LEVEL_TRACE instantiations of the simulator, so at every other
+//level the emit calls compile away. A hook receives each event; sim_trace_print reproduces the old
+//DEBUG output, and the binary log streams raw sim_event_t records to a file.
+
+#ifndef SIM_TRACE_HPP
+#define SIM_TRACE_HPP
+
+#include "cache_sim.hpp"
+
+typedef enum sim_event_type {
+    SIM_EVENT_ACCESS,       //sim_access called with addr/rw
+    SIM_EVENT_DECOMPOSE,    //addr split into tag/index
+    SIM_EVENT_BYPASS,       //access to a disabled cache
+    SIM_EVENT_HIT,
+    SIM_EVENT_MISS,
+    SIM_EVENT_EVICT,        //valid victim tag/index, dirty
+    SIM_EVENT_INSTALL,      //new block tag/index
+    SIM_EVENT_PREFETCH,     //prefetched addr
+    SIM_EVENT_WRITEBACK,    //dirty L1 victim addr written back to L2
+} sim_event_type_t;
+
+typedef struct sim_event {
+    uint64_t time;      //Number of sim_access calls before this one
+    uint64_t addr;
+    uint64_t tag;
+    uint64_t index;
+    uint8_t type;       //sim_event_type_t
+    uint8_t level;      //1 = L1, 2 = L2
+    char rw;
+    uint8_t dirty;
+    uint32_t reserved;
+} sim_event_t;
+
+typedef void (*sim_event_hook_t)(const sim_event_t* event, void* ctx);
+
+#define SIM_TRACE_MAGIC "SIMTRACE"
+#define SIM_TRACE_VERSION 1
+
+//Header of the binary log, followed by sim_event_t records until EOF.
+typedef struct sim_trace_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} sim_trace_header_t;
+
+extern sim_event_hook_t sim_event_hook;
+extern void* sim_event_ctx;
+extern uint64_t sim_event_time;
+
+extern void sim_set_event_hook(sim_event_hook_t hook, void* ctx);
+extern void sim_trace_print(const sim_event_t* event, void* ctx);
+extern bool sim_trace_log_open(const char* path);
+extern void sim_trace_log_close();
+
+template <stats_level_t L>
+inline void sim_emit(sim_event_type_t type, uint8_t level, char rw, uint64_t addr, 
+        uint64_t tag = 0, uint64_t index = 0, bool dirty = false) {
+    if (L == STATS_LEVEL_TRACE && sim_event_hook != nullptr) {
+        sim_event_t event = {sim_event_time, addr, tag, index, (uint8_t) type, level, rw, dirty, 0};
+        sim_event_hook(&event, sim_event_ctx);
+    }
+}
+
+//Counter helpers, compiled out below the level that needs the counter.
+template <stats_level_t L>
+inline void count_attack(uint64_t& counter) {
+    if (L >= STATS_LEVEL_ATTACK) {
+        counter++;
+    }
+}
+
+template <stats_level_t L>
+inline void count_full(uint64_t& counter) {
+    if (L >= STATS_LEVEL_FULL) {
+        counter++;
+    }
+}
+
+#endif
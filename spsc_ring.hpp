@@ -0,0 +1,62 @@
+//Bounded lock-free ring between exactly one producer thread and one consumer thread.
+//Slots are filled and drained in place: the producer writes into acquire_write() and publishes it with
+//commit_write(), the consumer reads acquire_read() and hands the slot back with commit_read().
+
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <inttypes.h>
+#include <stddef.h>
+
+#define SPSC_CACHE_LINE 64
+
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : m_Head(0), m_CachedTail(0), m_Tail(0), m_CachedHead(0) {}
+
+    //Free slot for the producer, or nullptr if the ring is full.
+    T* acquire_write() {
+        const uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_CachedHead == N) {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            if (tail - m_CachedHead == N) {
+                return nullptr;
+            }
+        }
+        return &m_Slots[tail & (N - 1)];
+    }
+
+    void commit_write() {
+        m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //Oldest published slot for the consumer, or nullptr if the ring is empty.
+    T* acquire_read() {
+        const uint64_t head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_CachedTail) {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            if (head == m_CachedTail) {
+                return nullptr;
+            }
+        }
+        return &m_Slots[head & (N - 1)];
+    }
+
+    void commit_read() {
+        m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    //Each index lives on its own line, next to the other side's index as last seen by its owner
+    alignas(SPSC_CACHE_LINE) std::atomic<uint64_t> m_Head;
+    uint64_t m_CachedTail;  //Consumer only
+    alignas(SPSC_CACHE_LINE) std::atomic<uint64_t> m_Tail;
+    uint64_t m_CachedHead;  //Producer only
+    alignas(SPSC_CACHE_LINE) T m_Slots[N];
+};
+
+#endif
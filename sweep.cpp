@@ -0,0 +1,324 @@
+#include "sweep.hpp"
+
+//Stdlib Things
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//My Things
+#include "checkpoint.hpp"
+#include "experiment.hpp"
+#include "results.hpp"
+
+static const uint32_t sweep_texture_sizes_kb[] = {1, 2, 4, 8, 16, 32, 64, 128};
+static const uint64_t sweep_s[] = {2, 4, 10};    //4-way, 16-way, fully associative
+static const replace_policy_t sweep_policies[] = {
+    REPLACE_POLICY_LRU, REPLACE_POLICY_LFU, REPLACE_POLICY_SRRIP, REPLACE_POLICY_BRRIP, REPLACE_POLICY_QLRU
+};
+
+static const result_column_t sweep_columns[] = {
+    {"point", RESULT_TYPE_U32},
+    {"texture_size_kb", RESULT_TYPE_U32},
+    {"s", RESULT_TYPE_U8},
+    {"replace_policy", RESULT_TYPE_U8},
+    {"use_facade", RESULT_TYPE_U8},
+    {"uncompressed_evictions", RESULT_TYPE_U64},
+    {"uncompressed_walk_time", RESULT_TYPE_F64},
+    {"compressed_evictions", RESULT_TYPE_U64},
+    {"compressed_walk_time", RESULT_TYPE_F64},
+    {"uncompressed_walk_p50", RESULT_TYPE_F64},
+    {"uncompressed_walk_p99", RESULT_TYPE_F64},
+    {"compressed_walk_p50", RESULT_TYPE_F64},
+    {"compressed_walk_p99", RESULT_TYPE_F64},
+};
+#define SWEEP_NUM_COLUMNS (sizeof(sweep_columns) / sizeof(sweep_columns[0]))
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+std::vector<sweep_point_t> sweep_points() {
+    std::vector<sweep_point_t> points;
+    for (size_t s = 0; s < ARRAY_LEN(sweep_s); s++) {
+        for (size_t p = 0; p < ARRAY_LEN(sweep_policies); p++) {
+            for (int facade = 0; facade < 2; facade++) {
+                for (size_t t = 0; t < ARRAY_LEN(sweep_texture_sizes_kb); t++) {
+                    sweep_point_t point;
+                    point.index = points.size();
+                    point.texture_size_kb = sweep_texture_sizes_kb[t];
+                    point.s = sweep_s[s];
+                    point.replace_policy = sweep_policies[p];
+                    point.use_facade = facade;
+                    points.push_back(point);
+                }
+            }
+        }
+    }
+    return points;
+}
+
+//Estimated work of measure_llc_walk: the accesses of both runs (fill, texture, walk) weighted by the
+//victim search, which grows with associativity.
+uint64_t sweep_point_cost(const sweep_point_t* point) {
+    const uint64_t textureLines = 2 * 8*point->texture_size_kb * (point->use_facade ? 2 : 1);
+    const uint64_t accesses = 2 * (2*2*FRAME_NUM_WINDOWS_CACHE + textureLines);
+    return accesses * (64 + (1ull << point->s)) / 64;
+}
+
+//Longest-processing-time first: points go, most expensive first, to the least loaded shard.
+//Ties break on point and shard index, so every process computes the same partition.
+std::vector<sweep_point_t> sweep_shard(const std::vector<sweep_point_t>& points, uint32_t shard, uint32_t num_shards) {
+    std::vector<sweep_point_t> sorted(points);
+    std::sort(sorted.begin(), sorted.end(), [](const sweep_point_t& a, const sweep_point_t& b) {
+        uint64_t costA = sweep_point_cost(&a);
+        uint64_t costB = sweep_point_cost(&b);
+        return costA != costB ? costA > costB : a.index < b.index;
+    });
+
+    std::vector<uint64_t> load(num_shards, 0);
+    std::vector<sweep_point_t> mine;
+    for (const sweep_point_t& point : sorted) {
+        uint32_t target = std::min_element(load.begin(), load.end()) - load.begin();
+        load[target] += sweep_point_cost(&point);
+        if (target == shard) {
+            mine.push_back(point);
+        }
+    }
+
+    std::sort(mine.begin(), mine.end(), [](const sweep_point_t& a, const sweep_point_t& b) {
+        return a.index < b.index;
+    });
+    return mine;
+}
+
+//Sweep checkpoints hold the points of the run, then the rows measured so far.
+typedef struct {
+    uint64_t num_points;
+    uint64_t num_done;
+} sweep_progress_t;
+
+static void save_sweep_checkpoint(const char* path, const std::vector<sweep_point_t>& points, 
+        const std::vector<result_value_t>& rows) {
+    sweep_progress_t progress = {points.size(), rows.size() / SWEEP_NUM_COLUMNS};
+    std::vector<uint8_t> state(sizeof(progress) + points.size()*sizeof(uint32_t) + rows.size()*sizeof(result_value_t));
+    uint8_t* out = state.data();
+    memcpy(out, &progress, sizeof(progress));
+    out += sizeof(progress);
+    for (const sweep_point_t& point : points) {
+        memcpy(out, &point.index, sizeof(uint32_t));
+        out += sizeof(uint32_t);
+    }
+    memcpy(out, rows.data(), rows.size()*sizeof(result_value_t));
+    if (!checkpoint_save(path, CHECKPOINT_CAMPAIGN_SWEEP, state)) {
+        fprintf(stderr, "Could not write checkpoint %s\n", path);
+    }
+}
+
+typedef struct {
+    const std::vector<sweep_point_t>* points;
+    std::vector<result_value_t>* rows;
+} sweep_resume_t;
+
+//Accepts a checkpoint of a run over the same points and takes its rows.
+static bool accept_sweep_checkpoint(const std::vector<uint8_t>& state, uint64_t, void* arg) {
+    sweep_resume_t* resume = (sweep_resume_t*) arg;
+    const std::vector<sweep_point_t>& points = *resume->points;
+    sweep_progress_t progress;
+    if (state.size() < sizeof(progress)) {
+        return false;
+    }
+    memcpy(&progress, state.data(), sizeof(progress));
+    if (progress.num_points != points.size() || progress.num_done > points.size() ||
+            state.size() != sizeof(progress) + points.size()*sizeof(uint32_t) + progress.num_done*SWEEP_NUM_COLUMNS*sizeof(result_value_t)) {
+        return false;
+    }
+    const uint8_t* in = state.data() + sizeof(progress);
+    for (const sweep_point_t& point : points) {
+        uint32_t index;
+        memcpy(&index, in, sizeof(index));
+        in += sizeof(index);
+        if (index != point.index) {
+            return false;
+        }
+    }
+    resume->rows->resize(progress.num_done*SWEEP_NUM_COLUMNS);
+    memcpy(resume->rows->data(), in, resume->rows->size()*sizeof(result_value_t));
+    return true;
+}
+
+//Rows measured by an interrupted run over the same points, if there was one.
+static void load_sweep_checkpoint(const char* path, const std::vector<sweep_point_t>& points, std::vector<result_value_t>* rows) {
+    sweep_resume_t resume = {&points, rows};
+    checkpoint_load(path, CHECKPOINT_CAMPAIGN_SWEEP, accept_sweep_checkpoint, &resume);
+}
+
+//Measures each point and streams its row to path. Every point reseeds rand() from its index, so its
+//frames, and so its row, do not depend on which shard runs it. With a checkpoint path, the points a
+//previous run already measured are taken from the checkpoint there instead of being measured again.
+bool run_sweep(const std::vector<sweep_point_t>& points, const char* path, const char* checkpoint) {
+    results_writer_t writer;
+    if (!results_open_write(&writer, path, sweep_columns, SWEEP_NUM_COLUMNS, SWEEP_CHUNK_ROWS)) {
+        return false;
+    }
+
+    std::vector<result_value_t> rows;
+    if (checkpoint != nullptr) {
+        load_sweep_checkpoint(checkpoint, points, &rows);
+    }
+    for (size_t r = 0; r < rows.size(); r += SWEEP_NUM_COLUMNS) {
+        results_append(&writer, &rows[r]);
+    }
+
+    const sim_config_t saved = cache_config;
+    for (size_t i = rows.size() / SWEEP_NUM_COLUMNS; i < points.size(); i++) {
+        const sweep_point_t& point = points[i];
+        if (checkpoint != nullptr && i > 0 && i % SWEEP_CHECKPOINT_POINTS == 0) {
+            save_sweep_checkpoint(checkpoint, points, rows);
+        }
+        cache_config.l1_config.s = point.s;
+        cache_config.l1_config.replace_policy = point.replace_policy;
+        srand(SWEEP_SEED + point.index);
+
+        llc_walk_stats_combined_t stats;
+        stats.texture_size = point.texture_size_kb;
+        measure_llc_walk(8*point.texture_size_kb, &stats, point.use_facade);
+
+        result_value_t row[SWEEP_NUM_COLUMNS];
+        row[0].u = point.index;
+        row[1].u = point.texture_size_kb;
+        row[2].u = point.s;
+        row[3].u = point.replace_policy;
+        row[4].u = point.use_facade;
+        row[5].u = stats.uncompressed.num_evictions;
+        row[6].f = stats.uncompressed.walk_time;
+        row[7].u = stats.compressed.num_evictions;
+        row[8].f = stats.compressed.walk_time;
+        row[9].f = stats.uncompressed.walk_p50;
+        row[10].f = stats.uncompressed.walk_p99;
+        row[11].f = stats.compressed.walk_p50;
+        row[12].f = stats.compressed.walk_p99;
+        results_append(&writer, row);
+        rows.insert(rows.end(), row, row + SWEEP_NUM_COLUMNS);
+    }
+    cache_config = saved;
+
+    bool ok = results_close_write(&writer);
+    if (ok && checkpoint != nullptr) {
+        checkpoint_remove(checkpoint);
+    }
+    return ok;
+}
+
+//Combines partial results into one file ordered by point, written with the same chunking as a
+//single-process run. Fails if a point is missing or appears twice.
+bool merge_sweep(const char* path, const std::vector<const char*>& inputs) {
+    std::vector<std::vector<result_value_t>> rows;
+    for (const char* input : inputs) {
+        results_reader_t reader;
+        if (!results_open_read(&reader, input)) {
+            fprintf(stderr, "Could not read %s\n", input);
+            return false;
+        }
+        if (reader.columns.size() != SWEEP_NUM_COLUMNS) {
+            fprintf(stderr, "%s is not a sweep\n", input);
+            results_close_read(&reader);
+            return false;
+        }
+        if (!reader.closed) {
+            fprintf(stderr, "%s was not closed, its shard did not finish\n", input);
+            results_close_read(&reader);
+            return false;
+        }
+
+        std::vector<result_value_t> column(reader.num_rows);
+        const size_t first = rows.size();
+        rows.resize(first + reader.num_rows, std::vector<result_value_t>(SWEEP_NUM_COLUMNS));
+        for (uint32_t c = 0; c < SWEEP_NUM_COLUMNS; c++) {
+            if (reader.columns[c].type != sweep_columns[c].type) {
+                fprintf(stderr, "%s is not a sweep\n", input);
+                results_close_read(&reader);
+                return false;
+            }
+            results_read_values(&reader, c, 0, reader.num_rows, column.data());
+            for (uint64_t r = 0; r < reader.num_rows; r++) {
+                rows[first + r][c] = column[r];
+            }
+        }
+        results_close_read(&reader);
+    }
+
+    std::sort(rows.begin(), rows.end(), [](const std::vector<result_value_t>& a, const std::vector<result_value_t>& b) {
+        return a[0].u < b[0].u;
+    });
+    for (size_t r = 0; r < rows.size(); r++) {
+        if (rows[r][0].u != r) {
+            fprintf(stderr, "Sweep point %zu is missing or duplicated\n", r);
+            return false;
+        }
+    }
+
+    results_writer_t writer;
+    if (!results_open_write(&writer, path, sweep_columns, SWEEP_NUM_COLUMNS, SWEEP_CHUNK_ROWS)) {
+        return false;
+    }
+    for (const std::vector<result_value_t>& row : rows) {
+        results_append(&writer, row.data());
+    }
+    return results_close_write(&writer);
+}
+
+static std::string shard_path(const char* path, uint32_t shard, uint32_t num_shards) {
+    return std::string(path) + ".shard" + std::to_string(shard) + "of" + std::to_string(num_shards);
+}
+
+//Runs every shard in a forked child, at most jobs at a time, then merges the partials into path.
+//Each shard checkpoints next to its partial, so rerunning an interrupted pool resumes every shard.
+bool run_sweep_pool(const char* path, uint32_t num_shards, uint32_t jobs) {
+    const std::vector<sweep_point_t> points = sweep_points();
+    std::vector<std::string> partials;
+    for (uint32_t i = 0; i < num_shards; i++) {
+        partials.push_back(shard_path(path, i, num_shards));
+    }
+
+    bool ok = true;
+    uint32_t running = 0;
+    for (uint32_t next = 0; next < num_shards || running > 0; ) {
+        if (next < num_shards && running < jobs) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                const std::string checkpoint = partials[next] + ".ckpt";
+                _exit(run_sweep(sweep_shard(points, next, num_shards), partials[next].c_str(), checkpoint.c_str()) ? 0 : 1);
+            } else if (pid < 0) {
+                perror("fork");
+                ok = false;
+                num_shards = next;  //Launch nothing more, wait for the rest
+                continue;
+            }
+            next++;
+            running++;
+            continue;
+        }
+
+        int status;
+        if (wait(&status) < 0) {
+            perror("wait");
+            return false;
+        }
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        running--;
+    }
+
+    if (ok) {
+        std::vector<const char*> inputs;
+        for (const std::string& partial : partials) {
+            inputs.push_back(partial.c_str());
+        }
+        ok = merge_sweep(path, inputs);
+    }
+    for (const std::string& partial : partials) {
+        unlink(partial.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,31 @@
+//Parameter sweeps of the LLC walk: texture size x associativity x replacement policy x facade.
+//Points are split into deterministic, cost-balanced shards that run as separate processes, each
+//writing a partial results file; merging the partials reproduces the single-process file exactly.
+
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include "cache_sim.hpp"
+
+#include <vector>
+
+#define SWEEP_SEED 1
+#define SWEEP_CHUNK_ROWS 16
+#define SWEEP_CHECKPOINT_POINTS 8
+
+typedef struct {
+    uint32_t index;             //Position in the full sweep; rows are ordered by it
+    uint32_t texture_size_kb;
+    uint64_t s;
+    replace_policy_t replace_policy;
+    bool use_facade;
+} sweep_point_t;
+
+extern std::vector<sweep_point_t> sweep_points();
+extern uint64_t sweep_point_cost(const sweep_point_t* point);
+extern std::vector<sweep_point_t> sweep_shard(const std::vector<sweep_point_t>& points, uint32_t shard, uint32_t num_shards);
+extern bool run_sweep(const std::vector<sweep_point_t>& points, const char* path, const char* checkpoint=nullptr);
+extern bool merge_sweep(const char* path, const std::vector<const char*>& inputs);
+extern bool run_sweep_pool(const char* path, uint32_t num_shards, uint32_t jobs);
+
+#endif
@@ -0,0 +1,77 @@
+//LLC walk parameter sweeps, split across processes.
+//
+//Usage: compress_sweep --out <file> [--shard i/N] [--checkpoint <file>]
+//           Run one shard (default 0/1, the whole sweep), resuming from the checkpoint if there is one
+//       compress_sweep --out <file> --jobs J [--shards N]
+//           Run N shards (default J), J processes at a time, and merge them
+//       compress_sweep --merge <file> <partial>...
+//           Merge partial results
+
+//Stdlib Things
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//My Things
+#include "experiment.hpp"
+#include "sweep.hpp"
+
+static void usage() {
+    fprintf(stderr, "Usage: compress_sweep --out <file> [--shard i/N] [--checkpoint <file>]\n");
+    fprintf(stderr, "       compress_sweep --out <file> --jobs J [--shards N]\n");
+    fprintf(stderr, "       compress_sweep --merge <file> <partial>...\n");
+}
+
+int main(int argc, char** argv) {
+    const char* out = nullptr;
+    const char* merge = nullptr;
+    const char* checkpoint = nullptr;
+    std::vector<const char*> partials;
+    uint32_t shard = 0;
+    uint32_t num_shards = 1;
+    uint32_t jobs = 0;
+    uint32_t pool_shards = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u/%u", &shard, &num_shards) != 2) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            pool_shards = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--merge") == 0 && i + 1 < argc) {
+            merge = argv[++i];
+        } else if (merge != nullptr && argv[i][0] != '-') {
+            partials.push_back(argv[i]);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (merge != nullptr) {
+        return merge_sweep(merge, partials) ? 0 : 1;
+    }
+    if (out == nullptr || num_shards == 0 || shard >= num_shards) {
+        usage();
+        return 1;
+    }
+
+    init_cache_config();
+    if (jobs > 0) {
+        return run_sweep_pool(out, pool_shards > 0 ? pool_shards : jobs, jobs) ? 0 : 1;
+    }
+
+    std::vector<sweep_point_t> points = sweep_shard(sweep_points(), shard, num_shards);
+    fprintf(stderr, "Shard %u/%u: %zu points\n", shard, num_shards, points.size());
+    if (!run_sweep(points, out, checkpoint)) {
+        fprintf(stderr, "Could not write %s\n", out);
+        return 1;
+    }
+}
@@ -0,0 +1,221 @@
+#include "timing.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+#define TIMING_NORMAL_TABLE_SIZE (1 << (TIMING_NORMAL_TABLE_BITS))
+#define TIMING_FRAC_BITS 20
+
+bool timing_model_active = false;
+uint64_t timing_generation = 1;
+thread_local timing_buffer_t* timing_buffer = nullptr;
+
+static timing_model_t model;
+static std::atomic<uint64_t> next_thread(0);
+
+//Vose alias table over weighted values, sampled with one uniform.
+typedef struct {
+    std::vector<double> values;
+    std::vector<uint32_t> probs;    //Chance in 2^32 of keeping the column rather than its alias
+    std::vector<uint32_t> aliases;
+} alias_table_t;
+
+static alias_table_t alias_tables[2];   //[miss, hit]
+
+//Inverse normal CDF at TIMING_NORMAL_TABLE_SIZE + 1 evenly spaced points, the ends clamped to half a
+//step inside (0, 1).
+static const struct normal_table_t {
+    double z[TIMING_NORMAL_TABLE_SIZE + 1];
+    normal_table_t() {
+        for (uint32_t i = 0; i <= TIMING_NORMAL_TABLE_SIZE; i++) {
+            double p = (double) i / TIMING_NORMAL_TABLE_SIZE;
+            p = std::min(std::max(p, 0.5 / TIMING_NORMAL_TABLE_SIZE), 1.0 - 0.5 / TIMING_NORMAL_TABLE_SIZE);
+            //Bisect 0.5 * erfc(-z / sqrt(2)) = p
+            double lo = -10.0, hi = 10.0;
+            for (int it = 0; it < 100; it++) {
+                const double mid = (lo + hi) / 2;
+                if (0.5 * std::erfc(-mid / std::sqrt(2.0)) < p) {
+                    lo = mid;
+                } else {
+                    hi = mid;
+                }
+            }
+            z[i] = (lo + hi) / 2;
+        }
+    }
+} normal_table;
+
+static void build_alias_table(const std::vector<double>& values, const std::vector<double>& weights, alias_table_t* table) {
+    const size_t n = values.size();
+    double total = 0.0;
+    for (double weight : weights) {
+        total += weight;
+    }
+    table->values = values;
+    table->probs.assign(n, UINT32_MAX);
+    table->aliases.resize(n);
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < n; i++) {
+        table->aliases[i] = i;
+        scaled[i] = total > 0 ? weights[i] * n / total : 1.0;
+        if (scaled[i] < 1.0) {
+            small.push_back(i);
+        } else {
+            large.push_back(i);
+        }
+    }
+    while (!small.empty() && !large.empty()) {
+        const uint32_t s = small.back();
+        const uint32_t l = large.back();
+        small.pop_back();
+        table->probs[s] = (uint32_t) (scaled[s] * 4294967296.0 > UINT32_MAX ? UINT32_MAX : scaled[s] * 4294967296.0);
+        table->aliases[s] = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+}
+
+//FIXED with no noise; callers set the fields their kind uses.
+void timing_model_init(timing_model_t* newModel, timing_model_kind_t kind) {
+    newModel->kind = kind;
+    newModel->seed = 1;
+    newModel->hit_sigma = 0.0;
+    newModel->miss_sigma = 0.0;
+    newModel->quantum = 1.0;
+    newModel->hit_values.clear();
+    newModel->hit_weights.clear();
+    newModel->miss_values.clear();
+    newModel->miss_weights.clear();
+}
+
+//An EMPIRICAL model that draws hits and misses from recorded latency histograms, e.g. the hit and miss
+//histograms of a phase_latency_t.
+void timing_model_from_hist(timing_model_t* newModel, const hdr_hist_t* hits, const hdr_hist_t* misses) {
+    timing_model_init(newModel, TIMING_MODEL_EMPIRICAL);
+    for (uint64_t b = 0; b < LATENCY_NUM_BUCKETS; b++) {
+        if (hits->buckets[b] != 0) {
+            newModel->hit_values.push_back(hdr_hist_bucket_value(b));
+            newModel->hit_weights.push_back(hits->buckets[b]);
+        }
+        if (misses->buckets[b] != 0) {
+            newModel->miss_values.push_back(hdr_hist_bucket_value(b));
+            newModel->miss_weights.push_back(misses->buckets[b]);
+        }
+    }
+}
+
+//Switches sim_access to the model. Not safe while simulations run on other threads.
+void timing_set_model(const timing_model_t* newModel) {
+    model = *newModel;
+    if (model.kind == TIMING_MODEL_EMPIRICAL) {
+        //Without values of its own a kind keeps its fixed latency
+        if (model.miss_values.empty()) {
+            model.miss_values = {HIT_TIME + MISS_TIME};
+            model.miss_weights = {1.0};
+        }
+        if (model.hit_values.empty()) {
+            model.hit_values = {HIT_TIME};
+            model.hit_weights = {1.0};
+        }
+        build_alias_table(model.miss_values, model.miss_weights, &alias_tables[0]);
+        build_alias_table(model.hit_values, model.hit_weights, &alias_tables[1]);
+    }
+    timing_model_active = model.kind != TIMING_MODEL_FIXED;
+    timing_generation++;
+}
+
+namespace {
+    inline uint64_t splitmix64(uint64_t* state) {
+        uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    //TIMING_BUFFER_SIZE uniforms from the buffer's xorshift128+ lanes, which are independent so the
+    //inner loop vectorizes.
+    void fill_uniforms(timing_buffer_t* buffer, uint64_t* out) {
+        uint64_t* s0 = buffer->rng[0];
+        uint64_t* s1 = buffer->rng[1];
+        for (uint32_t i = 0; i < TIMING_BUFFER_SIZE; i += TIMING_LANES) {
+            for (uint32_t l = 0; l < TIMING_LANES; l++) {
+                uint64_t x = s0[l];
+                const uint64_t y = s1[l];
+                out[i + l] = x + y;
+                x ^= x << 23;
+                s0[l] = y;
+                s1[l] = x ^ y ^ (x >> 17) ^ (y >> 26);
+            }
+        }
+    }
+
+    inline double table_normal(uint64_t u) {
+        const uint64_t index = u >> (64 - TIMING_NORMAL_TABLE_BITS);
+        const double frac = (double) ((u >> (64 - TIMING_NORMAL_TABLE_BITS - TIMING_FRAC_BITS)) & ((1 << TIMING_FRAC_BITS) - 1)) / (1 << TIMING_FRAC_BITS);
+        return normal_table.z[index] + frac * (normal_table.z[index + 1] - normal_table.z[index]);
+    }
+}
+
+//Fills the calling thread's buffer for hits or misses, first (re)seeding it if the model changed.
+void timing_refill(bool hit) {
+    static thread_local std::unique_ptr<timing_buffer_t> owned;
+    static thread_local uint64_t thread_index = next_thread++;
+    if (timing_buffer == nullptr) {
+        owned.reset(new timing_buffer_t);
+        timing_buffer = owned.get();
+        timing_buffer->generation = 0;
+    }
+    timing_buffer_t* buffer = timing_buffer;
+    if (buffer->generation != timing_generation) {
+        uint64_t seed = model.seed ^ (thread_index * 0xD1B54A32D192ED03ull);
+        for (uint32_t l = 0; l < TIMING_LANES; l++) {
+            buffer->rng[0][l] = splitmix64(&seed);
+            buffer->rng[1][l] = splitmix64(&seed);
+        }
+        buffer->generation = timing_generation;
+        buffer->pos[0] = TIMING_BUFFER_SIZE;
+        buffer->pos[1] = TIMING_BUFFER_SIZE;
+    }
+
+    uint64_t uniforms[TIMING_BUFFER_SIZE];
+    fill_uniforms(buffer, uniforms);
+    double* out = buffer->samples[hit];
+    const double base = hit ? HIT_TIME : HIT_TIME + MISS_TIME;
+    const double sigma = hit ? model.hit_sigma : model.miss_sigma;
+    switch (model.kind) {
+    case TIMING_MODEL_FIXED:
+        for (uint32_t i = 0; i < TIMING_BUFFER_SIZE; i++) {
+            out[i] = base;
+        }
+        break;
+    case TIMING_MODEL_GAUSSIAN:
+        for (uint32_t i = 0; i < TIMING_BUFFER_SIZE; i++) {
+            out[i] = std::max(0.0, base + sigma * table_normal(uniforms[i]));
+        }
+        break;
+    case TIMING_MODEL_QUANTIZED:
+        for (uint32_t i = 0; i < TIMING_BUFFER_SIZE; i++) {
+            const double t = std::max(0.0, base + sigma * table_normal(uniforms[i]));
+            //The low bits are unused by the normal and give the timer's phase
+            const double phase = (double) (uniforms[i] & ((1 << TIMING_FRAC_BITS) - 1)) / (1 << TIMING_FRAC_BITS);
+            out[i] = model.quantum * std::floor(t / model.quantum + phase);
+        }
+        break;
+    case TIMING_MODEL_EMPIRICAL: {
+        const alias_table_t& table = alias_tables[hit];
+        const uint64_t n = table.values.size();
+        for (uint32_t i = 0; i < TIMING_BUFFER_SIZE; i++) {
+            const uint64_t column = ((uniforms[i] >> 32) * n) >> 32;
+            const bool keep = (uint32_t) uniforms[i] < table.probs[column];
+            out[i] = table.values[keep ? column : table.aliases[column]];
+        }
+        break;
+    }
+    }
+    buffer->pos[hit] = 0;
+}
@@ -0,0 +1,71 @@
+//Stochastic access latencies for sim_access.
+//By default every hit costs HIT_TIME and every miss HIT_TIME + MISS_TIME. A timing model replaces those
+//constants with samples:
+//  GAUSSIAN   base + N(0, sigma), sigma set separately for hits and misses
+//  EMPIRICAL  drawn from weighted latency values, e.g. the buckets of the hit and miss hdr_hist_t of a
+//             phase_latency_t
+//  QUANTIZED  the Gaussian latency as read from a timer of resolution quantum: rounded to a multiple
+//             of it at a uniformly random phase, so it is still unbiased
+//
+//Samples are produced in bulk into per-thread buffers by a table sampler: a set of xorshift128+
+//generators run lane-parallel, and normals come from a table of the inverse CDF with linear
+//interpolation (so they are truncated at about 3.7 sigma). sim_access then pays a buffer read per access.
+
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include "cache_sim.hpp"
+#include "latency.hpp"
+
+#include <vector>
+
+#define TIMING_BUFFER_SIZE 4096
+#define TIMING_LANES 8
+#define TIMING_NORMAL_TABLE_BITS 12
+
+typedef enum timing_model_kind {
+    TIMING_MODEL_FIXED,
+    TIMING_MODEL_GAUSSIAN,
+    TIMING_MODEL_EMPIRICAL,
+    TIMING_MODEL_QUANTIZED,
+} timing_model_kind_t;
+
+typedef struct {
+    timing_model_kind_t kind;
+    uint64_t seed;
+    double hit_sigma;   //GAUSSIAN, QUANTIZED
+    double miss_sigma;
+    double quantum;     //QUANTIZED
+    std::vector<double> hit_values;     //EMPIRICAL
+    std::vector<double> hit_weights;
+    std::vector<double> miss_values;
+    std::vector<double> miss_weights;
+} timing_model_t;
+
+typedef struct {
+    uint64_t generation;    //Model the buffers were filled for
+    uint32_t pos[2];        //[miss, hit]
+    double samples[2][TIMING_BUFFER_SIZE];
+    uint64_t rng[2][TIMING_LANES];
+} timing_buffer_t;
+
+extern bool timing_model_active;
+extern uint64_t timing_generation;
+extern thread_local timing_buffer_t* timing_buffer;
+
+extern void timing_model_init(timing_model_t* model, timing_model_kind_t kind);
+extern void timing_model_from_hist(timing_model_t* model, const hdr_hist_t* hits, const hdr_hist_t* misses);
+extern void timing_set_model(const timing_model_t* model);
+extern void timing_refill(bool hit);
+
+//Latency of one access under the current model.
+inline double timing_sample(bool hit) {
+    timing_buffer_t* buffer = timing_buffer;
+    if (buffer == nullptr || buffer->generation != timing_generation || buffer->pos[hit] == TIMING_BUFFER_SIZE) {
+        timing_refill(hit);
+        buffer = timing_buffer;
+    }
+    return buffer->samples[hit][buffer->pos[hit]++];
+}
+
+#endif
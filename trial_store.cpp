@@ -0,0 +1,241 @@
+#include "trial_store.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+//Walk times are compared against thresholds in thousands, as in do_pixel_attack.
+#define WALK_TIME_SCALE 1000.0
+
+typedef struct {
+    char magic[8];
+    uint64_t num_configs;
+    uint64_t num_trials;
+} trial_store_header_t;
+
+namespace {
+    template <typename T>
+    void save_column(uint8_t** out, const std::vector<T>& column) {
+        memcpy(*out, column.data(), column.size() * sizeof(T));
+        *out += column.size() * sizeof(T);
+    }
+
+    template <typename T>
+    void load_column(const uint8_t** in, std::vector<T>& column, uint64_t n) {
+        column.resize(n);
+        memcpy(column.data(), *in, n * sizeof(T));
+        *in += n * sizeof(T);
+    }
+
+    const uint64_t TRIAL_SIZE = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(double) + sizeof(uint64_t);
+
+    uint64_t state_size(uint64_t num_configs, uint64_t num_trials) {
+        return sizeof(trial_store_header_t) + num_configs * sizeof(trial_config_t) + num_trials * TRIAL_SIZE;
+    }
+
+    //Whether a header's counts describe exactly size bytes. The counts are bounded before state_size
+    //multiplies them, so a corrupt header can't wrap around to a matching size.
+    bool state_fits(uint64_t num_configs, uint64_t num_trials, uint64_t size) {
+        uint64_t remaining = size - sizeof(trial_store_header_t);
+        if (num_configs > remaining / sizeof(trial_config_t)) {
+            return false;
+        }
+        remaining -= num_configs * sizeof(trial_config_t);
+        return num_trials <= remaining / TRIAL_SIZE && state_size(num_configs, num_trials) == size;
+    }
+
+    //The enums of a config read back from a file, which are used as table indices.
+    bool valid_cache_config(const cache_config_t* config) {
+        return (uint32_t) config->replace_policy <= REPLACE_POLICY_QLRU &&
+            (uint32_t) config->prefetch_insert_policy <= INSERT_POLICY_LIP &&
+            (uint32_t) config->write_strat <= WRITE_STRAT_WTWNA;
+    }
+
+    bool valid_trial_config(const trial_config_t* config) {
+        return valid_cache_config(&config->sim.l1_config) && valid_cache_config(&config->sim.l2_config) &&
+            (uint32_t) config->facade_mode < FACADE_NUM_MODES &&
+            (uint32_t) config->order.render < ACCESS_ORDER_COUNT && (uint32_t) config->order.walk < ACCESS_ORDER_COUNT;
+    }
+}
+
+uint16_t trial_store_add_config(trial_store_t* store, const sim_config_t* sim, bool use_facade, facade_mode_t mode,
+        const attack_order_t* order) {
+    trial_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.sim = *sim;
+    config.use_facade = use_facade;
+    config.facade_mode = use_facade ? mode : FACADE_NONE;
+    config.order = *order;
+    store->configs.push_back(config);
+    return (uint16_t) (store->configs.size() - 1);
+}
+
+void trial_store_record(trial_store_t* store, uint16_t config, uint32_t pixel, bool actual_white, 
+        double walk_time, uint64_t num_evictions) {
+    store->config.push_back(config);
+    store->pixel.push_back(pixel);
+    store->actual_white.push_back(actual_white);
+    store->walk_time.push_back(walk_time);
+    store->num_evictions.push_back(num_evictions);
+}
+
+//Layout: header, config table, then each column contiguously. This is also the file format.
+uint64_t trial_store_state_size(const trial_store_t* store) {
+    return state_size(store->configs.size(), store->config.size());
+}
+
+void save_trial_store_state(const trial_store_t* store, uint8_t* out) {
+    trial_store_header_t header;
+    memcpy(header.magic, TRIAL_STORE_MAGIC, sizeof(header.magic));
+    header.num_configs = store->configs.size();
+    header.num_trials = store->config.size();
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+
+    save_column(&out, store->configs);
+    save_column(&out, store->config);
+    save_column(&out, store->pixel);
+    save_column(&out, store->actual_white);
+    save_column(&out, store->walk_time);
+    save_column(&out, store->num_evictions);
+}
+
+//Replaces store's contents. Returns false, leaving store as it was, if the state is malformed.
+bool load_trial_store_state(trial_store_t* store, const uint8_t* in, uint64_t size) {
+    trial_store_header_t header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, in, sizeof(header));
+    if (memcmp(header.magic, TRIAL_STORE_MAGIC, sizeof(header.magic)) != 0 || 
+            !state_fits(header.num_configs, header.num_trials, size)) {
+        return false;
+    }
+    in += sizeof(header);
+
+    trial_store_t loaded;
+    load_column(&in, loaded.configs, header.num_configs);
+    load_column(&in, loaded.config, header.num_trials);
+    load_column(&in, loaded.pixel, header.num_trials);
+    load_column(&in, loaded.actual_white, header.num_trials);
+    load_column(&in, loaded.walk_time, header.num_trials);
+    load_column(&in, loaded.num_evictions, header.num_trials);
+
+    for (const trial_config_t& config : loaded.configs) {
+        if (!valid_trial_config(&config)) {
+            return false;
+        }
+    }
+    for (uint16_t config : loaded.config) {
+        if (config >= header.num_configs) {
+            return false;
+        }
+    }
+
+    *store = std::move(loaded);
+    return true;
+}
+
+bool trial_store_save(const trial_store_t* store, const char* path) {
+    FILE* out = fopen(path, "wb");
+    if (out == nullptr) {
+        return false;
+    }
+
+    std::vector<uint8_t> state(trial_store_state_size(store));
+    save_trial_store_state(store, state.data());
+    bool ok = fwrite(state.data(), 1, state.size(), out) == state.size();
+    return fclose(out) == 0 && ok;
+}
+
+bool trial_store_load(trial_store_t* store, const char* path) {
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        return false;
+    }
+
+    std::vector<uint8_t> state;
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        state.insert(state.end(), buffer, buffer + n);
+    }
+    fclose(in);
+    return load_trial_store_state(store, state.data(), state.size());
+}
+
+double trial_store_accuracy(const trial_store_t* store, uint16_t config, double threshold) {
+    uint64_t correct = 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < store->config.size(); i++) {
+        if (store->config[i] != config) {
+            continue;
+        }
+        bool guess_white = store->walk_time[i] / WALK_TIME_SCALE > threshold;
+        correct += guess_white == (bool) store->actual_white[i];
+        total++;
+    }
+
+    return total == 0 ? 0.0 : (double) correct / total;
+}
+
+//Sorts the config's walk times in descending order and lowers the threshold past one distinct walk time
+//at a time, so every achievable (TPR, FPR, accuracy) is visited once. Thresholds sit halfway between
+//neighbouring walk times. White pixels are the positives.
+threshold_eval_t evaluate_thresholds(const trial_store_t* store, uint16_t config, std::vector<roc_point_t>* outRoc) {
+    std::vector<std::pair<double, uint8_t>> trials;
+    uint64_t positives = 0;
+    for (size_t i = 0; i < store->config.size(); i++) {
+        if (store->config[i] == config) {
+            trials.push_back(std::make_pair(store->walk_time[i] / WALK_TIME_SCALE, store->actual_white[i]));
+            positives += store->actual_white[i];
+        }
+    }
+    std::sort(trials.begin(), trials.end(), [](const std::pair<double, uint8_t>& a, const std::pair<double, uint8_t>& b) {
+        return a.first > b.first;
+    });
+
+    threshold_eval_t eval;
+    eval.trials = trials.size();
+    eval.auc = 0.0;
+    const uint64_t negatives = trials.size() - positives;
+
+    //Threshold above every walk time: everything is guessed black
+    uint64_t tp = 0;
+    uint64_t fp = 0;
+    double prevTpr = 0.0;
+    double prevFpr = 0.0;
+    eval.best_threshold = trials.empty() ? 0.0 : trials[0].first;
+    eval.best_accuracy = trials.empty() ? 0.0 : (double) negatives / trials.size();
+    if (outRoc != nullptr) {
+        outRoc->clear();
+        outRoc->push_back({eval.best_threshold, 0.0, 0.0, eval.best_accuracy});
+    }
+
+    for (size_t i = 0; i < trials.size(); ) {
+        //Take every trial with this walk time
+        const double walkTime = trials[i].first;
+        for (; i < trials.size() && trials[i].first == walkTime; i++) {
+            tp += trials[i].second;
+            fp += !trials[i].second;
+        }
+
+        const double threshold = i < trials.size() ? (walkTime + trials[i].first) / 2.0 : walkTime - 1.0;
+        const double tpr = positives == 0 ? 0.0 : (double) tp / positives;
+        const double fpr = negatives == 0 ? 0.0 : (double) fp / negatives;
+        const double accuracy = (double) (tp + negatives - fp) / trials.size();
+        eval.auc += (fpr - prevFpr) * (tpr + prevTpr) / 2.0;
+        prevTpr = tpr;
+        prevFpr = fpr;
+
+        if (accuracy > eval.best_accuracy) {
+            eval.best_accuracy = accuracy;
+            eval.best_threshold = threshold;
+        }
+        if (outRoc != nullptr) {
+            outRoc->push_back({threshold, tpr, fpr, accuracy});
+        }
+    }
+
+    return eval;
+}
@@ -0,0 +1,61 @@
+//Per-trial results of the pixel attack, stored by column so thresholds can be tuned offline.
+//Every trial keeps its ground truth, walk time and eviction count, plus the id of the configuration
+//it ran under. The evaluator sweeps every threshold in one pass over the sorted walk times.
+
+#ifndef TRIAL_STORE_HPP
+#define TRIAL_STORE_HPP
+
+#include "cache_sim.hpp"
+#include "frame.hpp"
+
+#include <vector>
+
+#define TRIAL_STORE_MAGIC "TRIALS03"
+
+typedef struct {
+    sim_config_t sim;
+    bool use_facade;
+    facade_mode_t facade_mode;  //The facade the defended reads used, FACADE_NONE without use_facade
+    attack_order_t order;
+} trial_config_t;
+
+typedef struct {
+    std::vector<trial_config_t> configs;
+
+    //Columns, one row per trial
+    std::vector<uint16_t> config;
+    std::vector<uint32_t> pixel;
+    std::vector<uint8_t> actual_white;
+    std::vector<double> walk_time;
+    std::vector<uint64_t> num_evictions;
+} trial_store_t;
+
+//A point of the ROC curve: guessing white when walk_time / 1000 > threshold.
+typedef struct {
+    double threshold;
+    double true_positive_rate;
+    double false_positive_rate;
+    double accuracy;
+} roc_point_t;
+
+typedef struct {
+    uint64_t trials;
+    double auc;
+    double best_threshold;
+    double best_accuracy;
+} threshold_eval_t;
+
+extern uint16_t trial_store_add_config(trial_store_t* store, const sim_config_t* sim, bool use_facade, facade_mode_t mode,
+    const attack_order_t* order);
+extern void trial_store_record(trial_store_t* store, uint16_t config, uint32_t pixel, bool actual_white, 
+    double walk_time, uint64_t num_evictions);
+extern uint64_t trial_store_state_size(const trial_store_t* store);
+extern void save_trial_store_state(const trial_store_t* store, uint8_t* out);
+extern bool load_trial_store_state(trial_store_t* store, const uint8_t* in, uint64_t size);
+extern bool trial_store_save(const trial_store_t* store, const char* path);
+extern bool trial_store_load(trial_store_t* store, const char* path);
+
+extern double trial_store_accuracy(const trial_store_t* store, uint16_t config, double threshold);
+extern threshold_eval_t evaluate_thresholds(const trial_store_t* store, uint16_t config, std::vector<roc_point_t>* outRoc=nullptr);
+
+#endif